@@ -0,0 +1,328 @@
+/**
+ * @file benchmark.cpp
+ * @author Joshua Dahl (jdahl@unr.edu)
+ * @brief Standalone benchmarks for the performance sensitive parts of the tangle
+ * @version 0.1
+ * @date 2021-12-08
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#include <chrono>
+#include <condition_variable>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "signature.hpp"
+#include "tangle.hpp"
+#include "transport.hpp"
+
+// Default number of operations each benchmark performs
+#define BENCHMARK_DEFAULT_ITERATIONS 2000
+// Number of distinct keys the signature benchmarks sign with
+#define BENCHMARK_SIGNATURE_KEYS 16
+// Size of the messages the transport benchmarks send, and the first port they listen on
+#define BENCHMARK_MESSAGE_SIZE 512
+#define BENCHMARK_TRANSPORT_PORT 23456
+// How long the transport benchmarks wait for connections and deliveries before giving up
+#define BENCHMARK_TRANSPORT_TIMEOUT std::chrono::seconds(10)
+
+/**
+ * @brief Function which times a function and prints its throughput
+ *
+ * @param name - Name of the operation being timed
+ * @param operations - The number of operations <f> performs
+ * @param f - The function to time
+ */
+template<typename F>
+void report(const std::string& name, size_t operations, F&& f){
+	auto start = std::chrono::steady_clock::now();
+	f();
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	std::cout << "  " << std::left << std::setw(24) << name
+		<< std::right << std::setw(12) << std::fixed << std::setprecision(0) << (operations / elapsed.count()) << " ops/s"
+		<< std::setw(12) << std::setprecision(2) << (elapsed.count() * 1000000 / operations) << " us/op" << std::endl;
+}
+
+
+// -- Signatures --
+
+
+/**
+ * @brief Benchmark of signing, verification, and batch verification throughput of a signature scheme
+ *
+ * @tparam Scheme - The signature scheme to benchmark (see signature.hpp)
+ * @param iterations - The number of signatures to make and check
+ */
+template<typename Scheme>
+void benchmarkSignatureScheme(size_t iterations){
+	std::cout << Scheme::NAME << " (" << Scheme::SIGNATURE_SIZE << " byte signatures)" << std::endl;
+
+	// Generate the keys
+	std::vector<typename Scheme::PrivateKey> privateKeys;
+	std::vector<typename Scheme::PublicKey> publicKeys;
+	report("generate keys", BENCHMARK_SIGNATURE_KEYS, [&]{
+		for(size_t i = 0; i < BENCHMARK_SIGNATURE_KEYS; i++){
+			privateKeys.push_back(Scheme::generatePrivateKey());
+			publicKeys.push_back(Scheme::generatePublicKey(privateKeys.back()));
+		}
+	});
+
+	// Messages similar in size to what transactions sign (encoded amounts and hashes)
+	std::vector<std::string> messages;
+	for(size_t i = 0; i < iterations; i++)
+		messages.push_back("message " + std::to_string(i) + " padded out to roughly a hash");
+
+	// Runs of consecutive signatures share a key (as the inputs of a transaction often do)
+	auto keyOf = [iterations](size_t i){ return i * BENCHMARK_SIGNATURE_KEYS / iterations; };
+
+	std::vector<std::string> signatures(iterations);
+	report("sign", iterations, [&]{
+		for(size_t i = 0; i < iterations; i++)
+			signatures[i] = Scheme::sign(privateKeys[keyOf(i)], messages[i]);
+	});
+
+	bool good = true;
+	report("verify", iterations, [&]{
+		for(size_t i = 0; i < iterations; i++)
+			good &= Scheme::verify(publicKeys[keyOf(i)], messages[i], signatures[i]);
+	});
+
+	// Verifiers are prepared once per key and reused (as they are for known accounts)
+	std::vector<std::unique_ptr<const typename Scheme::Verifier>> verifiers;
+	report("prepare verifiers", BENCHMARK_SIGNATURE_KEYS, [&]{
+		for(auto& key: publicKeys)
+			verifiers.push_back(Scheme::makeVerifier(key));
+	});
+
+	report("verify (prepared)", iterations, [&]{
+		for(size_t i = 0; i < iterations; i++)
+			good &= Scheme::verify(*verifiers[keyOf(i)], key::scheme::bytes(messages[i]), key::scheme::bytes(signatures[i]));
+	});
+
+	std::vector<typename Scheme::Job> jobs;
+	for(size_t i = 0; i < iterations; i++)
+		jobs.push_back({ verifiers[keyOf(i)].get(), key::scheme::bytes(messages[i]), key::scheme::bytes(signatures[i]) });
+	report("verify (batch)", iterations, [&]{
+		good &= Scheme::verifyBatch(jobs);
+	});
+
+	if(!good) std::cout << "  WARNING: some signatures failed to verify!" << std::endl;
+	std::cout << std::endl;
+}
+
+
+// -- Transports --
+
+
+/**
+ * @brief Benchmark of the message throughput and round trip latency between two transport backends connected over loopback
+ *
+ * @tparam Backend - The transport backend to benchmark (see transport.hpp)
+ * @param iterations - The number of messages to send
+ * @param port - The first of the two ports the backends listen on
+ */
+template<typename Backend>
+void benchmarkTransport(size_t iterations, unsigned short port){
+	std::unique_ptr<Backend> sender, receiver;
+	try {
+		sender = std::make_unique<Backend>(port);
+		receiver = std::make_unique<Backend>(port + 1);
+	} catch (transport::Unavailable& e) {
+		std::cout << "Skipping unavailable transport" << std::endl << "\t" << e.what() << std::endl << std::endl;
+		return;
+	}
+	std::cout << sender->name() << " (" << BENCHMARK_MESSAGE_SIZE << " byte messages)" << std::endl;
+
+	// Counters (and the condition which is notified when they change) tracking what each side has seen
+	std::mutex mutex;
+	std::condition_variable changed;
+	size_t connections = 0, received = 0, echoed = 0;
+	std::atomic<bool> echo = false;
+	auto wait = [&](auto predicate){
+		std::unique_lock lock(mutex);
+		return changed.wait_for(lock, BENCHMARK_TRANSPORT_TIMEOUT, predicate);
+	};
+
+	auto onConnection = [&](const transport::PeerID&, bool connected){
+		std::scoped_lock lock(mutex);
+		connections += connected;
+		changed.notify_all();
+	};
+	sender->handle([&](const transport::PeerID&, std::string_view){
+		std::scoped_lock lock(mutex);
+		echoed++;
+		changed.notify_all();
+	}, onConnection);
+	receiver->handle([&](const transport::PeerID& source, std::string_view message){
+		if(echo) receiver->send(source, message);
+		std::scoped_lock lock(mutex);
+		received++;
+		changed.notify_all();
+	}, onConnection);
+
+	receiver->start();
+	if(!sender->connect(boost::asio::ip::make_address("127.0.0.1"), port + 1) || !wait([&]{ return connections >= 2; })){
+		std::cout << "  WARNING: failed to connect!" << std::endl << std::endl;
+		return;
+	}
+
+	std::string message(BENCHMARK_MESSAGE_SIZE, 'x');
+	bool good = true;
+	report("send", iterations, [&]{
+		for(size_t i = 0; i < iterations; i++)
+			sender->send(receiver->self(), message);
+		good &= wait([&]{ return received >= iterations; });
+	});
+
+	// Each message is sent once the previous one has come back
+	echo = true;
+	size_t roundTrips = std::max<size_t>(1, iterations / 10);
+	report("round trip", roundTrips, [&]{
+		for(size_t i = 0; i < roundTrips && good; i++){
+			sender->send(receiver->self(), message);
+			good &= wait([&]{ return echoed > i; });
+		}
+	});
+
+	if(!good) std::cout << "  WARNING: some messages were never delivered!" << std::endl;
+	sender->disconnect();
+	receiver->disconnect();
+	std::cout << std::endl;
+}
+
+
+// -- Ledger --
+
+
+/**
+ * @brief Function which creates the accounts the ledger benchmarks pay between, one per thread, funded by a genesis
+ * @note Accounts are interned consecutively, so each thread's account lands in its own shard of the conflict index
+ *
+ * @param threads - The number of accounts to create
+ * @param funds - How much each account is given
+ * @return std::pair<std::vector<key::KeyPair>, TransactionNode::ptr> - The accounts, and the genesis funding them
+ */
+std::pair<std::vector<key::KeyPair>, TransactionNode::ptr> ledgerAccounts(size_t threads, double funds){
+	std::vector<key::KeyPair> accounts;
+	std::vector<Transaction::Output> funding;
+	for(size_t i = 0; i < threads; i++){
+		accounts.push_back(key::generateKeyPair());
+		funding.emplace_back(accounts.back().pub, funds);
+	}
+	return { accounts, TransactionNode::create({}, {}, funding) };
+}
+
+/**
+ * @brief Function which creates the transactions each thread of a ledger benchmark adds, ahead of time (signing isn't what is being measured)
+ * @note Each thread's transactions form a chain (each approving the last), so no node gathers an outsized list of children
+ *
+ * @param accounts - The accounts to pay between (at least one more than <threads> when <crossShard>)
+ * @param genesis - The genesis funding them
+ * @param threads - The number of threads adding transactions
+ * @param count - The number of transactions each thread adds
+ * @param crossShard - Whether each thread pays the next thread's account (touching two shards) rather than itself (touching one)
+ * @return std::vector<std::vector<TransactionNode::ptr>> - Each thread's transactions
+ */
+std::vector<std::vector<TransactionNode::ptr>> ledgerTransactions(std::vector<key::KeyPair>& accounts, const TransactionNode::ptr& genesis, size_t threads, size_t count, bool crossShard){
+	std::vector<std::vector<TransactionNode::ptr>> transactions(threads);
+	for(size_t i = 0; i < threads; i++){
+		auto& recipient = accounts[crossShard ? (i + 1) % accounts.size() : i].pub;
+		TransactionNode::const_ptr parent = genesis;
+		for(size_t j = 0; j < count; j++){
+			auto node = TransactionNode::create({parent}, { {accounts[i], 1} }, { {recipient, 1} }, 0);
+			node->mineTransaction();
+			transactions[i].push_back(node);
+			parent = node;
+		}
+	}
+	return transactions;
+}
+
+/**
+ * @brief Function which adds each thread's transactions from its own thread, timing the whole
+ *
+ * @param name - Name of the operation being timed
+ * @param transactions - Each thread's transactions
+ * @param add - Function which adds a transaction, returning false if it was rejected
+ */
+template<typename F>
+void reportLedger(const std::string& name, const std::vector<std::vector<TransactionNode::ptr>>& transactions, F&& add){
+	size_t total = 0;
+	for(auto& list: transactions)
+		total += list.size();
+
+	std::atomic<bool> good = true;
+	report(name + " (" + std::to_string(transactions.size()) + " threads)", total, [&]{
+		std::vector<std::thread> workers;
+		for(auto& list: transactions)
+			workers.emplace_back([&]{
+				for(auto& node: list)
+					if(!add(node)) good = false;
+			});
+		for(auto& worker: workers)
+			worker.join();
+	});
+	if(!good) std::cout << "  WARNING: some transactions were rejected!" << std::endl;
+}
+
+/**
+ * @brief Benchmark of how well balance validation (the conflict index, and the whole of Tangle::add) scales when transactions are added from several threads at once
+ *
+ * @param iterations - The number of transactions each thread adds to the conflict index (a tenth as many are added to the tangle, which is far more expensive per transaction)
+ */
+void benchmarkLedger(size_t iterations){
+	size_t cores = std::max(1u, std::thread::hardware_concurrency());
+	std::cout << "Conflict index (" << ConflictIndex().shardCount() << " shards)" << std::endl;
+
+	for(bool crossShard: {false, true})
+		for(size_t threads: std::vector<size_t>{1, cores}){
+			auto [accounts, genesis] = ledgerAccounts(threads + 1, iterations);
+			auto transactions = ledgerTransactions(accounts, genesis, threads, iterations, crossShard);
+
+			ConflictIndex index;
+			index.rebuild(genesis);
+			reportLedger(crossShard ? "add cross-shard" : "add same shard", transactions, [&](const TransactionNode::ptr& node){ return !index.add(node); });
+		}
+
+	std::cout << std::endl << "Tangle::add" << std::endl;
+	for(bool crossShard: {false, true})
+		for(size_t threads: std::vector<size_t>{1, cores}){
+			auto [accounts, genesis] = ledgerAccounts(threads + 1, iterations);
+			auto transactions = ledgerTransactions(accounts, genesis, threads, std::max<size_t>(1, iterations / 10), crossShard);
+
+			Tangle tangle;
+			tangle.setGenesis(genesis);
+			reportLedger(crossShard ? "add cross-shard" : "add same shard", transactions, [&](const TransactionNode::ptr& node){
+				try {
+					tangle.add(node);
+					return true;
+				} catch (std::exception&) { return false; }
+			});
+		}
+	std::cout << std::endl;
+}
+
+
+int main(int argc, char* argv[]){
+	size_t iterations = argc > 1 ? std::stoul(argv[1]) : BENCHMARK_DEFAULT_ITERATIONS;
+	if(iterations < BENCHMARK_SIGNATURE_KEYS) iterations = BENCHMARK_SIGNATURE_KEYS;
+
+	std::cout << "-- Signature Schemes (" << iterations << " signatures) --" << std::endl << std::endl;
+	benchmarkSignatureScheme<key::scheme::ECDSA>(iterations);
+	benchmarkSignatureScheme<key::scheme::Ed25519>(iterations);
+
+	std::cout << "-- Ledger (" << iterations * 10 << " transactions per thread) --" << std::endl << std::endl;
+	benchmarkLedger(iterations * 10);
+
+	std::cout << "-- Transports (" << iterations * 100 << " messages over loopback) --" << std::endl << std::endl;
+	benchmarkTransport<transport::BreepTransport>(iterations * 100, BENCHMARK_TRANSPORT_PORT);
+	benchmarkTransport<transport::UringTransport>(iterations * 100, BENCHMARK_TRANSPORT_PORT + 2);
+	benchmarkTransport<transport::LoopbackTransport>(iterations * 100, BENCHMARK_TRANSPORT_PORT + 4);
+
+	return 0;
+}
@@ -0,0 +1,134 @@
+/**
+ * @file bloom.hpp
+ * @author Joshua Dahl (jdahl@unr.edu)
+ * @brief File which provides a rolling Bloom filter used to remember which transactions have recently been seen
+ * @version 0.1
+ * @date 2021-12-10
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#ifndef BLOOM_HPP
+#define BLOOM_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Bloom filter which remembers (at least) the last <capacity> inserted items in a fixed amount of memory
+ * @note Made up of two generations, once the current generation is full the older one is cleared and becomes the current one.
+ * 	Items are reported as present if either generation contains them, so an item is remembered for between <capacity> and 2 * <capacity> insertions.
+ * @note Thread safe
+ */
+struct RollingBloomFilter {
+	/**
+	 * @brief Creates a filter
+	 *
+	 * @param capacity - Number of insertions each generation holds
+	 * @param falsePositiveRate - Target false positive rate of each generation
+	 */
+	RollingBloomFilter(size_t capacity, double falsePositiveRate) : capacity(capacity) {
+		// Optimal number of bits and hash functions for the capacity and error rate
+		double bitsPerItem = -std::log(falsePositiveRate) / (std::log(2) * std::log(2));
+		size_t bits = std::max<size_t>(64, std::ceil(capacity * bitsPerItem));
+		hashCount = std::max<size_t>(1, std::round(bitsPerItem * std::log(2)));
+
+		for(auto& generation: generations)
+			generation.assign((bits + 63) / 64, 0);
+	}
+
+	/**
+	 * @brief Function which checks if an item may have been inserted
+	 *
+	 * @param item - The item to check
+	 * @return bool - False if the item definitely wasn't inserted recently, true if it (probably) was
+	 */
+	bool contains(std::string_view item) const {
+		auto [h1, h2] = hashes(item);
+		std::scoped_lock lock(mutex);
+		return test(generations[current], h1, h2) || test(generations[!current], h1, h2);
+	}
+
+	/**
+	 * @brief Function which inserts an item into the filter
+	 *
+	 * @param item - The item to insert
+	 * @return bool - True if the item was (probably) already present
+	 */
+	bool insert(std::string_view item){
+		auto [h1, h2] = hashes(item);
+		std::scoped_lock lock(mutex);
+		if(test(generations[current], h1, h2) || test(generations[!current], h1, h2))
+			return true;
+
+		// If the current generation is full, forget the oldest generation and start filling it
+		if(inserted >= capacity){
+			current = !current;
+			std::fill(generations[current].begin(), generations[current].end(), 0);
+			inserted = 0;
+		}
+
+		auto& generation = generations[current];
+		size_t bits = generation.size() * 64;
+		for(size_t i = 0; i < hashCount; i++){
+			size_t bit = (h1 + i * h2) % bits;
+			generation[bit / 64] |= uint64_t(1) << (bit % 64);
+		}
+		inserted++;
+		return false;
+	}
+
+	/**
+	 * @brief Function which forgets everything in the filter
+	 */
+	void clear(){
+		std::scoped_lock lock(mutex);
+		for(auto& generation: generations)
+			std::fill(generation.begin(), generation.end(), 0);
+		inserted = 0;
+	}
+
+protected:
+	// Number of insertions each generation holds
+	const size_t capacity;
+	// Number of bits set per item
+	size_t hashCount;
+	// The two generations of bits, and which one is currently being filled
+	std::vector<uint64_t> generations[2];
+	bool current = 0;
+	// Number of items inserted into the current generation
+	size_t inserted = 0;
+	// Mutex protecting the filter
+	mutable std::mutex mutex;
+
+	/**
+	 * @brief Function which checks if all of an item's bits are set in a generation
+	 */
+	bool test(const std::vector<uint64_t>& generation, uint64_t h1, uint64_t h2) const {
+		size_t bits = generation.size() * 64;
+		for(size_t i = 0; i < hashCount; i++){
+			size_t bit = (h1 + i * h2) % bits;
+			if(!(generation[bit / 64] & (uint64_t(1) << (bit % 64))))
+				return false;
+		}
+		return true;
+	}
+
+	/**
+	 * @brief Function which generates the two hashes every bit index is derived from (Kirsch-Mitzenmacher double hashing)
+	 */
+	static std::pair<uint64_t, uint64_t> hashes(std::string_view item){
+		uint64_t h1 = std::hash<std::string_view>{}(item);
+		uint64_t h2 = h1 ^ (h1 >> 33);
+		h2 *= 0xFF51AFD7ED558CCDull;
+		h2 ^= h2 >> 33;
+		return { h1, h2 | 1 }; // Odd so every bit can be reached
+	}
+};
+
+#endif /* end of include guard: BLOOM_HPP */
@@ -0,0 +1,167 @@
+/**
+ * @file capture.hpp
+ * @author Joshua Dahl (jdahl@unr.edu)
+ * @brief File which provides the recording of everything a node receives (captures), and the transport which plays captures back into a tangle
+ * @version 0.1
+ * @date 2021-12-12
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#ifndef CAPTURE_HPP
+#define CAPTURE_HPP
+
+#include "transport.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <optional>
+
+// Magic string at the start of every capture file (bump the version when the format changes)
+#define CAPTURE_MAGIC "TNGLCAP2"
+
+namespace transport {
+
+	/**
+	 * @brief Exception thrown when a capture file can't be read
+	 */
+	struct InvalidCapture : public std::runtime_error { using std::runtime_error::runtime_error; };
+
+	/**
+	 * @brief Something a node received: a message, or a peer dis/connecting; or a transaction the node originated (Local)
+	 * @note File format: the magic string and the recording node's ID, then for every record its kind (1), time (8), peer ID (16), payload length (4), and payload
+	 */
+	struct CaptureRecord {
+		enum Kind : uint8_t { Message = 0, Connected = 1, Disconnected = 2, Local = 3 } kind;
+		// When the record was received, relative to the start of the capture
+		std::chrono::nanoseconds time;
+		// Who sent the message, or who dis/connected (the recording node for local records)
+		PeerID peer;
+		// The message (its type tag followed by its serialized form), the serialized transaction for local records, empty for dis/connections
+		std::string payload;
+	};
+
+	/**
+	 * @brief Appends records to a capture file
+	 * @note Not thread safe, the network only writes while delivering (which is already serialized)
+	 */
+	struct CaptureWriter {
+		/**
+		 * @brief Creates a capture file
+		 *
+		 * @param path - Where to save the capture
+		 * @param self - The ID of the node being recorded
+		 * @exception std::runtime_error - Thrown if the file can't be created
+		 */
+		CaptureWriter(const std::string& path, const PeerID& self) : out(path, std::ios::binary | std::ios::trunc), start(std::chrono::steady_clock::now()) {
+			if(!out) throw std::runtime_error("Failed to create capture file `" + path + "`");
+			out.write(CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC) - 1);
+			out.write((const char*) self.data, self.size());
+		}
+
+		void write(CaptureRecord::Kind kind, const PeerID& peer, std::string_view payload = {}){
+			uint64_t time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+			uint32_t length = payload.size();
+			out.put(kind);
+			out.write((const char*) &time, sizeof(time));
+			out.write((const char*) peer.data, peer.size());
+			out.write((const char*) &length, sizeof(length));
+			out.write(payload.data(), payload.size());
+		}
+
+		void flush() { out.flush(); }
+
+	protected:
+		std::ofstream out;
+		// When the capture started
+		std::chrono::steady_clock::time_point start;
+	};
+
+	/**
+	 * @brief Reads the records out of a capture file (in the order they were received)
+	 */
+	struct CaptureReader {
+		/**
+		 * @brief Opens a capture file
+		 * @exception InvalidCapture - Thrown if the file can't be opened, or isn't a capture
+		 */
+		CaptureReader(const std::string& path) : in(path, std::ios::binary) {
+			char magic[sizeof(CAPTURE_MAGIC) - 1];
+			if(!in.read(magic, sizeof(magic)) || std::string_view(magic, sizeof(magic)) != CAPTURE_MAGIC || !in.read((char*) _self.data, _self.size()))
+				throw InvalidCapture("`" + path + "` isn't a capture file");
+		}
+
+		// The ID of the node which was recorded
+		const PeerID& self() const { return _self; }
+
+		/**
+		 * @brief Function which reads the next record
+		 * @return std::optional<CaptureRecord> - The record, or nothing at the end of the capture
+		 * @exception InvalidCapture - Thrown if the capture ends in the middle of a record
+		 */
+		std::optional<CaptureRecord> next(){
+			CaptureRecord record;
+			uint8_t kind;
+			uint64_t time;
+			uint32_t length;
+			if(!in.read((char*) &kind, sizeof(kind))) return {};
+			if(!in.read((char*) &time, sizeof(time)) || !in.read((char*) record.peer.data, record.peer.size()) || !in.read((char*) &length, sizeof(length)))
+				throw InvalidCapture("Capture ends in the middle of a record");
+			record.payload.resize(length);
+			if(!in.read(record.payload.data(), length))
+				throw InvalidCapture("Capture ends in the middle of a record");
+
+			record.kind = CaptureRecord::Kind(kind);
+			record.time = std::chrono::nanoseconds(time);
+			return record;
+		}
+
+	protected:
+		std::ifstream in;
+		PeerID _self;
+	};
+
+	/**
+	 * @brief Transport which delivers the records of a capture (instead of anything from a real network)
+	 * @note Everything the node sends is discarded (and counted), records are delivered on the thread which calls replay
+	 * @note Local records aren't delivered (they weren't received from the network), the replay tool adds their transactions to the tangle itself
+	 */
+	struct ReplayTransport : public Transport {
+		// Number of messages (and bytes) the node sent in response to the replay
+		std::atomic<size_t> sentMessages = 0, sentBytes = 0;
+
+		/**
+		 * @brief Creates a transport which impersonates the recorded node
+		 */
+		ReplayTransport(const PeerID& id) : id(id) {}
+
+		const char* name() const override { return "replay"; }
+		const PeerID& self() const override { return id; }
+
+		void handle(MessageHandler onMessage, ConnectionHandler onConnection) override { this->onMessage = std::move(onMessage); this->onConnection = std::move(onConnection); }
+		void start() override {}
+		bool connect(const boost::asio::ip::address&, unsigned short) override { return false; }
+		void send(const PeerID&, std::string_view message) override { sentMessages++; sentBytes += message.size(); }
+		void disconnect() override {}
+
+		/**
+		 * @brief Function which delivers a record to the node
+		 */
+		void replay(const CaptureRecord& record){
+			switch(record.kind){
+			case CaptureRecord::Message: onMessage(record.peer, record.payload); break;
+			case CaptureRecord::Connected: onConnection(record.peer, true); break;
+			case CaptureRecord::Disconnected: onConnection(record.peer, false); break;
+			case CaptureRecord::Local: break;
+			}
+		}
+
+	protected:
+		PeerID id;
+		MessageHandler onMessage;
+		ConnectionHandler onConnection;
+	};
+
+} // transport
+
+#endif /* end of include guard: CAPTURE_HPP */
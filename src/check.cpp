@@ -0,0 +1,136 @@
+/**
+ * @file check.cpp
+ * @author Joshua Dahl (jdahl@unr.edu)
+ * @brief Correctness checks for the parts of the tangle which are easy to get subtly wrong (exits with a failure if any check fails)
+ * @version 0.1
+ * @date 2021-12-18
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#define BOOST_BIND_GLOBAL_PLACEHOLDERS
+
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include <boost/uuid/random_generator.hpp>
+
+#include "networking.hpp"
+#include "capture.hpp"
+
+/**
+ * @brief Function which prints whether a check passed
+ *
+ * @param name - Description of what is being checked
+ * @param passed - Whether the check passed
+ * @return bool - <passed>
+ */
+bool expect(const std::string& name, bool passed){
+	std::cout << "  " << std::left << std::setw(48) << name << (passed ? "ok" : "FAILED") << std::endl;
+	return passed;
+}
+
+/**
+ * @brief Checks of how the conflict index treats double spends and overdrafts
+ *
+ * @return bool - True if every check passed
+ */
+bool checkConflictIndex(){
+	std::cout << "Conflict index checks" << std::endl;
+	bool good = true;
+
+	auto spender = key::generateKeyPair(), first = key::generateKeyPair(), second = key::generateKeyPair(), third = key::generateKeyPair();
+	auto balance = [](ConflictIndex& index, const key::KeyPair& pair){ return index.balance(key::AccountTable::intern(pair.pub)); };
+
+	// Two concurrent spends of the same funds: their deposits are held until the conflict resolves, then only the winner's count
+	{
+		auto genesis = TransactionNode::create({}, {}, { {spender.pub, 10} });
+		ConflictIndex index;
+		index.rebuild(genesis);
+
+		auto a = TransactionNode::create({genesis}, { {spender, 10} }, { {first.pub, 10} }, 0);
+		auto b = TransactionNode::create({genesis}, { {spender, 10} }, { {second.pub, 10} }, 0);
+		good &= expect("first spend accepted", !index.add(a));
+		good &= expect("double spend accepted as a conflict", !index.add(b) && !a->conflicts->empty() && !b->conflicts->empty());
+		good &= expect("conflicting deposits held", balance(index, first) == 0 && balance(index, second) == 0);
+
+		auto spendHeld = TransactionNode::create({b}, { {second, 5} }, { {third.pub, 5} }, 0);
+		good &= expect("held deposit can't be spent", index.add(spendHeld).has_value());
+
+		util::mutable_cast(a->cumulativeWeight) = CONFLICT_SETTLED_WEIGHT;
+		good &= expect("winner's deposit released", balance(index, first) == 10);
+		good &= expect("loser's deposit dropped", balance(index, second) == 0);
+		good &= expect("loser's spend refunded", balance(index, spender) == 0);
+	}
+
+	// A spend on top of an unsettled spend it approves is an overdraft, not a conflict
+	{
+		auto genesis = TransactionNode::create({}, {}, { {spender.pub, 10} });
+		ConflictIndex index;
+		index.rebuild(genesis);
+
+		auto a = TransactionNode::create({genesis}, { {spender, 10} }, { {first.pub, 10} }, 0);
+		auto b = TransactionNode::create({a}, { {spender, 10} }, { {second.pub, 10} }, 0);
+		good &= expect("first spend accepted", !index.add(a));
+		good &= expect("spend approving the first rejected", index.add(b).has_value() && a->conflicts->empty());
+		good &= expect("rejected spend not recorded", balance(index, spender) == 0 && balance(index, second) == 0);
+	}
+
+	std::cout << std::endl;
+	return good;
+}
+
+/**
+ * @brief Checks that a pruned genesis (which aliases several transactions) survives being encoded and decoded, as it does when synchronized or checkpointed
+ *
+ * @return bool - True if every check passed
+ */
+bool checkLatestCommonGenesis(){
+	std::cout << "Latest common genesis checks" << std::endl;
+	bool good = true;
+
+	// A tangle which isn't connected to anyone (everything it sends is discarded)
+	transport::Network network(std::make_unique<transport::ReplayTransport>(boost::uuids::random_generator()()));
+	NetworkedTangle t(network);
+	t.weightUpdateThreads = false;
+
+	// Several transactions approving the genesis, all approved by a single tip, so they are confirmed together
+	auto spender = key::generateKeyPair();
+	t.setGenesis(TransactionNode::create({}, {}, { {spender.pub, GENESIS_CANDIDATE_THRESHOLD} }));
+	std::vector<TransactionNode::const_ptr> confirmed;
+	for(size_t i = 0; i < GENESIS_CANDIDATE_THRESHOLD; i++){
+		auto recipient = key::generateKeyPair();
+		auto node = TransactionNode::create({t.genesis}, { {spender, 1} }, { {recipient.pub, 1} }, 0);
+		t.add(node);
+		confirmed.push_back(node);
+	}
+	t.add(TransactionNode::create(confirmed, {}, {}, 0));
+
+	auto genesis = t.createLatestCommonGenesis();
+	good &= expect("confirmed transactions pruned", genesis != t.genesis && genesis->parentHashes.size() == GENESIS_CANDIDATE_THRESHOLD - 1);
+	good &= expect("aliases in canonical order", std::is_sorted(genesis->parentHashes.begin(), genesis->parentHashes.end()));
+
+	try {
+		auto encoded = genesis->encode();
+		auto decoded = Transaction::decode(encoded);
+		good &= expect("genesis round trips", decoded.encode() == encoded
+			&& std::equal(decoded.parentHashes.begin(), decoded.parentHashes.end(), genesis->parentHashes.begin(), genesis->parentHashes.end()));
+	} catch (std::exception& e) {
+		good &= expect("genesis round trips", false);
+		std::cerr << "\t" << e.what() << std::endl;
+	}
+
+	std::cout << std::endl;
+	return good;
+}
+
+
+int main(){
+	bool good = true;
+	good &= checkConflictIndex();
+	good &= checkLatestCommonGenesis();
+
+	std::cout << (good ? "All checks passed" : "Some checks FAILED") << std::endl;
+	return good ? 0 : 1;
+}
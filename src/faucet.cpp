@@ -0,0 +1,120 @@
+/**
+ * @file faucet.cpp
+ * @author Joshua Dahl (jdahl@unr.edu)
+ * @brief Code backing faucet.hpp
+ * @version 0.1
+ * @date 2021-12-16
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#include "faucet.hpp"
+
+/**
+ * @brief Starts the payout thread
+ *
+ * @param t - The tangle payouts are added to
+ * @param keys - The keys of the account payouts are paid from
+ * @param amount - The amount each account is given
+ * @param difficulty - The difficulty payouts are mined at
+ */
+Faucet::Faucet(NetworkedTangle& t, std::shared_ptr<key::KeyPair> keys, double amount, uint8_t difficulty /*= 1*/)
+	: amount(amount), difficulty(difficulty), t(t), keys(std::move(keys)), payoutThread([this](){ payouts(); }) {}
+
+Faucet::~Faucet() {
+	{
+		std::scoped_lock lock(mutex);
+		running = false;
+	}
+	changed.notify_all();
+	payoutThread.join();
+}
+
+/**
+ * @brief Function which queues a payout to a peer's account (once we know it)
+ *
+ * @param peer - The peer to pay
+ */
+void Faucet::credit(const boost::uuids::uuid& peer){
+	std::scoped_lock lock(mutex);
+	pendingPeers.push_back({peer});
+	changed.notify_all();
+}
+
+/**
+ * @brief Function which queues a payout to an account
+ *
+ * @param account - The account to pay
+ */
+void Faucet::credit(key::AccountID account){
+	std::scoped_lock lock(mutex);
+	pendingAccounts.push_back(account);
+	changed.notify_all();
+}
+
+/**
+ * @brief Function which (in its own thread) waits for credits, collects any others which arrive within the batch window, and pays them out together
+ */
+void Faucet::payouts(){
+	std::unique_lock lock(mutex);
+	while(running){
+		changed.wait(lock, [this]{ return !running || !pendingPeers.empty() || !pendingAccounts.empty(); });
+		if(!running) break;
+
+		// Give other credits a chance to arrive
+		if(changed.wait_for(lock, FAUCET_BATCH_WINDOW, [this]{ return !running; })) break;
+
+		auto peers = std::move(pendingPeers);
+		auto accounts = std::move(pendingAccounts);
+		pendingPeers.clear();
+		pendingAccounts.clear();
+
+		lock.unlock();
+		pay(std::move(peers), std::move(accounts));
+		lock.lock();
+	}
+}
+
+/**
+ * @brief Function which pays every account which doesn't have any money
+ *
+ * @param peers - Peers to pay (those whose account isn't known yet are tried again next batch, if they are still connected and haven't been retried FAUCET_MAX_PEER_RETRIES times)
+ * @param accounts - Accounts to pay
+ */
+void Faucet::pay(std::vector<PendingPeer> peers, std::vector<key::AccountID> accounts){
+	// Find the peers' accounts
+	auto connected = t.network.peers();
+	std::vector<PendingPeer> unknown;
+	for(auto& pending: peers)
+		if(auto account = t.peerKeys.find(pending.peer))
+			accounts.push_back(*account);
+		else if(connected.contains(pending.peer) && pending.retries < FAUCET_MAX_PEER_RETRIES)
+			unknown.push_back({pending.peer, pending.retries + 1});
+		else std::cerr << "Dropping faucet credit for peer `" << pending.peer << "`, their account isn't known (they are credited again if their key arrives)" << std::endl;
+	if(!unknown.empty()){
+		std::scoped_lock lock(mutex);
+		pendingPeers.insert(pendingPeers.end(), unknown.begin(), unknown.end());
+		changed.notify_all();
+	}
+
+	// Only pay accounts (once each) which don't have any money
+	std::unordered_set<key::AccountID> paying;
+	std::vector<Transaction::Output> outputs;
+	for(auto account: accounts)
+		if(t.indexedBalance(account) == 0 && paying.insert(account).second)
+			outputs.emplace_back(account, amount);
+
+	// Pay them, at most FAUCET_MAX_OUTPUTS at a time
+	for(size_t start = 0; start < outputs.size(); start += FAUCET_MAX_OUTPUTS){
+		std::vector<Transaction::Output> batch(outputs.begin() + start, outputs.begin() + std::min(outputs.size(), start + FAUCET_MAX_OUTPUTS));
+		std::vector<Transaction::Input> inputs;
+		inputs.emplace_back(*keys, amount * batch.size());
+
+		try {
+			std::cout << "Sending " << batch.size() << " accounts " << amount << " money!" << std::endl;
+			t.add(TransactionNode::createAndMine(t, inputs, batch, difficulty));
+		} catch (std::exception& e) {
+			std::cerr << "Failed to pay out faucet credits" << std::endl << "\t" << e.what() << std::endl;
+		}
+	}
+}
@@ -0,0 +1,68 @@
+/**
+ * @file faucet.hpp
+ * @author Joshua Dahl (jdahl@unr.edu)
+ * @brief File which provides the faucet the network's creator uses to give money to the accounts which join it
+ * @version 0.1
+ * @date 2021-12-16
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#ifndef FAUCET_HPP
+#define FAUCET_HPP
+
+#include <condition_variable>
+#include <unordered_set>
+
+#include "networking.hpp"
+
+// How long credits are collected after the first one arrives before they are paid out together
+#define FAUCET_BATCH_WINDOW std::chrono::milliseconds(100)
+// Maximum number of accounts paid by a single transaction (anything left over is paid by the next)
+#define FAUCET_MAX_OUTPUTS 256
+// Number of batches a peer whose account isn't known yet is retried in before it is dropped (it is credited again when its key arrives)
+#define FAUCET_MAX_PEER_RETRIES 50
+
+/**
+ * @brief Faucet which pays a fixed amount to accounts which don't have any money
+ * @note Credits are collected over a short window and paid out by a single multi-output transaction, so many peers joining at once cost one mine instead of one each
+ * @note Whether an account already has money is checked against the tangle's balance index (not a walk of the whole tangle)
+ */
+struct Faucet {
+	// The amount each account is given
+	const double amount;
+	// The difficulty payouts are mined at
+	const uint8_t difficulty;
+
+	Faucet(NetworkedTangle& t, std::shared_ptr<key::KeyPair> keys, double amount, uint8_t difficulty = 1);
+	~Faucet();
+
+	void credit(const boost::uuids::uuid& peer);
+	void credit(key::AccountID account);
+
+protected:
+	// The tangle payouts are added to, and the keys of the account they are paid from
+	NetworkedTangle& t;
+	std::shared_ptr<key::KeyPair> keys;
+
+	// Flag which tells the payout thread to stop
+	bool running = true;
+	// Mutex protecting the pending credits, and the condition signaled when one arrives (or the faucet is stopping)
+	std::mutex mutex;
+	std::condition_variable changed;
+	// Peer (whose account may not be known yet) waiting to be paid, and how many batches it has already been retried in
+	struct PendingPeer {
+		boost::uuids::uuid peer;
+		size_t retries = 0;
+	};
+	// Peers and accounts waiting to be paid
+	std::vector<PendingPeer> pendingPeers;
+	std::vector<key::AccountID> pendingAccounts;
+
+	std::thread payoutThread;
+
+	void payouts();
+	void pay(std::vector<PendingPeer> peers, std::vector<key::AccountID> accounts);
+};
+
+#endif /* end of include guard: FAUCET_HPP */
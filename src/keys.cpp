@@ -11,7 +11,6 @@
 #include "keys.hpp"
 
 #include <iostream>
-#include "cryptopp/osrng.h"
 
 namespace key {
 
@@ -22,55 +21,10 @@ namespace key {
 		return verifyMessage(*this, message, signature);
 	}
 
-	// Function which generates a private key
-	PrivateKey generatePrivateKey(const CryptoPP::OID& oid) {
-		CryptoPP::AutoSeededRandomPool prng;
-		PrivateKey key;
-
-		key.Initialize(prng, oid);
-		if(!key.Validate(prng, 3))
-			throw InvalidKey("Private Key failed to pass validation.");
-
-		return key;
-	}
-
-	// Function which generates a public key
-	PublicKey generatePublicKey(const PrivateKey& privateKey) {
-		CryptoPP::AutoSeededRandomPool prng;
-		PublicKey publicKey;
-
-		privateKey.MakePublicKey(publicKey);
-		if(!publicKey.Validate(prng, 3))
-			throw InvalidKey("Public Key failed to pass validation.");
-
-		return publicKey;
-	}
-
 	// Function which generates a private and public key pair
-	KeyPair generateKeyPair(const CryptoPP::OID& oid){
-		PrivateKey pri = generatePrivateKey(oid);
-		return { pri, generatePublicKey(pri) };
-	}
-
-	// Function which prints a private key
-	void print(const PrivateKey& key) {
-		std::cout << std::endl;
-		std::cout << "Private Exponent:" << std::endl;
-		std::cout << " " << key.GetPrivateExponent() << std::endl;
-	}
-
-	// Function which prints a public key
-	void print(const PublicKey& key) {
-		std::cout << std::endl;
-		std::cout << "Public Element:" << std::endl;
-		std::cout << " X: " << key.GetPublicElement().x << std::endl;
-		std::cout << " Y: " << key.GetPublicElement().y << std::endl;
-	}
-
-	// Function which prints a keypair
-	void print(const KeyPair& pair){
-		print(pair.pri);
-		print(pair.pub);
+	KeyPair generateKeyPair(){
+		PrivateKey pri = Scheme::generatePrivateKey();
+		return { pri, Scheme::generatePublicKey(pri) };
 	}
 
 	// Function which converts a private key to a byte array
@@ -127,24 +81,87 @@ namespace key {
 		return loadPublic(decoded);
 	}
 
-	// Function which signs the provided message
-	std::string signMessage(const PrivateKey& key, const std::string& message) {
-		CryptoPP::AutoSeededRandomPool prng;
-		std::string signature;
+	// Function which converts a signature produced by signMessage into its fixed size form
+	Signature toSignature(std::string_view signature) {
+		if(signature.size() != SIGNATURE_SIZE)
+			throw InvalidKey("Signature has the wrong size.");
 
-		CryptoPP::StringSource(message, true, new CryptoPP::SignerFilter(prng, KeyBase::Signer(key), new CryptoPP::StringSink(signature)));
-		return signature;
+		Signature out;
+		std::copy(signature.begin(), signature.end(), out.begin());
+		return out;
 	}
 
-	// Function which confirms that the signature was created from the message with the matching private key
-	bool verifyMessage(const PublicKey& key, const std::string& message, const std::string& signature) {
-		bool result = false;
 
-		CryptoPP::StringSource(signature + message, true,
-			new CryptoPP::SignatureVerificationFilter(KeyBase::Verifier(key), new CryptoPP::ArraySink((CryptoPP::byte*)&result, sizeof(result)))
-		);
+	// -- Account Table --
+
+
+	// Storage for the account table
+	std::deque<AccountTable::Account> AccountTable::accounts;
+	std::unordered_map<std::string, AccountID> AccountTable::ids;
+	std::shared_mutex AccountTable::mutex;
+
+	// Function which finds (adding if necessary) the ID of an account given its public key
+	AccountID AccountTable::intern(const PublicKey& key) {
+		std::string compressed = saveCompressed(key);
+		{
+			std::shared_lock lock(mutex);
+			if(auto found = ids.find(compressed); found != ids.end())
+				return found->second;
+		}
+		return intern(std::move(compressed), key);
+	}
+
+	// Function which finds (adding if necessary) the ID of an account given its compressed point
+	AccountID AccountTable::intern(std::string_view compressed) {
+		{
+			std::shared_lock lock(mutex);
+			if(auto found = ids.find(std::string(compressed)); found != ids.end())
+				return found->second;
+		}
+		// Only decompress accounts we haven't seen before
+		return intern(std::string(compressed), loadCompressed(compressed));
+	}
 
-		return result;
+	// Function which finds the ID of an account given its compressed point (without adding it)
+	std::optional<AccountID> AccountTable::find(std::string_view compressed) {
+		std::shared_lock lock(mutex);
+		if(auto found = ids.find(std::string(compressed)); found != ids.end())
+			return found->second;
+		return {};
 	}
 
+	// Function which adds an account to the table
+	AccountID AccountTable::intern(std::string compressed, const PublicKey& key) {
+		// Hash the key and prepare its verifier outside of the lock
+		std::string keyHash = key::hash(key);
+		auto verifier = Scheme::makeVerifier(key);
+
+		std::unique_lock lock(mutex);
+		// Someone may have added the account while we weren't holding the lock
+		if(auto found = ids.find(compressed); found != ids.end())
+			return found->second;
+
+		AccountID id = accounts.size();
+		accounts.push_back({compressed, key, std::move(keyHash), std::move(verifier)});
+		ids.emplace(std::move(compressed), id);
+		return id;
+	}
+
+	// Function which finds the entry for an account
+	const AccountTable::Account& AccountTable::get(AccountID id) {
+		std::shared_lock lock(mutex);
+		if(id >= accounts.size())
+			throw InvalidKey("Account " + std::to_string(id) + " is not in the account table.");
+		return accounts[id];
+	}
+
+	// Function which finds the public key of an account
+	const PublicKey& AccountTable::lookup(AccountID id) { return get(id).key; }
+	// Function which finds the compressed point of an account
+	const std::string& AccountTable::compressed(AccountID id) { return get(id).compressed; }
+	// Function which finds the hash (see key::hash) of an account
+	const std::string& AccountTable::hash(AccountID id) { return get(id).hash; }
+	// Function which finds the cached verifier of an account
+	const Scheme::Verifier& AccountTable::verifier(AccountID id) { return *get(id).verifier; }
+
 } // key
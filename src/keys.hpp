@@ -11,22 +11,40 @@
 #ifndef KEYS_HPP
 #define KEYS_HPP
 
+#include <array>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <unordered_map>
+
 #include "utility.hpp"
-#include "cryptopp/eccrypto.h"
+#include "signature.hpp"
 #include <breep/util/serialization.hpp>
 
 namespace key {
 	// Key definitions
 	using byte = CryptoPP::byte;
-	// We are using SHA3_256 backed ECC keys
-	using KeyBase = CryptoPP::ECDSA<CryptoPP::ECP, CryptoPP::SHA3_256>;
-	using PublicKey = KeyBase::PublicKey;
-	using PrivateKey = KeyBase::PrivateKey;
-
-	/**
-	 * @brief Exception thrown when we can't generate/verify a key
-	 */
-	struct InvalidKey : public std::runtime_error { using std::runtime_error::runtime_error; };
+	// The signature scheme backing keys (ECDSA, so existing key files and peers keep working, unless the build defines KEY_SCHEME_ED25519)
+	// NOTE: the scheme determines the key and signature encodings on disk and on the wire, every node in a network must be built with the same scheme
+#ifdef KEY_SCHEME_ED25519
+	using Scheme = scheme::Ed25519;
+#else
+	using Scheme = scheme::ECDSA;
+#endif
+	using PublicKey = Scheme::PublicKey;
+	using PrivateKey = Scheme::PrivateKey;
+
+	// Size of a signature (in bytes)
+	constexpr size_t SIGNATURE_SIZE = Scheme::SIGNATURE_SIZE;
+	// Signatures are stored inline as fixed size arrays
+	using Signature = std::array<byte, SIGNATURE_SIZE>;
+
+	// Function which converts a signature produced by signMessage into its fixed size form
+	Signature toSignature(std::string_view signature);
+	// Function which views a fixed size signature as a string
+	inline std::string_view signatureView(const Signature& signature) { return { (const char*) signature.data(), signature.size() }; }
 
 	/**
 	 * @brief Pair of a public and private key
@@ -40,12 +58,12 @@ namespace key {
 	};
 
 	// Function which generates a private and public key pair
-	KeyPair generateKeyPair(const CryptoPP::OID& oid);
+	KeyPair generateKeyPair();
 
 	// Functions which print out keys
-	void print(const PrivateKey& key);
-	void print(const PublicKey& key);
-	void print(const KeyPair& pair);
+	inline void print(const PrivateKey& key) { Scheme::print(key); }
+	inline void print(const PublicKey& key) { Scheme::print(key); }
+	inline void print(const KeyPair& pair) { print(pair.pri); print(pair.pub); }
 
 	// Functions which convert keys to byte arrays
 	std::vector<byte> save(const PrivateKey& key);
@@ -54,6 +72,10 @@ namespace key {
 	std::vector<byte> save(const PrivateKey& pri, const PublicKey& pub);
 	inline std::vector<byte> save(const KeyPair& pair) { return save(pair.pri, pair.pub); }
 
+	// Functions which convert public keys to and from their compressed point
+	inline std::string saveCompressed(const PublicKey& key) { return Scheme::encodePublic(key); }
+	inline PublicKey loadCompressed(std::string_view compressed) { return Scheme::decodePublic(compressed); }
+
 	// Functions which convert a public key into a hash
 	inline std::string hash(const PublicKey& key) { return util::hash( util::bytes2string(key::save(key)) ); }
 	inline std::string hash(const KeyPair& pair) { return hash(pair.pub); }
@@ -74,11 +96,66 @@ namespace key {
 	inline KeyPair load(const std::vector<byte>&& source) { return load({source, true}); }
 
 	// Function which signs a message
-	std::string signMessage(const PrivateKey& key, const std::string& message);
-	inline std::string signMessage(const KeyPair& pair, const std::string& message) { return signMessage(pair.pri, message); }
+	inline std::string signMessage(const PrivateKey& key, std::string_view message) { return Scheme::sign(key, message); }
+	inline std::string signMessage(const KeyPair& pair, std::string_view message) { return signMessage(pair.pri, message); }
 	// Function which verifies that the given message is correctly signed
-	bool verifyMessage(const PublicKey& key, const std::string& message, const std::string& signature);
-	inline bool verifyMessage(const KeyPair& pair, const std::string& message, const std::string& signature) { return verifyMessage(pair.pub, message, signature); }
+	inline bool verifyMessage(const PublicKey& key, std::string_view message, std::string_view signature) { return Scheme::verify(key, message, signature); }
+	inline bool verifyMessage(const KeyPair& pair, std::string_view message, std::string_view signature) { return verifyMessage(pair.pub, message, signature); }
+
+	// A signature to be checked as part of a batch
+	using VerificationJob = scheme::VerificationJob<Scheme::Verifier>;
+	// Function which verifies that every message in the batch is correctly signed
+	inline bool verifyBatch(std::span<const VerificationJob> jobs) { return Scheme::verifyBatch(jobs); }
+
+
+	// -- Account Table --
+
+
+	// Accounts referenced by transactions are interned and referred to by ID
+	using AccountID = uint32_t;
+	// ID of an account which hasn't been interned (yet)
+	constexpr AccountID INVALID_ACCOUNT = std::numeric_limits<AccountID>::max();
+
+	/**
+	 * @brief Process wide, thread safe table of every account referenced by a transaction
+	 * @note Each account is stored once (as its compressed point, loaded key, and hash), transactions only store its ID
+	 * @note Entries are never removed, so accounts from the network are only interned once a transaction referencing them has been validated (see Transaction::internAccounts)
+	 */
+	struct AccountTable {
+		static AccountID intern(const PublicKey& key);
+		static AccountID intern(std::string_view compressed);
+		static std::optional<AccountID> find(std::string_view compressed);
+
+		static const PublicKey& lookup(AccountID id);
+		static const std::string& compressed(AccountID id);
+		static const std::string& hash(AccountID id);
+		static const Scheme::Verifier& verifier(AccountID id);
+
+	private:
+		// Entry in the table
+		struct Account {
+			std::string compressed;
+			PublicKey key;
+			std::string hash;
+			// Verifier (with any precomputation the scheme supports) reused for every signature made by the account
+			std::unique_ptr<const Scheme::Verifier> verifier;
+		};
+
+		// Storage backing the table (a deque so that references to entries stay valid as it grows)
+		static std::deque<Account> accounts;
+		// Map from compressed points to their IDs
+		static std::unordered_map<std::string, AccountID> ids;
+		// Mutex protecting the table
+		static std::shared_mutex mutex;
+
+		static AccountID intern(std::string compressed, const PublicKey& key);
+		static const Account& get(AccountID id);
+	};
+
+	// Function which verifies that the given message is correctly signed by a known account (using its cached verifier)
+	inline bool verifyMessage(AccountID account, std::string_view message, std::string_view signature) {
+		return Scheme::verify(AccountTable::verifier(account), scheme::bytes(message), scheme::bytes(signature));
+	}
 
 } // key
 
@@ -0,0 +1,208 @@
+/**
+ * @file load.cpp
+ * @author Joshua Dahl (jdahl@unr.edu)
+ * @brief Code backing load.hpp
+ * @version 0.1
+ * @date 2021-12-14
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#include "load.hpp"
+
+#include <iomanip>
+
+/**
+ * @brief Starts generating load
+ *
+ * @param t - The tangle to add transactions to (paid for by its personal keys)
+ * @param options - The shape of the load
+ */
+LoadGenerator::LoadGenerator(NetworkedTangle& t, Options options) : options(options), t(t), start(std::chrono::steady_clock::now()), intervalStart(start) {
+	if(options.rate <= 0 || options.workers == 0 || options.minDifficulty > options.maxDifficulty || options.minAmount <= 0 || options.minAmount > options.maxAmount)
+		throw std::invalid_argument("Invalid load generator options");
+
+	if(options.arrival == Open)
+		arrivalThread = std::thread([this](){ arrivals(); });
+	for(size_t i = 0; i < options.workers; i++)
+		workerThreads.emplace_back([this, i](){ work(i); });
+	reportThread = std::thread([this](){ report(); });
+}
+
+LoadGenerator::~LoadGenerator() { stop(); }
+
+/**
+ * @brief Stops generating load, waiting for transactions which are being mined to finish (arrivals still waiting for a worker are abandoned)
+ */
+void LoadGenerator::stop(){
+	{
+		std::scoped_lock lock(mutex);
+		if(!running) return;
+		running = false;
+		stopped = std::chrono::steady_clock::now();
+	}
+	changed.notify_all();
+
+	if(arrivalThread.joinable()) arrivalThread.join();
+	for(auto& worker: workerThreads)
+		worker.join();
+	reportThread.join();
+}
+
+/**
+ * @brief Function which provides statistics covering everything since the generator started (until it was stopped)
+ */
+LoadGenerator::Statistics LoadGenerator::statistics() const {
+	std::scoped_lock lock(mutex);
+	auto out = summarize(latencies, added, (running ? std::chrono::steady_clock::now() : stopped) - start);
+	out.failed = failed;
+	out.dropped = dropped;
+	out.backlog = backlog.size();
+	return out;
+}
+
+/**
+ * @brief Function which (in its own thread) schedules open loop arrivals, exponentially distributed time apart
+ */
+void LoadGenerator::arrivals(){
+	std::mt19937 rng(std::random_device{}());
+	std::exponential_distribution<double> gap(options.rate);
+
+	std::unique_lock lock(mutex);
+	auto next = std::chrono::steady_clock::now();
+	while(running){
+		next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(gap(rng)));
+		if(changed.wait_until(lock, next, [this]{ return !running; })) break;
+
+		if(backlog.size() >= LOAD_MAX_BACKLOG) dropped++;
+		else {
+			backlog.push_back(next);
+			changed.notify_all();
+		}
+	}
+}
+
+/**
+ * @brief Function which (in its own thread) mines and adds transactions
+ *
+ * @param worker - The index of this worker
+ */
+void LoadGenerator::work(size_t worker){
+	std::mt19937 rng(std::random_device{}() + worker);
+	// Each closed loop worker is responsible for an equal share of the target rate
+	auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(options.workers / options.rate));
+
+	std::unique_lock lock(mutex);
+	auto next = std::chrono::steady_clock::now();
+	while(running){
+		std::chrono::steady_clock::time_point arrived;
+		if(options.arrival == Open){
+			changed.wait(lock, [this]{ return !running || !backlog.empty(); });
+			if(!running) break;
+			arrived = backlog.front();
+			backlog.pop_front();
+		} else {
+			// Never try to catch up on time lost to slow transactions (that would be open loop)
+			next = std::max(next, std::chrono::steady_clock::now());
+			if(changed.wait_until(lock, next, [this]{ return !running; })) break;
+			arrived = std::chrono::steady_clock::now();
+			next = arrived + interval;
+		}
+
+		lock.unlock();
+		bool success = submit(rng);
+		lock.lock();
+		complete(arrived, success);
+	}
+}
+
+/**
+ * @brief Function which creates, mines, and adds a single transaction to a random peer (or ourselves if we don't know any peers)
+ *
+ * @param rng - Random number generator used to pick the recipient, amount, and difficulty
+ * @return bool - True if the transaction was added to the tangle
+ */
+bool LoadGenerator::submit(std::mt19937& rng){
+	std::uniform_real_distribution<double> amounts(options.minAmount, options.maxAmount);
+	std::uniform_int_distribution<int> difficulties(options.minDifficulty, options.maxDifficulty);
+	double amount = amounts(rng);
+
+	try {
+		// Choose who to pay
+		key::AccountID recipient = key::AccountTable::intern(t.personalKeys->pub);
+		{
+			std::vector<boost::uuids::uuid> peers;
+			for(auto& [id, peer]: t.network.peers())
+				peers.push_back(id);
+			if(!peers.empty())
+				if(auto account = t.peerKeys.find(peers[std::uniform_int_distribution<size_t>(0, peers.size() - 1)(rng)]))
+					recipient = *account;
+		}
+
+		std::vector<Transaction::Input> inputs;
+		inputs.emplace_back(*t.personalKeys, amount);
+		std::vector<Transaction::Output> outputs;
+		outputs.emplace_back(recipient, amount);
+		t.add(TransactionNode::createAndMine(t, inputs, outputs, difficulties(rng)));
+		return true;
+	} catch (std::exception& e) {
+		std::cerr << "Generated transaction discarded" << std::endl << "\t" << e.what() << std::endl;
+		return false;
+	}
+}
+
+/**
+ * @brief Function which records a finished transaction
+ * @note Must be called with the mutex held
+ */
+void LoadGenerator::complete(std::chrono::steady_clock::time_point arrived, bool success){
+	if(!success){
+		failed++;
+		return;
+	}
+
+	double latency = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - arrived).count();
+	added++;
+	intervalAdded++;
+	latencies.push_back(latency);
+	intervalLatencies.push_back(latency);
+}
+
+/**
+ * @brief Function which (in its own thread) periodically prints the rate achieved and the latencies seen since the last report
+ */
+void LoadGenerator::report(){
+	std::unique_lock lock(mutex);
+	while(!changed.wait_for(lock, LOAD_REPORT_INTERVAL, [this]{ return !running; })){
+		auto now = std::chrono::steady_clock::now();
+		auto interval = summarize(std::move(intervalLatencies), intervalAdded, now - intervalStart);
+		intervalLatencies.clear();
+		intervalAdded = 0;
+		intervalStart = now;
+
+		std::cout << std::fixed << std::setprecision(1) << "[load] " << interval.rate() << "/" << options.rate << " transactions/s, latency p50 " << interval.p50 << " ms p99 "
+			<< interval.p99 << " ms max " << interval.max << " ms, backlog " << backlog.size() << ", " << added << " added, " << failed << " failed, " << dropped << " dropped" << std::endl
+			<< std::defaultfloat;
+	}
+}
+
+/**
+ * @brief Function which summarizes a set of latencies
+ *
+ * @param latencies - The latencies (in milliseconds) to summarize
+ * @param added - The number of transactions added over the period
+ * @param elapsed - The length of the period
+ */
+LoadGenerator::Statistics LoadGenerator::summarize(std::vector<double> latencies, size_t added, std::chrono::duration<double> elapsed){
+	Statistics out;
+	out.added = added;
+	out.elapsed = elapsed;
+	if(latencies.empty()) return out;
+
+	std::sort(latencies.begin(), latencies.end());
+	auto percentile = [&](double p){ return latencies[std::min(latencies.size() - 1, size_t(p * latencies.size()))]; };
+	out.p50 = percentile(.5);
+	out.p99 = percentile(.99);
+	out.max = latencies.back();
+	return out;
+}
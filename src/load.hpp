@@ -0,0 +1,103 @@
+/**
+ * @file load.hpp
+ * @author Joshua Dahl (jdahl@unr.edu)
+ * @brief File which provides a rate controlled generator of transactions, used to put a tangle (and its network) under a known load
+ * @version 0.1
+ * @date 2021-12-14
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#ifndef LOAD_HPP
+#define LOAD_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <random>
+
+#include "networking.hpp"
+
+// How often the generator prints its statistics while running
+#define LOAD_REPORT_INTERVAL std::chrono::seconds(1)
+// Number of arrivals which may be waiting for a worker before new arrivals are dropped (open loop only)
+#define LOAD_MAX_BACKLOG 1024
+
+/**
+ * @brief Generator which creates, mines, and adds transactions to a tangle at a target rate, paying random peers
+ * @note Open loop arrivals are scheduled independently of how quickly transactions are completed (a Poisson process), so an overloaded tangle builds a backlog and its latency includes the time spent waiting for a worker
+ * @note Closed loop workers each start their next transaction once the previous one is done (and its share of the target rate allows), so the load adapts to the tangle's speed
+ */
+struct LoadGenerator {
+	// How new transactions arrive
+	enum Arrival { Open, Closed };
+
+	/**
+	 * @brief The shape of the generated load
+	 */
+	struct Options {
+		// Target number of transactions per second
+		double rate = 10;
+		Arrival arrival = Open;
+		// Number of threads concurrently mining transactions
+		size_t workers = 2;
+		// Each transaction's difficulty is chosen uniformly from [minDifficulty, maxDifficulty]
+		uint8_t minDifficulty = 1, maxDifficulty = 3;
+		// Each transaction's amount is chosen uniformly from [minAmount, maxAmount]
+		double minAmount = 1, maxAmount = 10;
+	};
+
+	/**
+	 * @brief Snapshot of what the generator has done
+	 */
+	struct Statistics {
+		// Number of transactions added to the tangle, rejected by it, and arrivals dropped because the backlog was full
+		size_t added = 0, failed = 0, dropped = 0;
+		// Number of arrivals waiting for a worker
+		size_t backlog = 0;
+		// Time period the statistics cover
+		std::chrono::duration<double> elapsed = {};
+		// Latencies (in milliseconds) from arrival to the transaction being added to the tangle
+		double p50 = 0, p99 = 0, max = 0;
+
+		double rate() const { return elapsed.count() > 0 ? added / elapsed.count() : 0; }
+	};
+
+	// The options the generator was started with
+	const Options options;
+
+	LoadGenerator(NetworkedTangle& t, Options options);
+	~LoadGenerator();
+
+	void stop();
+	Statistics statistics() const;
+
+protected:
+	// The tangle transactions are added to
+	NetworkedTangle& t;
+	// Flag which tells every thread to stop
+	bool running = true;
+	// Mutex protecting everything below, and the condition signaled when there are new arrivals (or the generator is stopping)
+	mutable std::mutex mutex;
+	std::condition_variable changed;
+
+	// When each waiting arrival arrived
+	std::deque<std::chrono::steady_clock::time_point> backlog;
+	// Totals since the generator started, and since the last report
+	size_t added = 0, failed = 0, dropped = 0, intervalAdded = 0;
+	std::vector<double> latencies, intervalLatencies;
+	std::chrono::steady_clock::time_point start, intervalStart, stopped;
+
+	// The threads generating arrivals (open loop only), mining, and reporting
+	std::thread arrivalThread, reportThread;
+	std::vector<std::thread> workerThreads;
+
+	void arrivals();
+	void work(size_t worker);
+	void report();
+	bool submit(std::mt19937& rng);
+	void complete(std::chrono::steady_clock::time_point arrived, bool success);
+
+	static Statistics summarize(std::vector<double> latencies, size_t added, std::chrono::duration<double> elapsed);
+};
+
+#endif /* end of include guard: LOAD_HPP */
@@ -13,13 +13,15 @@
 #include <fstream>
 #include <signal.h>
 
-#include "cryptopp/oids.h"
 #include "networking.hpp"
+#include "load.hpp"
+#include "mining.hpp"
+#include "faucet.hpp"
 
 // Bool marking that the handshake thread should shutdown
 bool handshakeThreadShouldRun = true;
 // Pointer to the peer-to-peer network network
-std::unique_ptr<breep::tcp::network> network;
+std::unique_ptr<transport::Network> network;
 // Reference to the thread responsible for handshaking
 std::thread handshakeThread;
 
@@ -88,9 +90,27 @@ void shutdownProcedure(int signal){
  * @brief Main function
  */
 int main(int argc, char* argv[]) {
-	// If we are given an invalid number of arguments, explain to the user how to use the program
-	if (argc != 1 && argc != 2) {
-		std::cout << "Usage: " << argv[0] << " [<target ip>]" << std::endl;
+	// Parse the arguments (an optional transport backend, capture file, mining latency budget, and target ip)
+	std::string targetIP, transportName = "breep", capturePath;
+	std::chrono::duration<double> miningBudget = CALIBRATION_DEFAULT_BUDGET;
+	bool validArguments = true;
+	for(int i = 1; i < argc; i++){
+		std::string arg = argv[i];
+		try {
+			if(arg.starts_with("--transport=")) transportName = arg.substr(12);
+			else if(arg.starts_with("--capture=")) capturePath = arg.substr(10);
+			else if(arg.starts_with("--mining-budget=")) miningBudget = std::chrono::duration<double>(std::stod(arg.substr(16)));
+			else if(targetIP.empty() && !arg.starts_with("--")) targetIP = arg;
+			else validArguments = false;
+		} catch (std::exception&) { validArguments = false; }
+	}
+
+	// If we are given invalid arguments, explain to the user how to use the program
+	if (!validArguments || (transportName != "breep" && transportName != "io_uring") || miningBudget.count() <= 0) {
+		std::cout << "Usage: " << argv[0] << " [--transport=breep|io_uring] [--capture=<file>] [--mining-budget=<seconds>] [<target ip>]" << std::endl
+			<< "\tEvery peer on a network must use the same transport (default breep)" << std::endl
+			<< "\t--capture records everything received from peers to <file> (replay it with tangle_replay)" << std::endl
+			<< "\t--mining-budget is how long mining a transaction at the automatic difficulty should usually take (default 1 second)" << std::endl;
 		return 1;
 	}
 
@@ -118,8 +138,19 @@ int main(int argc, char* argv[]) {
 	std::cout << "Started handshake listener on port " << handshakePort << std::endl;
 
 
-	// reate a network listening on the network port we found
-	network = std::make_unique<breep::tcp::network>(networkPort);
+	// Create a network listening on the network port we found (falling back to Breep if io_uring isn't supported here)
+	std::unique_ptr<transport::Transport> backend;
+	if(transportName == "io_uring")
+		try {
+			backend = std::make_unique<transport::UringTransport>(networkPort);
+		} catch (transport::Unavailable& e) { std::cerr << "The io_uring transport is unavailable, falling back to Breep" << std::endl << "\t" << e.what() << std::endl; }
+	if(!backend) backend = std::make_unique<transport::BreepTransport>(networkPort);
+	std::cout << "Using the " << backend->name() << " transport" << std::endl;
+	network = std::make_unique<transport::Network>(std::move(backend));
+	if(!capturePath.empty()){
+		network->startCapture(capturePath);
+		std::cout << "Capturing received messages to: " << capturePath << std::endl;
+	}
 	// Create a network synched tangle
 	NetworkedTangle t(*network);
 
@@ -132,7 +163,7 @@ int main(int argc, char* argv[]) {
 
 		std::ifstream fin(path);
 		if(!fin){
-			t.setKeyPair(std::make_shared<key::KeyPair>( key::generateKeyPair(CryptoPP::ASN1::secp160r1()) ), /*networkSync*/ false);
+			t.setKeyPair(std::make_shared<key::KeyPair>( key::generateKeyPair() ), /*networkSync*/ false);
 			std::cout << "Generated new account" << std::endl;
 		} else {
 			t.setKeyPair(std::make_shared<key::KeyPair>( loadKeyFile(fin) ), /*networkSync*/ false);
@@ -142,51 +173,45 @@ int main(int argc, char* argv[]) {
 	}
 
 
+	// Optionally journal the tangle to disk (recovering whatever a previous run left behind)
+	bool recovered = false;
+	{
+		std::cout << "Enter relative path to your tangle journal (blank to disable persistence): ";
+		std::string path;
+		std::getline(std::cin, path);
+
+		if(!path.empty()){
+			recovered = t.enablePersistence(path);
+			std::cout << "Journaling tangle to: " << path << std::endl;
+		}
+	}
+
+
+	// Faucet which pays accounts joining the network (if we established it)
+	std::unique_ptr<Faucet> faucet;
+
 	// Establish a network if not given an IP to connect to
-	if (argc == 1) {
+	if (targetIP.empty()) {
 		// Runs the network in another thread.
 		network->awake();
 		// Create a keypair for the network
-		std::shared_ptr<key::KeyPair> networkKeys = std::make_shared<key::KeyPair>(key::generateKeyPair(CryptoPP::ASN1::secp160r1()));
-
-		// Create a genesis which gives the network key "infinate" money
-		std::vector<TransactionNode::const_ptr> parents;
-		std::vector<Transaction::Input> inputs;
-		std::vector<Transaction::Output> outputs;
-		outputs.push_back({networkKeys->pub, std::numeric_limits<double>::max()});
-		t.setGenesis(TransactionNode::create(parents, inputs, outputs));
-
-		// Add a key response listener that give each key that connects to the network a million money
-		network->add_data_listener<NetworkedTangle::PublicKeySyncResponse>([networkKeys, &t](breep::tcp::netdata_wrapper<NetworkedTangle::PublicKeySyncResponse>& dw){
-			std::thread([networkKeys, &t, source = dw.source](){
-				std::this_thread::sleep_for(std::chrono::milliseconds(100));
-				try {
-					// Only give the connecting peer money if they don't have any
-					if(t.queryBalance(t.peerKeys[source.id()]) == 0){
-						std::cout << "Sending `" << key::hash(t.peerKeys[source.id()]) << "` a million money!" << std::endl;
-
-						std::vector<Transaction::Input> inputs;
-						inputs.emplace_back(*networkKeys, 1000000);
-						std::vector<Transaction::Output> outputs;
-						outputs.emplace_back(t.peerKeys[source.id()], 1000000);
-						t.add(TransactionNode::createAndMine(t, inputs, outputs, 1));
-					}
-				} catch (...){}
-			}).detach();
-		});
+		std::shared_ptr<key::KeyPair> networkKeys = std::make_shared<key::KeyPair>(key::generateKeyPair());
+
+		// Create a genesis which gives the network key "infinate" money (unless we recovered an existing tangle)
+		if(!recovered){
+			std::vector<TransactionNode::const_ptr> parents;
+			std::vector<Transaction::Input> inputs;
+			std::vector<Transaction::Output> outputs;
+			outputs.push_back({networkKeys->pub, std::numeric_limits<double>::max()});
+			t.setGenesis(TransactionNode::create(parents, inputs, outputs));
+		}
 
-		// Send us a million money
-		std::thread([networkKeys, &t](){
-			std::cout << "Sending us a million money!" << std::endl;
-
-			try {
-				std::vector<Transaction::Input> inputs;
-				inputs.emplace_back(*networkKeys, 1000000);
-				std::vector<Transaction::Output> outputs;
-				outputs.emplace_back(*t.personalKeys, 1000000);
-				t.add(TransactionNode::createAndMine(t, inputs, outputs, 1));
-			} catch (...){}
-		}).detach();
+		// Give each key that connects to the network (and ourselves) a million money, paying everyone who joins around the same time with one transaction
+		faucet = std::make_unique<Faucet>(t, networkKeys, 1000000);
+		network->add_data_listener<NetworkedTangle::PublicKeySyncResponse>([faucet = faucet.get()](transport::netdata_wrapper<NetworkedTangle::PublicKeySyncResponse>& dw){
+			faucet->credit(dw.source.id());
+		});
+		faucet->credit(key::AccountTable::intern(t.personalKeys->pub));
 
 		std::cout << "Established a network on port " << networkPort << std::endl;
 
@@ -195,7 +220,7 @@ int main(int argc, char* argv[]) {
 		std::cout << "Attempting to automatically connect to the network..." << std::endl;
 
 		// Find network connection (if we can't quickly find one ask for a manual port number)
-		boost::asio::ip::address address = boost::asio::ip::address::from_string(argv[1]);
+		boost::asio::ip::address address = boost::asio::ip::address::from_string(targetIP);
 		unsigned short remotePort = handshake::determineRemotePort(io_service, address);
 		if(!network->connect(address, remotePort)){ // TODO: Hangs on invalid connection
 			std::cout << "Failed to connect to the network" << std::endl;
@@ -222,6 +247,15 @@ int main(int argc, char* argv[]) {
 	std::cout << "Press `h` for additional instruction" << std::endl;
 
 
+	// Service which mines (and adds) the transactions we create in the background
+	MiningService mining(t);
+	// Calibrator which picks the difficulty transactions are automatically mined at
+	DifficultyCalibrator calibrator(miningBudget);
+	std::cout << "Measured a hash rate of " << calibrator.hashRate() << " hashes/s, transactions will automatically be mined at difficulty " << int(calibrator.difficulty())
+		<< " (within " << miningBudget.count() << " seconds)" << std::endl;
+	// Load generator started by the (p)roduce load command (if running)
+	std::unique_ptr<LoadGenerator> load;
+
 	// Menu loop
 	char cmd;
 	while((cmd = tolower(std::cin.get())) != 'q') {
@@ -268,10 +302,11 @@ int main(int argc, char* argv[]) {
 					<< "(h)elp - Show this help message" << std::endl
 					<< "(g)enerate - Generates the Latest Common Genesis and prunes the tangle" << std::endl
 					<< "(k)ey management - Options to manage your keys" << std::endl
-					<< "(p)inging toggle - Toggle weather recieved transactions should be immediately forwarded elsewhere" << std::endl << "\t(simulates a more vibrant network)" << std::endl
+					<< "(m)ining queue - Show how many transactions are waiting to be mined, and how long mining them has taken" << std::endl
+					<< "(p)roduce load - Toggle generating transactions to random peers at a target rate (stopping summarizes the load)" << std::endl << "\t(simulates a more vibrant network)" << std::endl
 					<< "(s)ave <file> - Save the tangle to a file" << std::endl
 					<< "(l)oad <file> - Loads a tangle from a file" << std::endl
-					<< "(t)ransaction - Create a new transaction" << std::endl
+					<< "(t)ransaction - Create a new transaction (mined in the background)" << std::endl
 					<< "(w)eights - Manually start propigating weights through the tangle" << std::endl
 					<< "(q)uit - Quits the program" << std::endl
 					<< std::endl
@@ -308,7 +343,7 @@ int main(int argc, char* argv[]) {
 
 				// Generate new key pair
 				if(cmd == 'g'){
-					auto keyPair = std::make_shared<key::KeyPair>( key::generateKeyPair(CryptoPP::ASN1::secp160r1()) );
+					auto keyPair = std::make_shared<key::KeyPair>( key::generateKeyPair() );
 					keyPair->validate();
 
 					// Update our key and send it to the rest of the network
@@ -343,73 +378,58 @@ int main(int argc, char* argv[]) {
 			}
 			break;
 
-		// Toggle pinging transactions
+		// Toggle load generation
 		case 'p':
 			{
-				// ID of the pining listener (used to remove it later)
-				static breep::listener_id pingingID = 0;
-				// The number of threads actively pinging
-				static std::atomic<size_t> pingingThreads = 0;
-				
-				// If we currently have pinging enabled... disable it
-				if(pingingID){
-					if(network->remove_data_listener<NetworkedTangle::AddTransactionRequest>(pingingID)){
-						pingingID = 0;
-						std::cout << "Stopped pinging transactions" << std::endl;
-					}
+				// If we are currently generating load... stop and summarize it
+				if(load){
+					load->stop();
+					auto stats = load->statistics();
+					std::cout << "Stopped generating load: " << stats.added << " transactions added in " << stats.elapsed.count() << " seconds (" << stats.rate() << "/" << load->options.rate
+						<< " transactions/s), latency p50 " << stats.p50 << " ms p99 " << stats.p99 << " ms max " << stats.max << " ms, " << stats.failed << " failed, " << stats.dropped << " dropped" << std::endl;
+					load.reset();
+					break;
+				}
 
-				// Otherwise add a new listerner to ping transactions
-				} else {
-					pingingID = network->add_data_listener<NetworkedTangle::AddTransactionRequest>([&t] (breep::tcp::netdata_wrapper<NetworkedTangle::AddTransactionRequest>& dw) -> void {
-						// Calculate how much we recieved from this transaction
-						double recieved = 0;
-						for(const Transaction::Output& output: dw.data.transaction.outputs)
-							recieved += output.amount;
-
-						// Only allow there to be 1 active pinging threads
-						if(pingingThreads < 1)
-							std::thread([&t, recieved, hash = dw.data.transaction.hash](){
-								// Increment the thread count
-								pingingThreads++;
-								std::this_thread::sleep_for(std::chrono::milliseconds(100));
-
-								// Check that the transaction was approved
-								if(t.find(hash) && network->peers().size()){
-									size_t id = rand() % network->peers().size();
-									auto chosen = network->peers().begin();
-									for(int i = 0; i < id; i++) chosen++;
-
-									auto account = t.peerKeys[chosen->second.id()];
-
-									try{
-										// Create transaction inputs and outputs
-										std::vector<Transaction::Input> inputs;
-										inputs.emplace_back(*t.personalKeys, recieved);
-										std::vector<Transaction::Output> outputs;
-										outputs.emplace_back(account, recieved);
-
-										// Create, mine, and add the transaction
-										std::cout << "Pinging " << recieved << " money"/*to " << key::hash(account)*/ << std::endl;
-										t.add(TransactionNode::createAndMine(t, inputs, outputs, /*difficulty*/ 3));
-									} catch (Tangle::InvalidBalance ib) {
-										std::cerr << ib.what() << " Discarding transaction!" << std::endl;
-									} catch (NetworkedTangle::InvalidAccount ia) {
-										std::cerr << ia.what() << " Discarding transaction!" << std::endl;
-									}
-								}
-
-								// Decrement the thread count
-								pingingThreads--;
-							}).detach();
-					}).id();
-
-					// If we successfully added a new ping listener... tell the user
-					if(pingingID)
-						std::cout << "Started pinging transactions" << std::endl;
+				// Otherwise ask what load to generate
+				LoadGenerator::Options options;
+				char arrival;
+				uint minDifficulty, maxDifficulty;
+				std::cout << "Enter target transactions per second: ";
+				std::cin >> options.rate;
+				std::cout << "Select (o)pen loop (transactions arrive on schedule, regardless of how quickly they complete) or (c)losed loop arrivals: ";
+				std::cin >> arrival;
+				std::cout << "Enter number of mining workers: ";
+				std::cin >> options.workers;
+				std::cout << "Enter minimum and maximum mining difficulty (1-5): ";
+				std::cin >> minDifficulty >> maxDifficulty;
+				std::cout << "Enter minimum and maximum amount to transfer: ";
+				std::cin >> options.minAmount >> options.maxAmount;
+				options.arrival = tolower(arrival) == 'c' ? LoadGenerator::Closed : LoadGenerator::Open;
+				options.minDifficulty = minDifficulty;
+				options.maxDifficulty = maxDifficulty;
+
+				try {
+					load = std::make_unique<LoadGenerator>(t, options);
+					std::cout << "Started generating load (press `p` again to stop)" << std::endl;
+				} catch (std::invalid_argument& e) {
+					std::cerr << e.what() << std::endl;
 				}
 			}
 			break;
 
+		// Mining queue
+		case 'm':
+			{
+				auto stats = mining.statistics();
+				std::cout << "Mining queue: " << stats.queued << " waiting, " << stats.mining << " being mined, " << stats.completed << " completed, " << stats.failed << " failed (parents re-selected "
+					<< stats.retargets << " times)" << std::endl
+					<< "Job latency: p50 " << stats.p50 << " ms, p99 " << stats.p99 << " ms, max " << stats.max << " ms" << std::endl
+					<< "Hash rate: " << calibrator.hashRate() << " hashes/s, automatic difficulty: " << int(calibrator.difficulty()) << " (" << calibrator.expectedLatency(calibrator.difficulty()).count()
+					<< " seconds, budget " << calibrator.budget.count() << " seconds)" << std::endl;
+			}
+			break;
+
 		// Save tangle
 		case 's':
 			{
@@ -474,17 +494,19 @@ int main(int argc, char* argv[]) {
 				std::cin >> accountHash;
 				std::cout << "Enter amount to transfer: ";
 				std::cin >> amount;
-				std::cout << "Select mining difficulty (1-5): ";
+				std::cout << "Select mining difficulty (1-5, 0 for automatic [currently " << int(calibrator.difficulty()) << "]): ";
 				std::cin >> difficulty;
+				if(difficulty == 0) difficulty = calibrator.difficulty();
 
 				// If they asked for random choose a random account
-				if(accountHash == "r" && !network->peers().empty()){
-					size_t id = rand() % network->peers().size();
-					auto chosen = network->peers().begin();
+				auto peers = network->peers();
+				if(accountHash == "r" && !peers.empty()){
+					size_t id = rand() % peers.size();
+					auto chosen = peers.begin();
 					for(int i = 1; i < id; i++) chosen++;
 
-					if(t.peerKeys.contains(chosen->second.id()))
-						accountHash = key::hash(t.peerKeys[chosen->second.id()]);
+					if(auto account = t.peerKeys.find(chosen->second.id()))
+						accountHash = key::AccountTable::hash(*account);
 				}
 				// If we failed to find a random account to send to... send to ourselves
 				if(accountHash == "r")
@@ -497,11 +519,19 @@ int main(int argc, char* argv[]) {
 					std::vector<Transaction::Output> outputs;
 					outputs.emplace_back(t.findAccount(accountHash), amount);
 
-					// Create, mine, and add the transaction
+					// Queue the transaction to be mined (in the background) and added
 					std::cout << "Sending " << amount << " money to " << accountHash << std::endl;
-					t.add(TransactionNode::createAndMine(t, inputs, outputs, difficulty));
-				} catch (Tangle::InvalidBalance ib) {
-					std::cerr << ib.what() << " Discarding transaction!" << std::endl;
+					mining.submit(std::move(inputs), std::move(outputs), difficulty, [](const MiningService::Result& result){
+						try {
+							if(result.error) std::rethrow_exception(result.error);
+							std::cout << "Mined and added transaction with hash `" << result.node->hash << "` in " << result.mining.count() << " seconds (queued for "
+								<< result.queued.count() << " seconds, parents re-selected " << result.retargets << " times)" << std::endl;
+						} catch (Tangle::InvalidBalance& ib) {
+							std::cerr << ib.what() << " Discarding transaction!" << std::endl;
+						} catch (std::exception& e) {
+							std::cerr << "Failed to mine transaction" << std::endl << "\t" << e.what() << std::endl;
+						}
+					});
 				} catch (NetworkedTangle::InvalidAccount ia) {
 					std::cerr << ia.what() << " Discarding transaction!" << std::endl;
 				}
@@ -521,5 +551,10 @@ int main(int argc, char* argv[]) {
 	}
 
 	// Clean up
+	load.reset();
+	mining.stop();
+	try {
+		t.syncJournal();
+	} catch (std::exception& e) { std::cerr << "Failed to journal the tangle" << std::endl << "\t" << e.what() << std::endl; }
 	shutdownProcedure(0);
 }
@@ -0,0 +1,290 @@
+/**
+ * @file mining.cpp
+ * @author Joshua Dahl (jdahl@unr.edu)
+ * @brief Code backing mining.hpp
+ * @version 0.1
+ * @date 2021-12-15
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#include "mining.hpp"
+
+#include <cmath>
+
+/**
+ * @brief Starts the worker threads
+ *
+ * @param t - The tangle mined transactions are added to
+ * @param workers - The number of transactions which can be mined at once
+ */
+MiningService::MiningService(NetworkedTangle& t, size_t workers) : t(t) {
+	for(size_t i = 0; i < std::max<size_t>(workers, 1); i++)
+		this->workers.emplace_back([this](){ work(); });
+}
+
+MiningService::~MiningService() { stop(); }
+
+/**
+ * @brief Function which queues a transaction to be mined and added to the tangle
+ *
+ * @param inputs - List of Transaction::Inputs
+ * @param outputs - List of Transaction::Outputs
+ * @param difficulty - The difficulty of mining the transaction
+ * @param callback - Function called with the result once the transaction has been added (or failed to be)
+ */
+void MiningService::submit(std::vector<Transaction::Input> inputs, std::vector<Transaction::Output> outputs, uint8_t difficulty, Callback callback){
+	{
+		std::scoped_lock lock(mutex);
+		if(running){
+			jobs.push_back({ std::move(inputs), std::move(outputs), difficulty, std::move(callback), std::chrono::steady_clock::now() });
+			changed.notify_one();
+			return;
+		}
+	}
+
+	// If the service has stopped, fail the job immediately
+	Result result;
+	result.error = std::make_exception_ptr(Stopped());
+	callback(result);
+}
+
+/**
+ * @brief Function which queues a transaction to be mined and added to the tangle
+ *
+ * @param inputs - List of Transaction::Inputs
+ * @param outputs - List of Transaction::Outputs
+ * @param difficulty - The difficulty of mining the transaction
+ * @return std::future<Result> - The result once the transaction has been added (rethrows the error if it failed to be)
+ */
+std::future<MiningService::Result> MiningService::submit(std::vector<Transaction::Input> inputs, std::vector<Transaction::Output> outputs, uint8_t difficulty){
+	auto promise = std::make_shared<std::promise<Result>>();
+	auto future = promise->get_future();
+	submit(std::move(inputs), std::move(outputs), difficulty, [promise](const Result& result){
+		if(result.error) promise->set_exception(result.error);
+		else promise->set_value(result);
+	});
+	return future;
+}
+
+/**
+ * @brief Stops the service, jobs being mined are abandoned at their next slice and jobs still queued fail with MiningService::Stopped
+ */
+void MiningService::stop(){
+	std::deque<Job> abandoned;
+	{
+		std::scoped_lock lock(mutex);
+		if(!running) return;
+		running = false;
+		std::swap(abandoned, jobs);
+	}
+	changed.notify_all();
+
+	for(auto& worker: workers)
+		worker.join();
+
+	Result result;
+	result.error = std::make_exception_ptr(Stopped());
+	for(auto& job: abandoned)
+		job.callback(result);
+}
+
+/**
+ * @brief Function which provides the state of the queue and the latencies of every job completed so far
+ */
+MiningService::Statistics MiningService::statistics() const {
+	std::scoped_lock lock(mutex);
+	Statistics out;
+	out.queued = jobs.size();
+	out.mining = mining;
+	out.completed = completed;
+	out.failed = failed;
+	out.retargets = retargets;
+	if(latencies.empty()) return out;
+
+	std::vector<double> sorted = latencies;
+	std::sort(sorted.begin(), sorted.end());
+	auto percentile = [&](double p){ return sorted[std::min(sorted.size() - 1, size_t(p * sorted.size()))]; };
+	out.p50 = percentile(.5);
+	out.p99 = percentile(.99);
+	out.max = sorted.back();
+	return out;
+}
+
+/**
+ * @brief Function which (in its own thread) takes jobs off the queue and mines them
+ */
+void MiningService::work(){
+	std::unique_lock lock(mutex);
+	while(true){
+		changed.wait(lock, [this]{ return !running || !jobs.empty(); });
+		if(!running) break;
+
+		Job job = std::move(jobs.front());
+		jobs.pop_front();
+		mining++;
+
+		lock.unlock();
+		Result result = mine(job);
+		lock.lock();
+
+		mining--;
+		retargets += result.retargets;
+		if(result.error) failed++;
+		else {
+			completed++;
+			latencies.push_back(std::chrono::duration<double, std::milli>(result.queued + result.mining).count());
+		}
+
+		lock.unlock();
+		job.callback(result);
+		lock.lock();
+	}
+}
+
+/**
+ * @brief Function which mines a job's transaction and adds it to the tangle, re-selecting its parents if the tangle grows well past them first
+ *
+ * @param job - The job to mine
+ * @return Result - The mined transaction, or why it couldn't be mined
+ */
+MiningService::Result MiningService::mine(Job& job){
+	Result result;
+	auto start = std::chrono::steady_clock::now();
+	result.queued = start - job.submitted;
+
+	try {
+		// Picks the transaction's parents (and remembers how tall the tallest of them is)
+		TransactionNode::ptr node;
+		size_t parentHeight;
+		auto selectParents = [&]{
+			auto parents = TransactionNode::selectParents(t);
+			node = TransactionNode::create(parents, job.inputs, job.outputs, job.difficulty);
+			parentHeight = 0;
+			for(auto& parent: parents)
+				parentHeight = std::max(parentHeight, parent->height());
+		};
+		selectParents();
+
+		auto lastCheck = start;
+		while(!node->mineTransaction(MINING_SLICE_ATTEMPTS)){
+			{
+				std::scoped_lock lock(mutex);
+				if(!running) throw Stopped();
+			}
+
+			// Periodically check if the tangle has grown so far past our parents that approving them no longer helps confirm anything new
+			auto now = std::chrono::steady_clock::now();
+			if(now - lastCheck < MINING_STALE_CHECK_INTERVAL || result.retargets >= MINING_MAX_RETARGETS) continue;
+			lastCheck = now;
+			if(tipHeight() <= parentHeight + MINING_STALE_HEIGHT) continue;
+
+			// If so, pick new parents and start over (the inputs' signatures only cover their amounts, so they can be reused)
+			selectParents();
+			result.retargets++;
+			std::cout << "Parents of a transaction being mined went stale, restarting with new parents" << std::endl;
+		}
+
+		t.add(node);
+		result.node = node;
+	} catch (...) { result.error = std::current_exception(); }
+
+	result.mining = std::chrono::steady_clock::now() - start;
+	return result;
+}
+
+/**
+ * @brief Function which finds the height of the tallest tip in the tangle
+ */
+size_t MiningService::tipHeight() const {
+	size_t max = 0;
+	for(auto [i, tipLock] = std::make_pair(size_t(0), util::mutable_cast(t.tips).read_lock()); i < tipLock->size(); i++)
+		max = std::max(max, tipLock[i]->height());
+	return max;
+}
+
+
+// -- Difficulty Calibration --
+
+
+/**
+ * @brief Measures the hash rate (and starts periodically re-measuring it)
+ *
+ * @param budget - How long mining a transaction should (usually) take
+ * @param recalibrate - Whether the hash rate should be periodically re-measured in the background
+ */
+DifficultyCalibrator::DifficultyCalibrator(std::chrono::duration<double> budget, bool recalibrate) : budget(budget) {
+	sample = createSample();
+	measure();
+
+	if(recalibrate)
+		recalibrationThread = std::thread([this](){
+			std::unique_lock lock(mutex);
+			while(!stopped.wait_for(lock, CALIBRATION_INTERVAL, [this]{ return !running; })){
+				lock.unlock();
+				measure();
+				lock.lock();
+			}
+		});
+}
+
+/**
+ * @brief Function which creates the transaction mined to measure the hash rate
+ * @note Shaped like a typical transfer (one input, one output) at the highest difficulty we choose, so the benchmark runs the same validation as real mining.
+ * 	(At that difficulty a benchmark is all but certain to exhaust its attempts, one which gets lucky is handled by measure)
+ */
+TransactionNode::ptr DifficultyCalibrator::createSample(){
+	auto pair = key::generateKeyPair();
+	return TransactionNode::create({}, { {pair, 1} }, { {pair.pub, 1} }, MINING_MAX_DIFFICULTY);
+}
+
+DifficultyCalibrator::~DifficultyCalibrator() {
+	{
+		std::scoped_lock lock(mutex);
+		running = false;
+	}
+	stopped.notify_all();
+	if(recalibrationThread.joinable()) recalibrationThread.join();
+}
+
+/**
+ * @brief Function which benchmarks mining and folds the result into the hash rate
+ * @note Competes for the CPU with anything else running (like other miners), so the rate reflects the load on the machine
+ *
+ * @return double - The hash rate this benchmark measured
+ */
+double DifficultyCalibrator::measure(){
+	std::scoped_lock lock(sampleMutex);
+	size_t firstNonce = sample->nonce;
+	auto start = std::chrono::steady_clock::now();
+	bool mined = sample->mineTransaction(CALIBRATION_ATTEMPTS);
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	// The nonce counts the attempts actually made (fewer than CALIBRATION_ATTEMPTS if the sample was mined)
+	double measured = std::max<size_t>(sample->nonce - firstNonce, 1) / std::max(elapsed.count(), 1e-9);
+	// Once mined the sample can't be benchmarked again, replace it
+	if(mined) sample = createSample();
+
+	// Smooth the rate so one unlucky benchmark doesn't swing the difficulty
+	double previous = rate;
+	rate = previous == 0 ? measured : previous + CALIBRATION_SMOOTHING * (measured - previous);
+	return measured;
+}
+
+/**
+ * @brief Function which calculates how long mining a transaction at <difficulty> will take (CALIBRATION_QUANTILE of the time)
+ */
+std::chrono::duration<double> DifficultyCalibrator::expectedLatency(uint8_t difficulty) const {
+	// The number of attempts needed is geometrically distributed, its quantile is the mean scaled by -ln(1 - q)
+	double attempts = std::pow(MINING_ATTEMPTS_PER_DIFFICULTY, difficulty) * -std::log(1 - CALIBRATION_QUANTILE);
+	return std::chrono::duration<double>(attempts / rate);
+}
+
+/**
+ * @brief Function which chooses the highest difficulty which can be mined within the budget (at least MINING_MIN_DIFFICULTY)
+ */
+uint8_t DifficultyCalibrator::difficulty() const {
+	uint8_t out = MINING_MIN_DIFFICULTY;
+	while(out < MINING_MAX_DIFFICULTY && expectedLatency(out + 1) <= budget)
+		out++;
+	return out;
+}
@@ -0,0 +1,153 @@
+/**
+ * @file mining.hpp
+ * @author Joshua Dahl (jdahl@unr.edu)
+ * @brief File which provides a background service that mines (and adds) transactions without blocking whoever requested them
+ * @version 0.1
+ * @date 2021-12-15
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#ifndef MINING_HPP
+#define MINING_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <future>
+
+#include "networking.hpp"
+
+// Number of nonces a worker tries before checking whether it should stop, or whether its parents have gone stale
+#define MINING_SLICE_ATTEMPTS (1 << 14)
+// How often (at most) a worker checks whether the tangle has grown past its transaction's parents
+#define MINING_STALE_CHECK_INTERVAL std::chrono::milliseconds(250)
+// How many transactions tall the tangle can grow past a transaction's parents before they are re-selected
+#define MINING_STALE_HEIGHT 3
+// Maximum number of times a single job's parents are re-selected (so a job isn't starved by a fast growing tangle)
+#define MINING_MAX_RETARGETS 8
+
+// Range of difficulties the calibrator chooses from
+#define MINING_MIN_DIFFICULTY 1
+#define MINING_MAX_DIFFICULTY 5
+// Each step of difficulty requires another leading `A` in the (base 64) hash, so takes 64 times as many attempts
+#define MINING_ATTEMPTS_PER_DIFFICULTY 64.0
+// Default mining latency budget the calibrator chooses a difficulty for
+#define CALIBRATION_DEFAULT_BUDGET std::chrono::seconds(1)
+// Fraction of transactions which should finish mining within the budget (mining time is exponentially distributed, a budget met on average is blown often)
+#define CALIBRATION_QUANTILE 0.9
+// Number of nonces each calibration benchmark tries, and how often the hash rate is re-measured
+#define CALIBRATION_ATTEMPTS (1 << 16)
+#define CALIBRATION_INTERVAL std::chrono::seconds(10)
+// Weight the newest measurement is given in the smoothed hash rate
+#define CALIBRATION_SMOOTHING 0.3
+
+/**
+ * @brief Calibrator which measures how quickly this machine can mine, and picks the highest difficulty (most weight) which can be mined within a latency budget
+ * @note The hash rate is measured by mining a representative transaction through Transaction::mineTransaction, and re-measured periodically so the difficulty follows load on the machine
+ */
+struct DifficultyCalibrator {
+	// How long mining a transaction should (usually) take
+	const std::chrono::duration<double> budget;
+
+	DifficultyCalibrator(std::chrono::duration<double> budget = CALIBRATION_DEFAULT_BUDGET, bool recalibrate = true);
+	~DifficultyCalibrator();
+
+	double measure();
+	// The (smoothed) number of hashes this machine can try per second
+	double hashRate() const { return rate; }
+	std::chrono::duration<double> expectedLatency(uint8_t difficulty) const;
+	uint8_t difficulty() const;
+
+protected:
+	std::atomic<double> rate = 0;
+	// Transaction mined to measure the hash rate (and the mutex which stops two benchmarks mining it at once)
+	TransactionNode::ptr sample;
+	std::mutex sampleMutex;
+	static TransactionNode::ptr createSample();
+
+	// Flag which tells the recalibration thread to stop (and the mutex and condition used to wake it)
+	bool running = true;
+	std::mutex mutex;
+	std::condition_variable stopped;
+	std::thread recalibrationThread;
+};
+
+/**
+ * @brief Service which mines transactions on a pool of worker threads and adds them to a tangle once mined
+ * @note Mining is done in slices, between which a worker checks if the tangle has grown well past the parents it chose, if so it re-selects tips and restarts (a stale transaction would approve nothing new)
+ */
+struct MiningService {
+	/**
+	 * @brief Exception reported to jobs abandoned because the service was stopped
+	 */
+	struct Stopped : public std::runtime_error { Stopped() : std::runtime_error("The mining service was stopped") {} };
+
+	/**
+	 * @brief The outcome of a job
+	 */
+	struct Result {
+		// The mined transaction (nullptr if the job failed)
+		TransactionNode::ptr node;
+		// Why the job failed (nullptr if it succeeded)
+		std::exception_ptr error;
+		// How long the job waited for a worker, and how long it took to mine and add
+		std::chrono::duration<double> queued = {}, mining = {};
+		// How many times the job's parents were re-selected
+		size_t retargets = 0;
+	};
+	// Function called (by the worker) once a job has finished
+	using Callback = std::function<void(const Result&)>;
+
+	/**
+	 * @brief Snapshot of the state of the service
+	 */
+	struct Statistics {
+		// Number of jobs waiting for a worker, and being mined
+		size_t queued = 0, mining = 0;
+		// Number of jobs which have finished (successfully, or not), and the total number of times parents were re-selected
+		size_t completed = 0, failed = 0, retargets = 0;
+		// Latencies (in milliseconds) from a job being submitted to its transaction being added
+		double p50 = 0, p99 = 0, max = 0;
+	};
+
+	MiningService(NetworkedTangle& t, size_t workers = std::max(1u, std::thread::hardware_concurrency()));
+	~MiningService();
+
+	void submit(std::vector<Transaction::Input> inputs, std::vector<Transaction::Output> outputs, uint8_t difficulty, Callback callback);
+	std::future<Result> submit(std::vector<Transaction::Input> inputs, std::vector<Transaction::Output> outputs, uint8_t difficulty);
+
+	void stop();
+	Statistics statistics() const;
+
+protected:
+	/**
+	 * @brief A transaction waiting to be mined
+	 */
+	struct Job {
+		std::vector<Transaction::Input> inputs;
+		std::vector<Transaction::Output> outputs;
+		uint8_t difficulty;
+		Callback callback;
+		std::chrono::steady_clock::time_point submitted;
+	};
+
+	// The tangle transactions are added to
+	NetworkedTangle& t;
+	// Flag which tells the workers to stop
+	bool running = true;
+	// Mutex protecting everything below, and the condition signaled when there are new jobs (or the service is stopping)
+	mutable std::mutex mutex;
+	std::condition_variable changed;
+
+	std::deque<Job> jobs;
+	size_t mining = 0, completed = 0, failed = 0, retargets = 0;
+	std::vector<double> latencies;
+
+	std::vector<std::thread> workers;
+
+	void work();
+	Result mine(Job& job);
+	size_t tipHeight() const;
+};
+
+#endif /* end of include guard: MINING_HPP */
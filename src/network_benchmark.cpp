@@ -0,0 +1,271 @@
+/**
+ * @file network_benchmark.cpp
+ * @author Joshua Dahl (jdahl@unr.edu)
+ * @brief Benchmark which runs several networked tangles in one process and measures how quickly transactions injected into one of them propagate to the rest
+ * @version 0.1
+ * @date 2021-12-13
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#define BOOST_BIND_GLOBAL_PLACEHOLDERS
+
+#include <sys/resource.h>
+
+#include <iomanip>
+
+#include "networking.hpp"
+
+// First port the benchmark's nodes listen on (node i listens on NETWORK_BENCHMARK_PORT + i)
+#define NETWORK_BENCHMARK_PORT 34000
+// How long the benchmark waits for the network to form, and for transactions to finish propagating, before giving up
+#define NETWORK_BENCHMARK_TIMEOUT std::chrono::seconds(30)
+// Amount of money the genesis gives the account which funds every benchmark transaction
+#define NETWORK_BENCHMARK_FUNDS 1e12
+
+/**
+ * @brief Function which creates the transport backend with the given name
+ * @exception transport::Unavailable - Thrown if the backend can't be used on this machine
+ */
+std::unique_ptr<transport::Transport> createBackend(const std::string& name, unsigned short port){
+	if(name == "io_uring") return std::make_unique<transport::UringTransport>(port);
+	if(name == "loopback") return std::make_unique<transport::LoopbackTransport>(port);
+	return std::make_unique<transport::BreepTransport>(port);
+}
+
+/**
+ * @brief Function which blocks until a predicate is true (or the benchmark's timeout elapses)
+ * @return bool - True if the predicate became true
+ */
+template<typename F>
+bool waitUntil(F&& predicate){
+	auto deadline = std::chrono::steady_clock::now() + NETWORK_BENCHMARK_TIMEOUT;
+	while(!predicate()){
+		if(std::chrono::steady_clock::now() > deadline) return false;
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	return true;
+}
+
+/**
+ * @brief Function which provides the CPU time (user + system) the process has used so far
+ */
+std::chrono::duration<double> cpuTime(){
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return std::chrono::seconds(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) + std::chrono::microseconds(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+}
+
+/**
+ * @brief A node in the benchmark's network
+ */
+struct Node {
+	transport::Network network;
+	NetworkedTangle tangle;
+
+	Node(std::unique_ptr<transport::Transport> backend) : network(std::move(backend)), tangle(network) {
+		tangle.setKeyPair(std::make_shared<key::KeyPair>( key::generateKeyPair() ), /*networkSync*/ false);
+	}
+};
+
+/**
+ * @brief Main function
+ */
+int main(int argc, char* argv[]) {
+	// Parse the arguments
+	size_t nodeCount = 3, transactionCount = 1000;
+	double rate = 100;
+	int difficulty = 1;
+	std::string transportName = "breep";
+	bool rateLimits = false, validArguments = true;
+	for(int i = 1; i < argc; i++){
+		std::string arg = argv[i];
+		try {
+			if(arg.starts_with("--nodes=")) nodeCount = std::stoul(arg.substr(8));
+			else if(arg.starts_with("--transactions=")) transactionCount = std::stoul(arg.substr(15));
+			else if(arg.starts_with("--rate=")) rate = std::stod(arg.substr(7));
+			else if(arg.starts_with("--difficulty=")) difficulty = std::stoi(arg.substr(13));
+			else if(arg.starts_with("--transport=")) transportName = arg.substr(12);
+			else if(arg == "--rate-limits") rateLimits = true;
+			else validArguments = false;
+		} catch (std::exception&) { validArguments = false; }
+	}
+
+	// If we are given invalid arguments, explain to the user how to use the program
+	if(!validArguments || nodeCount < 2 || transactionCount == 0 || rate <= 0 || difficulty < 0 || difficulty > 255
+	  || (transportName != "breep" && transportName != "io_uring" && transportName != "loopback")) {
+		std::cout << "Usage: " << argv[0] << " [--nodes=<count>] [--transactions=<count>] [--rate=<tps>] [--difficulty=<difficulty>] [--transport=breep|io_uring|loopback] [--rate-limits]" << std::endl
+			<< "\t--nodes is the number of nodes in the network (default 3, at least 2)" << std::endl
+			<< "\t--transactions is the number of transactions injected into the first node (default 1000)" << std::endl
+			<< "\t--rate is the number of transactions injected per second (default 100)" << std::endl
+			<< "\t--difficulty is the proof of work difficulty the transactions are mined with (default 1)" << std::endl
+			<< "\t--transport is the transport backend every node uses (default breep)" << std::endl
+			<< "\t--rate-limits enforces peers' transaction rate limits (by default they are disabled so the network's capacity is measured)" << std::endl;
+		return 1;
+	}
+
+	// Nodes log every message they process, the report is written to the original output stream
+	std::ostream out(std::cout.rdbuf());
+	std::cout.rdbuf(nullptr);
+
+	try {
+		// When each transaction was injected and how many nodes have accepted it (declared before the nodes, so it outlives their ingest threads)
+		std::unordered_map<std::string, size_t> indices;
+		std::vector<std::chrono::steady_clock::time_point> injected(transactionCount);
+		std::vector<size_t> acceptances(transactionCount, 0);
+		std::vector<double> latencies; // Microseconds between a transaction's injection and each remote node accepting it
+		std::chrono::steady_clock::time_point lastAccepted;
+		size_t fullyAccepted = 0;
+		std::mutex mutex;
+
+		// Create the nodes
+		std::vector<std::unique_ptr<Node>> nodes;
+		for(size_t i = 0; i < nodeCount; i++){
+			nodes.push_back(std::make_unique<Node>( createBackend(transportName, NETWORK_BENCHMARK_PORT + i) ));
+			nodes.back()->tangle.enforceRateLimits = rateLimits;
+		}
+		out << "Created " << nodeCount << " nodes using the " << nodes.front()->network.backend().name() << " transport" << std::endl;
+
+		// Give every node the same genesis, which funds the account all of the transactions are paid from
+		auto funder = std::make_shared<key::KeyPair>( key::generateKeyPair() );
+		Transaction genesis = *TransactionNode::create({}, {}, { {funder->pub, NETWORK_BENCHMARK_FUNDS} });
+		for(auto& node: nodes)
+			node->tangle.setGenesis(TransactionNode::create(node->tangle, genesis));
+
+		// Connect every node to the first (the transports introduce them to each other) and wait for the full mesh to form
+		nodes.front()->network.awake();
+		for(size_t i = 1; i < nodeCount; i++)
+			if(!nodes[i]->network.connect(boost::asio::ip::make_address("127.0.0.1"), NETWORK_BENCHMARK_PORT))
+				throw std::runtime_error("Node " + std::to_string(i) + " failed to connect to the network");
+		if(!waitUntil([&]{ return std::ranges::all_of(nodes, [&](auto& node){ return node->network.peers().size() == nodeCount - 1; }); }))
+			throw std::runtime_error("The nodes failed to form a full mesh");
+
+		// Exchange keys (so the transactions don't start out queued waiting for them)
+		for(auto& node: nodes)
+			node->network.send_object(NetworkedTangle::PublicKeySyncRequest());
+		if(!waitUntil([&]{ return std::ranges::all_of(nodes, [&](auto& node){ return node->tangle.peerKeys.size() == nodeCount - 1; }); }))
+			throw std::runtime_error("The nodes failed to exchange keys");
+		out << "Formed a full mesh" << std::endl;
+
+		// Mine the transactions ahead of time (so mining doesn't limit the injection rate), against a scratch copy of the tangle
+		std::vector<Transaction> transactions;
+		{
+			SingleThreadedTangle scratch;
+			scratch.setGenesis(TransactionNode::create(scratch, genesis));
+			auto start = std::chrono::steady_clock::now();
+			for(size_t i = 0; i < transactionCount; i++){
+				auto& recipient = nodes[1 + i % (nodeCount - 1)]->tangle.personalKeys->pub;
+				auto node = TransactionNode::createAndMine(scratch, { {*funder, 1} }, { {recipient, 1} }, difficulty);
+				scratch.add(node);
+				transactions.push_back(*node);
+			}
+			std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+			out << "Mined " << transactionCount << " transactions in " << elapsed.count() << " seconds" << std::endl;
+		}
+
+		// Index the transactions, and track when each one was injected and how many nodes have accepted it
+		for(size_t i = 0; i < transactions.size(); i++)
+			indices[transactions[i].hash] = i;
+		for(size_t i = 1; i < nodeCount; i++)
+			nodes[i]->tangle.remoteTransactionAdded = [&](const Hash& hash){
+				auto now = std::chrono::steady_clock::now();
+				auto index = indices.find(hash);
+				if(index == indices.end()) return;
+
+				std::scoped_lock lock(mutex);
+				latencies.push_back(std::chrono::duration<double, std::micro>(now - injected[index->second]).count());
+				if(++acceptances[index->second] == nodeCount - 1){
+					fullyAccepted++;
+					lastAccepted = now;
+				}
+			};
+
+		// Measure from a clean slate
+		std::unordered_map<transport::MessageType, transport::Network::Traffic> setupTraffic;
+		for(auto& node: nodes)
+			for(auto& [type, traffic]: node->network.traffic()){
+				setupTraffic[type].messages += traffic.messages;
+				setupTraffic[type].bytes += traffic.bytes;
+			}
+		auto cpuStart = cpuTime();
+
+		// Inject the transactions into the first node at the requested rate (open loop, a slow network doesn't slow injection down)
+		out << "Injecting " << transactionCount << " transactions at " << rate << " transactions/s..." << std::endl;
+		auto& origin = nodes.front()->tangle;
+		auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1 / rate));
+		auto start = std::chrono::steady_clock::now();
+		for(size_t i = 0; i < transactionCount; i++){
+			std::this_thread::sleep_until(start + i * interval);
+			{
+				std::scoped_lock lock(mutex);
+				injected[i] = std::chrono::steady_clock::now();
+			}
+			origin.add(TransactionNode::create(origin, transactions[i]));
+		}
+		std::chrono::duration<double> injection = std::chrono::steady_clock::now() - start;
+
+		// Wait for the transactions to finish propagating
+		bool complete = waitUntil([&]{
+			std::scoped_lock lock(mutex);
+			return fullyAccepted == transactionCount;
+		});
+		for(auto& node: nodes)
+			node->tangle.waitForIngest();
+		auto cpu = cpuTime() - cpuStart;
+
+
+		// -- Report --
+
+
+		std::scoped_lock lock(mutex);
+		out << std::endl << std::fixed << std::setprecision(2);
+		if(!complete) out << "WARNING: only " << fullyAccepted << " of " << transactionCount << " transactions reached every node before timing out!" << std::endl;
+
+		std::chrono::duration<double> propagation = (fullyAccepted ? lastAccepted : std::chrono::steady_clock::now()) - start;
+		out << "Injected " << transactionCount << " transactions in " << injection.count() << " seconds (" << (transactionCount / injection.count()) << " transactions/s)" << std::endl
+			<< "Sustained " << (fullyAccepted / propagation.count()) << " transactions/s accepted by every node" << std::endl;
+
+		if(!latencies.empty()){
+			std::sort(latencies.begin(), latencies.end());
+			auto percentile = [&](double p){ return latencies[std::min(latencies.size() - 1, size_t(p * latencies.size()))] / 1000; };
+			out << "Propagation latency: p50 " << percentile(.5) << " ms, p99 " << percentile(.99) << " ms, max " << latencies.back() / 1000 << " ms" << std::endl;
+		}
+		out << "CPU time: " << cpu.count() << " seconds (" << (cpu.count() * 1000000 / transactionCount) << " us/transaction across all nodes)" << std::endl;
+
+		// Break the traffic sent during the measurement down by message type
+		std::unordered_map<transport::MessageType, transport::Network::Traffic> traffic;
+		for(auto& node: nodes)
+			for(auto& [type, t]: node->network.traffic()){
+				traffic[type].messages += t.messages;
+				traffic[type].bytes += t.bytes;
+			}
+		std::vector<std::pair<transport::MessageType, std::string>> names = {
+			{ breep::type_traits<NetworkedTangle::InventoryAnnouncement>::hash_code(), "InventoryAnnouncement" },
+			{ breep::type_traits<NetworkedTangle::TransactionRequest>::hash_code(), "TransactionRequest" },
+			{ breep::type_traits<NetworkedTangle::AddTransactionRequest>::hash_code(), "AddTransactionRequest" },
+			{ breep::type_traits<NetworkedTangle::PublicKeySyncRequest>::hash_code(), "PublicKeySyncRequest" },
+			{ breep::type_traits<NetworkedTangle::PublicKeySyncResponse>::hash_code(), "PublicKeySyncResponse" },
+			{ breep::type_traits<NetworkedTangle::UpdateWeightsRequest>::hash_code(), "UpdateWeightsRequest" },
+		};
+		out << std::endl << "Traffic per transaction (all nodes):" << std::endl;
+		size_t totalMessages = 0, totalBytes = 0;
+		for(auto& [type, name]: names){
+			size_t messages = traffic[type].messages - setupTraffic[type].messages, bytes = traffic[type].bytes - setupTraffic[type].bytes;
+			totalMessages += messages;
+			totalBytes += bytes;
+			if(messages) out << "  " << std::left << std::setw(24) << name << std::right
+				<< std::setw(10) << (double(messages) / transactionCount) << " messages" << std::setw(12) << (double(bytes) / transactionCount) << " bytes" << std::endl;
+		}
+		out << "  " << std::left << std::setw(24) << "total" << std::right
+			<< std::setw(10) << (double(totalMessages) / transactionCount) << " messages" << std::setw(12) << (double(totalBytes) / transactionCount) << " bytes" << std::endl;
+
+		for(auto& node: nodes)
+			node->network.disconnect();
+		std::cout.rdbuf(out.rdbuf());
+		return complete ? 0 : 4;
+	} catch (std::exception& e) {
+		std::cout.rdbuf(out.rdbuf());
+		std::cerr << "Benchmark failed" << std::endl << "\t" << e.what() << std::endl;
+		return 3;
+	}
+}
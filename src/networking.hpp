@@ -12,9 +12,12 @@
 #define NETWORKING_HPP
 
 #include "tangle.hpp"
+#include "bloom.hpp"
+#include "scheduler.hpp"
+#include "transport.hpp"
 
-#define BOOST_BIND_GLOBAL_PLACEHOLDERS
-#include <breep/network/tcp.hpp>
+#include <boost/uuid/uuid_io.hpp>
+#include <shared_mutex>
 
 // The default port to start searching for ports at
 #define DEFAULT_PORT_NUMBER 12345;
@@ -23,6 +26,29 @@
 #define NETWORK_QUEUE_MIN_SIZE 8
 #define NETWORK_QUEUE_MAX_SIZE 1024
 
+// Number of transactions the seen transaction filter remembers (at least), and its false positive rate
+#define SEEN_FILTER_CAPACITY 16384
+#define SEEN_FILTER_FALSE_POSITIVE_RATE 0.0001
+
+// Per peer rate limits (transactions per second, and burst size) on live and bulk (synchronization) transactions
+#define INGEST_LIVE_RATE 100
+#define INGEST_LIVE_BURST 200
+#define INGEST_BULK_RATE 2000
+#define INGEST_BULK_BURST 10000
+// Maximum number of transactions each peer may have waiting to be processed in the live and bulk lanes
+#define INGEST_LIVE_QUEUE_MAX 256
+#define INGEST_BULK_QUEUE_MAX 16384
+// Number of live transactions processed for every bulk transaction when both are waiting
+#define INGEST_LIVE_SHARE 4
+
+// Maximum number of hashes a single inventory announcement or transaction request may list (the excess is dropped and charged against the sender's live rate limit)
+#define MAX_INVENTORY_PER_MESSAGE 512
+
+// Number of (randomly chosen) peers new transactions are announced to
+#define GOSSIP_FANOUT 4
+// How long we wait for a requested transaction before we are willing to request it from someone else
+#define GOSSIP_REQUEST_TIMEOUT std::chrono::seconds(5)
+
 /**
  * @brief Function which attempts to remotely read data from a sodket until the <timeout> amount of time has elapsed
  * 
@@ -82,6 +108,37 @@ namespace handshake {
 }
 
 
+// -- Account Directory --
+
+
+/**
+ * @brief Thread safe directory of the accounts belonging to connected peers
+ * @note Maintains maps from peer IDs and from key hashes (see key::hash) to accounts, so lookups never need to rehash keys
+ */
+struct AccountDirectory {
+	/**
+	 * @brief Exception thrown when a peer's account is requested before we have received their key
+	 */
+	struct UnknownPeer : public std::runtime_error { boost::uuids::uuid peer; UnknownPeer(const boost::uuids::uuid& peer): std::runtime_error("Peer `" + boost::uuids::to_string(peer) + "`'s account is not known!"), peer(peer) {} };
+
+	void set(const boost::uuids::uuid& peer, const key::PublicKey& key);
+
+	bool contains(const boost::uuids::uuid& peer) const;
+	std::optional<key::AccountID> find(const boost::uuids::uuid& peer) const;
+	key::AccountID operator[](const boost::uuids::uuid& peer) const;
+	std::optional<key::AccountID> findHash(const Hash& keyHash) const;
+	size_t size() const;
+
+protected:
+	// Map from peers to their accounts
+	std::unordered_map<boost::uuids::uuid, key::AccountID, boost::hash<boost::uuids::uuid>> peers;
+	// Map from account hashes to the accounts (and the number of peers using the account)
+	std::unordered_map<std::string, std::pair<key::AccountID, size_t>> hashes;
+	// Mutex protecting the directory
+	mutable std::shared_mutex mutex;
+};
+
+
 // -- Networked Tangle --
 
 
@@ -95,19 +152,23 @@ struct NetworkedTangle: public Tangle {
 	struct InvalidAccount : public std::runtime_error { Hash account; InvalidAccount(Hash account): std::runtime_error("Account `" + account + "` not found!"), account(account) {} };
 
 	// The network this tangle is connected to
-	breep::tcp::network& network;
+	transport::Network& network;
 
 	// This account's public and private keypair
 	const std::shared_ptr<key::KeyPair> personalKeys;
-	// Public keys for connected peers
-	std::unordered_map<boost::uuids::uuid, key::PublicKey, boost::hash<boost::uuids::uuid>> peerKeys;
+	// Accounts of connected peers
+	AccountDirectory peerKeys;
 
-	NetworkedTangle(breep::tcp::network& network);
+	NetworkedTangle(transport::Network& network);
+	~NetworkedTangle();
 
 	void setKeyPair(const std::shared_ptr<key::KeyPair>& pair, bool networkSync = true);
-	const key::PublicKey& findAccount(Hash keyHash) const;
+	key::AccountID findAccount(Hash keyHash) const;
 
 	Hash add(TransactionNode::ptr node);
+	void setGenesis(TransactionNode::ptr genesis);
+
+	void announce(const std::vector<std::string>& hashes, std::optional<boost::uuids::uuid> exclude = {});
 
 	TransactionNode::ptr createLatestCommonGenesis();
 	void prune();
@@ -115,12 +176,48 @@ struct NetworkedTangle: public Tangle {
 	void saveTangle(std::ostream& out);
 	void loadTangle(std::istream& in, size_t size);
 
+	bool enablePersistence(const std::string& path);
+	void checkpoint();
+	/**
+	 * @brief Blocks until every transaction accepted so far has been journaled to disk
+	 */
+	void syncJournal() { if(journal) journal->sync(); }
+
+	// Flag which determines if peers' transaction rates are limited (disabled when replaying captures faster than they were recorded)
+	bool enforceRateLimits = true;
+	// Optional function called (by the ingest thread) with the hash of every transaction received from the network once it has been added to the tangle
+	std::function<void(const Hash&)> remoteTransactionAdded;
+	void waitForIngest();
+
 private:
 	// Pointer to a map used for counting votes for different tangles during startup
 	std::unique_ptr<std::map<std::vector<std::string>, std::pair<boost::uuids::uuid, size_t>>> genesisVotes = nullptr;
 	// Hash we expect a genesis sync to have (invalid hash means we aren't expecting a new genesis)
 	std::string genesisSyncExpectedHash = INVALID_HASH;
 
+	// Filter of the hashes of transactions we have recently processed, checked before a request is decompressed or verified so duplicates are dropped cheaply
+	RollingBloomFilter seen = {SEEN_FILTER_CAPACITY, SEEN_FILTER_FALSE_POSITIVE_RATE};
+	// The peer we last sent our key to (forgotten when they dis/connect, since a reconnecting peer may have lost our key)
+	boost::uuids::uuid lastKeySent = {};
+	// Map of transactions we have requested (in response to an announcement) to when we requested them
+	std::unordered_map<std::string, std::chrono::steady_clock::time_point> requestedInventory;
+	// Mutex protecting the requested inventory
+	std::mutex inventoryMutex;
+
+	void requestTransactions(const transport::Peer& from, const std::vector<std::string>& hashes);
+
+	// Thread which takes the checkpoints the journal requests (owned by the tangle so a checkpoint never outlives it)
+	std::thread checkpointThread;
+	// Flags telling the checkpoint thread to take a checkpoint, or to stop (and the mutex and condition protecting them)
+	bool checkpointWanted = false, checkpointStopping = false;
+	std::mutex checkpointMutex;
+	std::condition_variable checkpointCondition;
+
+	void checkpoints();
+
+	// Peer we requested a tangle synchronization from (its synchronization transactions aren't rate limited)
+	std::optional<boost::uuids::uuid> synchronizationSource;
+
 	// Struct containing both features needed to verify a transaction's hash
 	struct HashVerificationPair {
 		boost::uuids::uuid peerID;
@@ -133,11 +230,12 @@ private:
 		HashVerificationPair pair;
 
 		TransactionAndHashVerificationPair() = default;
+		// NOTE: copying the transaction only copies handles to its (shared) contents
 		TransactionAndHashVerificationPair(const Transaction& transaction, const HashVerificationPair& pair) : transaction(transaction), pair(pair) {}
-		TransactionAndHashVerificationPair(const TransactionAndHashVerificationPair& o) : transaction(o.transaction), pair(o.pair) {}
-		TransactionAndHashVerificationPair(const TransactionAndHashVerificationPair&& o) : transaction(std::move(o.transaction)), pair(o.pair) {}
-		TransactionAndHashVerificationPair& operator=(const TransactionAndHashVerificationPair& other){ transaction = other.transaction; pair = other.pair; return *this; }
-		TransactionAndHashVerificationPair& operator=(const TransactionAndHashVerificationPair&& other){ transaction = std::move(other.transaction); pair = other.pair; return *this; }
+		TransactionAndHashVerificationPair(const TransactionAndHashVerificationPair& o) = default;
+		TransactionAndHashVerificationPair(TransactionAndHashVerificationPair&& o) = default;
+		TransactionAndHashVerificationPair& operator=(const TransactionAndHashVerificationPair& other) = default;
+		TransactionAndHashVerificationPair& operator=(TransactionAndHashVerificationPair&& other) = default;
 		bool operator==(const TransactionAndHashVerificationPair& o) const {
 			return transaction.hash == o.transaction.hash && pair.peerID == o.pair.peerID && pair.signature == o.pair.signature;
 		}
@@ -145,6 +243,35 @@ private:
 	// Queue which holds incoming transactions that weren't immediately added to the tangle
 	ModifiableQueue<TransactionAndHashVerificationPair, circular_buffer<std::vector<TransactionAndHashVerificationPair>>> networkAdditionQueue;
 
+	// Lanes of the ingest scheduler, live transactions take priority over bulk synchronization
+	enum IngestLane : size_t { LiveLane = 0, BulkLane = 1 };
+	// Struct holding a verified tangle snapshot (see TangleSnapshot) and the peer who sent it
+	struct SnapshotInstallation {
+		boost::uuids::uuid source;
+		std::string snapshot;
+	};
+	// Struct representing work for the ingest thread: a transaction to add, a snapshot to install, or (if there is neither) a request to update the tangle's weights once everything queued before it has been added
+	struct IngestRequest {
+		std::optional<TransactionAndHashVerificationPair> addition;
+		bool synchronization = false;
+		std::optional<SnapshotInstallation> snapshot;
+	};
+	// Scheduler which fairly interleaves the transactions received from each peer before they are validated and added by the ingest thread
+	FairScheduler<boost::uuids::uuid, IngestRequest, 2, boost::hash<boost::uuids::uuid>> ingestQueue = {{INGEST_LIVE_SHARE, 1}, {INGEST_LIVE_QUEUE_MAX, INGEST_BULK_QUEUE_MAX}};
+	// Thread which processes the ingest queue
+	std::thread ingestThread;
+	// Number of requests which have been queued but not yet processed by the ingest thread
+	std::atomic<size_t> ingestOutstanding = 0;
+	// Each peer's rate limits for the live and bulk lanes
+	std::unordered_map<boost::uuids::uuid, std::array<TokenBucket, 2>, boost::hash<boost::uuids::uuid>> admissionBuckets;
+	// Mutex protecting the rate limits
+	std::mutex admissionMutex;
+
+	bool admit(const boost::uuids::uuid& peer, IngestLane lane);
+	void limitInventory(const boost::uuids::uuid& peer, std::vector<std::string>& hashes);
+	bool enqueue(const boost::uuids::uuid& source, IngestLane lane, IngestRequest request, bool bounded = true);
+	void ingest();
+
 	/**
 	 * @brief Function that expands the network queue if it is getting close to running out of size
 	 */
@@ -170,14 +297,20 @@ protected:
 	 * @param network 
 	 * @param peer 
 	 */
-	void connect_disconnectListener(breep::tcp::network& network, const breep::tcp::peer& peer) {
+	void connect_disconnectListener(transport::Network& network, const transport::Peer& peer) {
+		// Whether they are new or reconnecting, they don't have our key
+		if(lastKeySent == peer.id()) lastKeySent = {};
+
 		// Someone connected...
 		if (peer.is_connected())
 			std::cout << peer.id() << " connected!" << std::endl;
 
-		// Someone disconnected...
-		else
+		// Someone disconnected... (forget their rate limits)
+		else {
 			std::cout << peer.id() << " disconnected" << std::endl;
+			std::scoped_lock lock(admissionMutex);
+			admissionBuckets.erase(peer.id());
+		}
 	}
 
 
@@ -189,10 +322,7 @@ public:
 	 * @brief Message which requests the receiver to send us their public key
 	 */
 	struct PublicKeySyncRequest {
-		// Track the person we last sent a key too
-		static boost::uuids::uuid lastSent;
-
-		static void listener(breep::tcp::netdata_wrapper<PublicKeySyncRequest>& networkData, NetworkedTangle& t);
+		static void listener(transport::netdata_wrapper<PublicKeySyncRequest>& networkData, NetworkedTangle& t);
 	};
 
 	/**
@@ -220,11 +350,11 @@ public:
 		 * @param networkData - The event received
 		 * @param t - The tangle which received the event
 		 */
-		static void listener(breep::tcp::netdata_wrapper<PublicKeySyncResponse>& networkData, NetworkedTangle& t){
+		static void listener(transport::netdata_wrapper<PublicKeySyncResponse>& networkData, NetworkedTangle& t){
 			// If the signature they provided is verified with the sent public key...
 			if(key::verifyMessage(networkData.data._key, VERIFICATION_STRING, networkData.data.signature))
 				// Mark the key as the sending peer's public key
-				t.peerKeys[networkData.source.id()] = networkData.data._key;
+				t.peerKeys.set(networkData.source.id(), networkData.data._key);
 			else std::cout << "Failed to verify key from `" << networkData.source.id() << "`" << std::endl;
 		}
 
@@ -246,7 +376,7 @@ public:
 		 * @param networkData - The event received
 		 * @param t - The tangle which received the event
 		 */
-		static void listener(breep::tcp::netdata_wrapper<GenesisVoteRequest> &networkData, NetworkedTangle &t) {
+		static void listener(transport::netdata_wrapper<GenesisVoteRequest> &networkData, NetworkedTangle &t) {
 			t.network.send_object_to(networkData.source, GenesisVoteResponse(t));
 			std::cout << "Sent genesis vote to `" << networkData.source.id() << "`" << std::endl;
 		}
@@ -265,7 +395,7 @@ public:
 		GenesisVoteResponse() = default;
 		GenesisVoteResponse(const NetworkedTangle& t);
 
-		static void listener(breep::tcp::netdata_wrapper<GenesisVoteResponse> &networkData, NetworkedTangle &t);
+		static void listener(transport::netdata_wrapper<GenesisVoteResponse> &networkData, NetworkedTangle &t);
 	};
 
 
@@ -279,7 +409,7 @@ public:
 		 * @param networkData - The event received
 		 * @param t - The tangle which received the event
 		 */
-		static void listener(breep::tcp::netdata_wrapper<TangleSynchronizeRequest>& networkData, NetworkedTangle& t){
+		static void listener(transport::netdata_wrapper<TangleSynchronizeRequest>& networkData, NetworkedTangle& t){
 			std::scoped_lock lock(t.mutex); // Can't add or remove nodes while we are sending the tangle to someone
 			// Send the tangle to the sender
 			recursiveSendTangle(networkData.source, t, t.genesis);
@@ -297,7 +427,7 @@ public:
 		 * @param t - Reference to the tangle (stores reference to the network and keys)
 		 * @param node - The current node in the recursive call
 		 */
-		static void recursiveSendTangle(const breep::tcp::peer& requester, NetworkedTangle& t, const TransactionNode::ptr& node){
+		static void recursiveSendTangle(const transport::Peer& requester, NetworkedTangle& t, const TransactionNode::ptr& node){
 			// Send this node (make it a genesis sync if it is the genesis)
 			if(node->isGenesis) t.network.send_object_to(requester, SyncGenesisRequest(*node, *t.personalKeys));
 			else t.network.send_object_to(requester, SynchronizationAddTransactionRequest(*node, *t.personalKeys));
@@ -308,20 +438,47 @@ public:
 		}
 	};
 
+	/**
+	 * @brief Message which causes the recipient to send us a snapshot of their tangle (see TangleSnapshot)
+	 */
+	struct TangleSnapshotRequest {
+		static void listener(transport::netdata_wrapper<TangleSnapshotRequest>& networkData, NetworkedTangle& t);
+	};
+
+	/**
+	 * @brief Message which bootstraps the recipient's tangle in a single transfer
+	 * @note The snapshot is the sender's genesis (the one it votes for), followed by every transaction after it (the recent subtangle), compressed into one blob
+	 * @note The sender signs the digest (hash) of the compressed blob, the balances are taken on the word of the peer the network voted for (just as a full synchronization trusts its genesis)
+	 */
+	struct TangleSnapshot {
+		// The compressed snapshot
+		std::string snapshot;
+		// Signature of the digest of the snapshot
+		std::string signature;
+
+		TangleSnapshot() = default;
+		TangleSnapshot(NetworkedTangle& t);
+
+		static void listener(transport::netdata_wrapper<TangleSnapshot>& networkData, NetworkedTangle& t);
+		static void install(const boost::uuids::uuid& source, const std::string& snapshot, NetworkedTangle& t);
+	};
+
 	/**
 	 * @brief Message which causes the tangle to update its weight
 	 */
 	struct UpdateWeightsRequest {
 		/**
-		 * @brief Listener for TangleSynchronizeRequest events. Creates a thread which trickles weights down the tangle
+		 * @brief Listener for UpdateWeightsRequest events. Queues a weight update behind the transactions the sender has already sent us
 		 * 
 		 * @param networkData - The event received
 		 * @param t - The tangle which received the event
 		 */
-		static void listener(breep::tcp::netdata_wrapper<UpdateWeightsRequest>& networkData, NetworkedTangle& t){
-			// Update all the weights (in a thread)
-			std::thread([&t](){ t.updateCumulativeWeights(); }).detach();
-			std::cout << "Started updating tangle weights" << std::endl;
+		static void listener(transport::netdata_wrapper<UpdateWeightsRequest>& networkData, NetworkedTangle& t){
+			// The request marks the end of a synchronization
+			if(t.synchronizationSource == networkData.source.id())
+				t.synchronizationSource.reset();
+
+			t.enqueue(networkData.source.id(), BulkLane, {}, /*bounded*/ false);
 		}
 	};
 
@@ -345,9 +502,29 @@ public:
 		 * @param _genesis - The transaction which should become the new genesis
 		 * @param keys - Keypair used for signing
 		 */
-		SyncGenesisRequest(Transaction& _genesis, const key::KeyPair& keys) : claimedHash(_genesis.hash), actualHash(_genesis.hashTransaction()), validitySignature(key::signMessage(keys, claimedHash + actualHash)), genesis(_genesis) {}
+		SyncGenesisRequest(Transaction& _genesis, const key::KeyPair& keys) : claimedHash(_genesis.hash), actualHash(_genesis.hashVerified ? _genesis.hash : _genesis.hashTransaction()), validitySignature(key::signMessage(keys, claimedHash + actualHash)), genesis(_genesis) {}
+
+		static void listener(transport::netdata_wrapper<SyncGenesisRequest>& networkData, NetworkedTangle& t);
+	};
+
+	/**
+	 * @brief Message which announces the hashes of transactions the sender has (the recipient requests any it is missing)
+	 */
+	struct InventoryAnnouncement {
+		// Hashes of the announced transactions
+		std::vector<std::string> hashes;
 
-		static void listener(breep::tcp::netdata_wrapper<SyncGenesisRequest>& networkData, NetworkedTangle& t);
+		static void listener(transport::netdata_wrapper<InventoryAnnouncement>& networkData, NetworkedTangle& t);
+	};
+
+	/**
+	 * @brief Message which requests the bodies of transactions (the recipient responds with an AddTransactionRequest for each transaction it has)
+	 */
+	struct TransactionRequest {
+		// Hashes of the requested transactions
+		std::vector<std::string> hashes;
+
+		static void listener(transport::netdata_wrapper<TransactionRequest>& networkData, NetworkedTangle& t);
 	};
 
 	/**
@@ -360,6 +537,10 @@ public:
 		std::string validitySignature;
 		// The transaction to add to the tangle
 		Transaction transaction;
+		// Compressed body of a received request, only decoded once the receiver knows it hasn't already seen the transaction (see decodeBody)
+		std::string body;
+		// Encoded (compressed and signed) body of the request, if it was already encoded (see TransactionNode::wireEncoding)
+		std::shared_ptr<const WireEncoding> encoded;
 
 		AddTransactionRequestBase() = default;
 		/**
@@ -369,11 +550,16 @@ public:
 		 * @param keys - Keypair used for signing
 		 */
 		AddTransactionRequestBase(Transaction& _transaction, const key::KeyPair& keys) : validityHash(_transaction.hash), validitySignature(key::signMessage(keys, validityHash)), transaction(_transaction) {}
+		AddTransactionRequestBase(const TransactionNode& node, const key::KeyPair& keys);
 
-		static void listener(breep::tcp::netdata_wrapper<AddTransactionRequestBase>& networkData, NetworkedTangle& t);
+		std::string encodeBody() const;
+		void decodeBody();
+
+		static void listener(transport::netdata_wrapper<AddTransactionRequestBase>& networkData, NetworkedTangle& t, bool synchronization = false);
+		static void process(const Transaction& transaction, HashVerificationPair validityPair, bool synchronization, NetworkedTangle& t);
 
 	protected:
-		static void attemptToAddTransaction(const Transaction& transaction, HashVerificationPair validityPair, NetworkedTangle& t);
+		static void attemptToAddTransaction(const Transaction& transaction, HashVerificationPair validityPair, bool synchronization, NetworkedTangle& t);
 	};
 
 	/**
@@ -382,8 +568,8 @@ public:
 	struct AddTransactionRequest: public AddTransactionRequestBase {
 		using AddTransactionRequestBase::AddTransactionRequestBase;
 
-		static void listener(breep::tcp::netdata_wrapper<AddTransactionRequest>& networkData, NetworkedTangle& t){
-			AddTransactionRequestBase::listener((*(breep::tcp::netdata_wrapper<AddTransactionRequestBase>*) &networkData), t);
+		static void listener(transport::netdata_wrapper<AddTransactionRequest>& networkData, NetworkedTangle& t){
+			AddTransactionRequestBase::listener((*(transport::netdata_wrapper<AddTransactionRequestBase>*) &networkData), t);
 		}
 	};
 
@@ -394,10 +580,8 @@ public:
 	struct SynchronizationAddTransactionRequest: public AddTransactionRequestBase {
 		using AddTransactionRequestBase::AddTransactionRequestBase;
 
-		static void listener(breep::tcp::netdata_wrapper<SynchronizationAddTransactionRequest>& networkData, NetworkedTangle& t){
-			t.updateWeights = false; // Flag us as NOT reclaculating weights
-			AddTransactionRequestBase::listener((*(breep::tcp::netdata_wrapper<AddTransactionRequestBase>*) &networkData), t);
-			t.updateWeights = true; // Flag us as reclaculating weights
+		static void listener(transport::netdata_wrapper<SynchronizationAddTransactionRequest>& networkData, NetworkedTangle& t){
+			AddTransactionRequestBase::listener((*(transport::netdata_wrapper<AddTransactionRequestBase>*) &networkData), t, /*synchronization*/ true);
 		}
 	};
 };
@@ -449,11 +633,48 @@ inline breep::serializer& operator<<(breep::serializer& s, const NetworkedTangle
 inline breep::deserializer& operator>>(breep::deserializer& d, NetworkedTangle::TangleSynchronizeRequest& r) { return d; }
 BREEP_DECLARE_TYPE(NetworkedTangle::TangleSynchronizeRequest)
 
+// Empty serialization (no data to send)
+inline breep::serializer& operator<<(breep::serializer& s, const NetworkedTangle::TangleSnapshotRequest& r) { return s; }
+inline breep::deserializer& operator>>(breep::deserializer& d, NetworkedTangle::TangleSnapshotRequest& r) { return d; }
+BREEP_DECLARE_TYPE(NetworkedTangle::TangleSnapshotRequest)
+
+inline breep::serializer& operator<<(breep::serializer& s, const NetworkedTangle::TangleSnapshot& r) {
+	s << r.snapshot;
+	s << r.signature;
+	return s;
+}
+inline breep::deserializer& operator>>(breep::deserializer& d, NetworkedTangle::TangleSnapshot& r) {
+	d >> r.snapshot;
+	d >> r.signature;
+	return d;
+}
+BREEP_DECLARE_TYPE(NetworkedTangle::TangleSnapshot)
+
 // Empty serialization (no data to send)
 inline breep::serializer& operator<<(breep::serializer& s, const NetworkedTangle::UpdateWeightsRequest& r) { return s; }
 inline breep::deserializer& operator>>(breep::deserializer& d, NetworkedTangle::UpdateWeightsRequest& r) { return d; }
 BREEP_DECLARE_TYPE(NetworkedTangle::UpdateWeightsRequest)
 
+inline breep::serializer& operator<<(breep::serializer& s, const NetworkedTangle::InventoryAnnouncement& r) {
+	s << r.hashes;
+	return s;
+}
+inline breep::deserializer& operator>>(breep::deserializer& d, NetworkedTangle::InventoryAnnouncement& r) {
+	d >> r.hashes;
+	return d;
+}
+BREEP_DECLARE_TYPE(NetworkedTangle::InventoryAnnouncement)
+
+inline breep::serializer& operator<<(breep::serializer& s, const NetworkedTangle::TransactionRequest& r) {
+	s << r.hashes;
+	return s;
+}
+inline breep::deserializer& operator>>(breep::deserializer& d, NetworkedTangle::TransactionRequest& r) {
+	d >> r.hashes;
+	return d;
+}
+BREEP_DECLARE_TYPE(NetworkedTangle::TransactionRequest)
+
 // In .cpp
 breep::serializer& operator<<(breep::serializer& _s, const NetworkedTangle::SyncGenesisRequest& r);
 breep::deserializer& operator>>(breep::deserializer& _d, NetworkedTangle::SyncGenesisRequest& r);
@@ -10,53 +10,173 @@
  */
 #include "networking.hpp"
 
+#include <random>
+
+// -- Account Directory --
+
+
+/**
+ * @brief Function which marks <key> as the account of <peer> (replacing any account it previously had)
+ * 
+ * @param peer - The peer who owns the key
+ * @param key - The peer's public key
+ */
+void AccountDirectory::set(const boost::uuids::uuid& peer, const key::PublicKey& key){
+    // Intern the key outside of the lock
+    key::AccountID account = key::AccountTable::intern(key);
+    const Hash& keyHash = key::AccountTable::hash(account);
+
+    std::unique_lock lock(mutex);
+    // If the peer already had an account... forget its hash (unless another peer shares it)
+    if(auto old = peers.find(peer); old != peers.end()){
+        if(old->second == account) return;
+        if(auto entry = hashes.find(key::AccountTable::hash(old->second)); entry != hashes.end() && --entry->second.second == 0)
+            hashes.erase(entry);
+    }
+
+    peers[peer] = account;
+    hashes.try_emplace(keyHash, account, 0).first->second.second++;
+}
+
+/**
+ * @brief Function which checks if we know the account of <peer>
+ */
+bool AccountDirectory::contains(const boost::uuids::uuid& peer) const {
+    std::shared_lock lock(mutex);
+    return peers.contains(peer);
+}
+
+/**
+ * @brief Function which finds the account of <peer>
+ * 
+ * @param peer - The peer to look up
+ * @return std::optional<key::AccountID> - The peer's account, or nothing if we don't know it
+ */
+std::optional<key::AccountID> AccountDirectory::find(const boost::uuids::uuid& peer) const {
+    std::shared_lock lock(mutex);
+    if(auto found = peers.find(peer); found != peers.end())
+        return found->second;
+    return {};
+}
+
+/**
+ * @brief Function which finds the account of <peer>
+ * 
+ * @param peer - The peer to look up
+ * @return key::AccountID - The peer's account
+ * @exception UnknownPeer - Thrown if we don't know the peer's account
+ */
+key::AccountID AccountDirectory::operator[](const boost::uuids::uuid& peer) const {
+    if(auto account = find(peer))
+        return *account;
+    throw UnknownPeer(peer);
+}
+
+/**
+ * @brief Function which finds the account of a peer given the hash of its key
+ * 
+ * @param keyHash - The hash to look up
+ * @return std::optional<key::AccountID> - The account, or nothing if no peer's key has the hash
+ */
+std::optional<key::AccountID> AccountDirectory::findHash(const Hash& keyHash) const {
+    std::shared_lock lock(mutex);
+    if(auto found = hashes.find(keyHash); found != hashes.end())
+        return found->second.first;
+    return {};
+}
+
+/**
+ * @brief Function which determines how many peers we know the account of
+ */
+size_t AccountDirectory::size() const {
+    std::shared_lock lock(mutex);
+    return peers.size();
+}
+
+
+// -- Networked Tangle --
+
+
 /**
  * @brief Constructor that links the network, connects network listeners, and sets up the network queue 
  * @param network The network this tangle is connected to
  */
-NetworkedTangle::NetworkedTangle(breep::tcp::network& network) : network(network) {
+NetworkedTangle::NetworkedTangle(transport::Network& network) : network(network) {
     // Make sure that the network queue has some memory backing it
     networkAdditionQueue.getContainer().resize(NETWORK_QUEUE_MIN_SIZE);
 
     // Listen to dis/connection events
-    auto connect_disconnectListenerClosure = [this] (breep::tcp::network& network, const breep::tcp::peer& peer) -> void {
+    auto connect_disconnectListenerClosure = [this] (transport::Network& network, const transport::Peer& peer) -> void {
         this->connect_disconnectListener(network, peer);
     };
     network.add_connection_listener(connect_disconnectListenerClosure);
     network.add_disconnection_listener(connect_disconnectListenerClosure);
 
     // Listen for public keys
-    network.add_data_listener<PublicKeySyncResponse>([this] (breep::tcp::netdata_wrapper<PublicKeySyncResponse>& dw) -> void {
+    network.add_data_listener<PublicKeySyncResponse>([this] (transport::netdata_wrapper<PublicKeySyncResponse>& dw) -> void {
         PublicKeySyncResponse::listener(dw, *this);
     });
-    network.add_data_listener<PublicKeySyncRequest>([this] (breep::tcp::netdata_wrapper<PublicKeySyncRequest>& dw) -> void {
+    network.add_data_listener<PublicKeySyncRequest>([this] (transport::netdata_wrapper<PublicKeySyncRequest>& dw) -> void {
         PublicKeySyncRequest::listener(dw, *this);
     });
 
     // Listen for synchronization requests
-    network.add_data_listener<GenesisVoteRequest>([this] (breep::tcp::netdata_wrapper<GenesisVoteRequest>& dw) -> void {
+    network.add_data_listener<GenesisVoteRequest>([this] (transport::netdata_wrapper<GenesisVoteRequest>& dw) -> void {
         GenesisVoteRequest::listener(dw, *this);
     });
-    network.add_data_listener<GenesisVoteResponse>([this] (breep::tcp::netdata_wrapper<GenesisVoteResponse>& dw) -> void {
+    network.add_data_listener<GenesisVoteResponse>([this] (transport::netdata_wrapper<GenesisVoteResponse>& dw) -> void {
         GenesisVoteResponse::listener(dw, *this);
     });
-    network.add_data_listener<TangleSynchronizeRequest>([this] (breep::tcp::netdata_wrapper<TangleSynchronizeRequest>& dw) -> void {
+    network.add_data_listener<TangleSynchronizeRequest>([this] (transport::netdata_wrapper<TangleSynchronizeRequest>& dw) -> void {
         TangleSynchronizeRequest::listener(dw, *this);
     });
-    network.add_data_listener<UpdateWeightsRequest>([this] (breep::tcp::netdata_wrapper<UpdateWeightsRequest>& dw) -> void {
+    network.add_data_listener<TangleSnapshotRequest>([this] (transport::netdata_wrapper<TangleSnapshotRequest>& dw) -> void {
+        TangleSnapshotRequest::listener(dw, *this);
+    });
+    network.add_data_listener<TangleSnapshot>([this] (transport::netdata_wrapper<TangleSnapshot>& dw) -> void {
+        TangleSnapshot::listener(dw, *this);
+    });
+    network.add_data_listener<UpdateWeightsRequest>([this] (transport::netdata_wrapper<UpdateWeightsRequest>& dw) -> void {
         UpdateWeightsRequest::listener(dw, *this);
     });
-    network.add_data_listener<SyncGenesisRequest>([this] (breep::tcp::netdata_wrapper<SyncGenesisRequest>& dw) -> void {
+    network.add_data_listener<SyncGenesisRequest>([this] (transport::netdata_wrapper<SyncGenesisRequest>& dw) -> void {
         SyncGenesisRequest::listener(dw, *this);
     });
-    network.add_data_listener<SynchronizationAddTransactionRequest>([this] (breep::tcp::netdata_wrapper<SynchronizationAddTransactionRequest>& dw) -> void {
+    network.add_data_listener<SynchronizationAddTransactionRequest>([this] (transport::netdata_wrapper<SynchronizationAddTransactionRequest>& dw) -> void {
         SynchronizationAddTransactionRequest::listener(dw, *this);
     });
 
     // Listen for new transactions
-    network.add_data_listener<AddTransactionRequest>([this] (breep::tcp::netdata_wrapper<AddTransactionRequest>& dw) -> void {
+    network.add_data_listener<AddTransactionRequest>([this] (transport::netdata_wrapper<AddTransactionRequest>& dw) -> void {
         AddTransactionRequest::listener(dw, *this);
     });
+    network.add_data_listener<InventoryAnnouncement>([this] (transport::netdata_wrapper<InventoryAnnouncement>& dw) -> void {
+        InventoryAnnouncement::listener(dw, *this);
+    });
+    network.add_data_listener<TransactionRequest>([this] (transport::netdata_wrapper<TransactionRequest>& dw) -> void {
+        TransactionRequest::listener(dw, *this);
+    });
+
+    // Start processing received transactions
+    ingestThread = std::thread([this](){ ingest(); });
+}
+
+/**
+ * @brief Destructor which stops the ingest thread (any transactions still waiting to be processed are discarded)
+ */
+NetworkedTangle::~NetworkedTangle(){
+    ingestQueue.close();
+    if(ingestThread.joinable()) ingestThread.join();
+
+    // Stop taking checkpoints, then close the journal (before the members its checkpoint requests touch are destroyed)
+    {
+        std::scoped_lock lock(checkpointMutex);
+        checkpointStopping = true;
+    }
+    checkpointCondition.notify_all();
+    if(checkpointThread.joinable()) checkpointThread.join();
+    std::scoped_lock lock(mutex);
+    journal.reset();
 }
 
 /**
@@ -66,21 +186,20 @@ NetworkedTangle::NetworkedTangle(breep::tcp::network& network) : network(network
  */
 void NetworkedTangle::setKeyPair(const std::shared_ptr<key::KeyPair>& pair, bool networkSync /*= true*/){
     util::mutable_cast(personalKeys) = pair;
-    peerKeys[network.self().id()] = personalKeys->pub;
+    peerKeys.set(network.self().id(), personalKeys->pub);
     if(networkSync) network.send_object(NetworkedTangle::PublicKeySyncResponse(*pair));
 }
 
 /**
- * @brief Function which finds a key given its hash
+ * @brief Function which finds an account given its hash
  * 
- * @param keyHash - The key to search for
- * @return const key::PublicKey& - The discovered key
- * @exception exception-object exception description
+ * @param keyHash - The hash of the account's key to search for
+ * @return key::AccountID - The discovered account
+ * @exception InvalidAccount - Thrown if no peer's account has the given hash
  */
-const key::PublicKey& NetworkedTangle::findAccount(Hash keyHash) const {
-    for(auto& [uuid, key]: peerKeys)
-        if(key::hash(key) == keyHash)
-            return key;
+key::AccountID NetworkedTangle::findAccount(Hash keyHash) const {
+    if(auto account = peerKeys.findHash(keyHash))
+        return *account;
 
     throw InvalidAccount(keyHash);
 }
@@ -93,10 +212,58 @@ const key::PublicKey& NetworkedTangle::findAccount(Hash keyHash) const {
  */
 Hash NetworkedTangle::add(TransactionNode::ptr node){
     Hash out = Tangle::add(node);
-    network.send_object(AddTransactionRequest(*node, *personalKeys)); // The add gets validated by the base tangle, if we get to this code (no exception) then the node is acceptable
+    // Make sure we won't forget the transaction before we tell anyone else about it
+    // NOTE: the transaction is already part of the tangle, so if the journal fails it is still captured and announced (it just won't survive a restart)
+    try {
+        syncJournal();
+    } catch (std::exception& e) { std::cerr << "Failed to journal transaction with hash `" << node->hash << "`, it won't be recovered after a restart" << std::endl << "\t" << e.what() << std::endl; }
+    // Record the transaction if we are capturing (we originated it, so it will never be received)
+    network.captureLocal([&node](){
+        breep::serializer s;
+        s << *node;
+        auto raw = s.str();
+        return std::string((const char*) raw.data(), raw.size());
+    });
+    announce({node->hash}); // The add gets validated by the base tangle, if we get to this code (no exception) then the node is acceptable
     return out;
 }
 
+/**
+ * @brief Function which announces transactions to a random subset of (at most GOSSIP_FANOUT) peers, they will request the bodies of any they are missing
+ * 
+ * @param hashes - Hashes of the transactions to announce
+ * @param exclude - (optional) Peer not to announce to (the peer who sent us the transactions)
+ */
+void NetworkedTangle::announce(const std::vector<std::string>& hashes, std::optional<boost::uuids::uuid> exclude /*= {}*/){
+    if(hashes.empty()) return;
+
+    // List every peer we could announce to
+    auto peers = network.peers();
+    std::vector<const transport::Peer*> candidates;
+    for(auto& [id, peer]: peers)
+        if(!exclude || id != *exclude)
+            candidates.push_back(&peer);
+
+    // Randomly pick (at most) GOSSIP_FANOUT of them
+    thread_local std::mt19937 rng(std::random_device{}());
+    std::shuffle(candidates.begin(), candidates.end(), rng);
+    if(candidates.size() > GOSSIP_FANOUT) candidates.resize(GOSSIP_FANOUT);
+
+    for(auto peer: candidates)
+        network.send_object_to(*peer, InventoryAnnouncement{hashes});
+}
+
+/**
+ * @brief Sets the genesis of the tangle, and compacts the journal (if persisting) into a checkpoint starting from the new genesis
+ *
+ * @param genesis - The new genesis
+ */
+void NetworkedTangle::setGenesis(TransactionNode::ptr genesis){
+    Tangle::setGenesis(genesis);
+    seen.clear(); // Transactions we saw may not be part of the new tangle, we need to accept them again
+    checkpoint();
+}
+
 /**
  * @brief Function which creates the latest common genesis (node representing a set of what were once tips with 100% confidence)
  * @return TransactionNode::ptr - The generated genesis
@@ -131,7 +298,7 @@ TransactionNode::ptr NetworkedTangle::createLatestCommonGenesis(){
     std::vector<Transaction::Output> outputs;
 
     // Lamba which calculates the balance of the given acount as seen by the chosen nodes
-    auto reverseBalanceQuery = [&](const key::PublicKey& account){
+    auto reverseBalanceQuery = [&](key::AccountID account){
         std::list<std::string> considered;
         double balance = 0;
 
@@ -146,11 +313,11 @@ TransactionNode::ptr NetworkedTangle::createLatestCommonGenesis(){
             // NOTE: the balances have already been validated going forward... assuming they are correct
             // Add up how this transaction takes away from the balance of interest
             for(const Transaction::Input& input: head->inputs)
-                if(input.account() == account)
+                if(input.accountID() == account)
                     balance -= input.amount;
             // Add up how this transaction adds to the balance of interest
             for(const Transaction::Output& output: head->outputs)
-                if(output.account() == account)
+                if(output.accountID() == account)
                     balance += output.amount;
 
             // Add all of the parents to the queue if they weren't already there
@@ -167,7 +334,7 @@ TransactionNode::ptr NetworkedTangle::createLatestCommonGenesis(){
     // Lambda which generates a list of every account refernced in the tangle
     auto listAccounts = [&](){
         std::list<std::string> considered;
-        std::list<key::PublicKey> out;
+        std::list<key::AccountID> out;
 
         std::queue<TransactionNode::const_ptr> q;
         q.push(genesis);
@@ -179,11 +346,11 @@ TransactionNode::ptr NetworkedTangle::createLatestCommonGenesis(){
 
             // Find all of the accounts referenced in this transaction and add them to the output list (if they aren't already there)
             for(const Transaction::Input& input: head->inputs)
-                if(auto account = input.account(); std::find(out.begin(), out.end(), account) == out.end())
+                if(auto account = input.accountID(); std::find(out.begin(), out.end(), account) == out.end())
                     out.push_back(account);
             // Add up how this transaction adds to the balance of interest
             for(const Transaction::Output& output: head->outputs)
-                if(auto account = output.account(); std::find(out.begin(), out.end(), account) == out.end())
+                if(auto account = output.accountID(); std::find(out.begin(), out.end(), account) == out.end())
                     out.push_back(account);
 
             // Determine if this node is one of the chosen nodes
@@ -216,14 +383,13 @@ TransactionNode::ptr NetworkedTangle::createLatestCommonGenesis(){
 
     // Create a new transaction and set its hash to the hash of the first chosen node
     auto trx = TransactionNode::create(parents, inputs, outputs);
-    util::mutable_cast(trx->hash) = chosen[0]->hash;
+    trx->setClaimedHash(chosen[0]->hash);
 
     // Fill the transaction's parent hashes with the remaining hashes of the chosen nodes
-    auto& parentHashes = util::mutable_cast(trx->parentHashes);
-    delete [] parentHashes.data(); // Free the current parent hashes
-    parentHashes = {new Hash[chosen.size() - 1], chosen.size() - 1}; // Create new memory to back the parent hashes
+    std::vector<std::string> aliases;
     for(int i = 1; i < chosen.size(); i++)
-        util::mutable_cast(parentHashes[i]) = chosen[i]->hash;
+        aliases.push_back(chosen[i]->hash);
+    trx->setAliases(std::move(aliases));
 
     return trx;
 }
@@ -288,6 +454,134 @@ void NetworkedTangle::prune(){
     *util::mutable_cast(tips.write_lock()) = originalTips;
 }
 
+/**
+ * @brief Function which requests the transactions we don't have (and haven't recently requested from someone else) from a peer
+ * 
+ * @param from - The peer to request the transactions from
+ * @param hashes - Hashes of the wanted transactions
+ */
+void NetworkedTangle::requestTransactions(const transport::Peer& from, const std::vector<std::string>& hashes){
+    TransactionRequest request;
+    {
+        std::scoped_lock lock(inventoryMutex);
+        auto now = std::chrono::steady_clock::now();
+
+        // Forget requests which have long since timed out
+        std::erase_if(requestedInventory, [now](const auto& pair){ return now - pair.second >= GOSSIP_REQUEST_TIMEOUT * 2; });
+
+        for(auto& hash: hashes){
+            // Skip transactions we have (or have recently seen)
+            if(seen.contains(hash) || find(hash)) continue;
+
+            // Skip transactions we recently requested
+            auto [requested, inserted] = requestedInventory.try_emplace(hash, now);
+            if(!inserted && now - requested->second < GOSSIP_REQUEST_TIMEOUT) continue;
+            requested->second = now;
+
+            request.hashes.push_back(hash);
+            if(request.hashes.size() == MAX_INVENTORY_PER_MESSAGE) break; // Never ask for more than the peer will answer
+        }
+    }
+
+    if(!request.hashes.empty())
+        network.send_object_to(from, request);
+}
+
+/**
+ * @brief Function which checks a transaction from <peer> against the peer's rate limit for the lane
+ * @note Transactions we send ourselves (loaded from disk) and synchronization transactions from the peer we requested a synchronization from are never limited
+ * 
+ * @param peer - The peer who sent the transaction
+ * @param lane - The lane the transaction will be queued in
+ * @return bool - True if the transaction should be queued, false if it should be dropped
+ */
+bool NetworkedTangle::admit(const boost::uuids::uuid& peer, IngestLane lane){
+    if(!enforceRateLimits || peer == network.self().id() || (lane == BulkLane && synchronizationSource == peer))
+        return true;
+
+    std::scoped_lock lock(admissionMutex);
+    auto& bucket = admissionBuckets.try_emplace(peer, std::array<TokenBucket, 2>{
+        TokenBucket(INGEST_LIVE_RATE, INGEST_LIVE_BURST),
+        TokenBucket(INGEST_BULK_RATE, INGEST_BULK_BURST)
+    }).first->second[lane];
+
+    bool wasThrottled = bucket.throttled;
+    if(bucket.tryConsume()) return true;
+
+    // Only mention the peer being throttled when it starts (not for every dropped transaction)
+    if(!wasThrottled)
+        std::cerr << "Peer `" << peer << "` exceeded its " << (lane == LiveLane ? "live" : "bulk") << " transaction rate limit, dropping transactions" << std::endl;
+    return false;
+}
+
+/**
+ * @brief Function which truncates an oversized list of hashes a peer sent us, charging the excess against the peer's live rate limit
+ *
+ * @param peer - The peer who sent the hashes
+ * @param hashes - The hashes (truncated to at most MAX_INVENTORY_PER_MESSAGE)
+ */
+void NetworkedTangle::limitInventory(const boost::uuids::uuid& peer, std::vector<std::string>& hashes){
+    if(hashes.size() <= MAX_INVENTORY_PER_MESSAGE) return;
+    size_t excess = hashes.size() - MAX_INVENTORY_PER_MESSAGE;
+    hashes.resize(MAX_INVENTORY_PER_MESSAGE);
+
+    std::cerr << "Peer `" << peer << "` listed " << excess << " more hashes than a single message may, ignoring them" << std::endl;
+    if(!enforceRateLimits || peer == network.self().id()) return;
+
+    std::scoped_lock lock(admissionMutex);
+    admissionBuckets.try_emplace(peer, std::array<TokenBucket, 2>{
+        TokenBucket(INGEST_LIVE_RATE, INGEST_LIVE_BURST),
+        TokenBucket(INGEST_BULK_RATE, INGEST_BULK_BURST)
+    }).first->second[LiveLane].charge(excess);
+}
+
+/**
+ * @brief Function which queues a request for the ingest thread
+ *
+ * @param source - The peer the request came from
+ * @param lane - The lane to queue the request in
+ * @param request - The request
+ * @param bounded - (optional) Whether the source's limit on waiting requests applies
+ * @return bool - True if the request was queued, false if the source already has too many requests waiting
+ */
+bool NetworkedTangle::enqueue(const boost::uuids::uuid& source, IngestLane lane, IngestRequest request, bool bounded /*= true*/){
+    ingestOutstanding++;
+    if(ingestQueue.push(source, lane, std::move(request), bounded)) return true;
+
+    if(--ingestOutstanding == 0) ingestOutstanding.notify_all();
+    return false;
+}
+
+/**
+ * @brief Function run by the ingest thread, validates and adds the transactions chosen by the ingest scheduler until the tangle is destroyed
+ */
+void NetworkedTangle::ingest(){
+    while(auto request = ingestQueue.pop()){
+        try {
+            if(request->addition)
+                AddTransactionRequestBase::process(request->addition->transaction, request->addition->pair, request->synchronization, *this);
+            else if(request->snapshot)
+                TangleSnapshot::install(request->snapshot->source, request->snapshot->snapshot, *this);
+            // Requests without a transaction ask us to update our weights (in a thread)
+            else {
+                if(weightUpdateThreads) std::thread([this](){ updateCumulativeWeights(); }).detach();
+                else updateCumulativeWeights();
+                std::cout << "Started updating tangle weights" << std::endl;
+            }
+        } catch (std::exception& e) { std::cerr << "Failed to process remote transaction" << std::endl << "\t" << e.what() << std::endl; }
+
+        if(--ingestOutstanding == 0) ingestOutstanding.notify_all();
+    }
+}
+
+/**
+ * @brief Blocks until the ingest thread has processed every request queued so far
+ */
+void NetworkedTangle::waitForIngest(){
+    for(size_t outstanding = ingestOutstanding; outstanding; outstanding = ingestOutstanding)
+        ingestOutstanding.wait(outstanding);
+}
+
 /**
  * @brief Function which saves a tangle to a file (or aarbitrary output stream)
  * @param out - Output stream to save the file to
@@ -305,7 +599,7 @@ void NetworkedTangle::saveTangle(std::ostream& out) {
 
     // Serialize the number of transactions
     breep::serializer s;
-    s << transactions.size();
+    s << uint64_t(transactions.size());
 
     // Serialize each of the transactions
     for(Transaction* _t: transactions){
@@ -338,7 +632,7 @@ void NetworkedTangle::loadTangle(std::istream& in, size_t size) {
     breep::deserializer d(raw);
 
     // Determine how many transactions there are to read
-    size_t transactionCount;
+    uint64_t transactionCount;
     d >> transactionCount;
 
     // The genesis is always the first transaction in the file
@@ -348,7 +642,7 @@ void NetworkedTangle::loadTangle(std::istream& in, size_t size) {
     network.send_object_to_self(SyncGenesisRequest(trx, *personalKeys));
 
     // Read in each transaction from the deserializer and then add it to the tangle
-    for(int i = 0; i < transactionCount - 1; i++) { // Minus 1 since we already synced the genesis
+    for(uint64_t i = 1; i < transactionCount; i++) { // Starting at 1 since we already synced the genesis
         d >> trx;
         network.send_object_to_self(SynchronizationAddTransactionRequest(trx, *personalKeys));
     }
@@ -358,11 +652,95 @@ void NetworkedTangle::loadTangle(std::istream& in, size_t size) {
 }
 
 
-// -- Message Listeners --
+/**
+ * @brief Function which starts journaling the tangle to disk, first recovering any state left behind by a previous run
+ * @note Recovery loads the last checkpoint and then replays only the log records written after it
+ *
+ * @param path - Path to the write-ahead log (the checkpoint is stored at <path>.checkpoint)
+ * @return bool - True if a previous tangle was recovered, false if the journal was empty
+ */
+bool NetworkedTangle::enablePersistence(const std::string& path){
+    auto log = std::make_unique<WriteAheadLog>(path);
+
+    // Read back whatever survived the last run before anything new gets appended
+    auto snapshot = log->readCheckpoint();
+    auto records = log->readRecords();
 
+    // Load the checkpoint (the journal isn't attached yet so nothing being replayed gets logged a second time)
+    if(snapshot){
+        std::stringstream in(*snapshot);
+        loadTangle(in, snapshot->size());
+    }
+
+    // Replay the tail of the log on top of the checkpoint
+    for(auto& record: records){
+        Transaction trx = Transaction::decode(record);
+        network.send_object_to_self(SynchronizationAddTransactionRequest(trx, *personalKeys));
+    }
+    if(!records.empty()) network.send_object_to_self(UpdateWeightsRequest());
+
+    // Start journaling, taking a new checkpoint in the background whenever the log grows too long (or fails to be written)
+    log->checkpointRequested = [this](){
+        {
+            std::scoped_lock lock(checkpointMutex);
+            checkpointWanted = true;
+        }
+        checkpointCondition.notify_one();
+    };
+    if(!checkpointThread.joinable())
+        checkpointThread = std::thread([this](){ checkpoints(); });
+    {
+        std::scoped_lock lock(mutex);
+        journal = std::move(log);
+    }
+
+    std::cout << "Recovered " << (snapshot ? "a checkpoint and " : "") << records.size() << " journaled transactions" << std::endl;
+    return snapshot || !records.empty();
+}
+
+/**
+ * @brief Function which (in its own thread) takes the checkpoints the journal requests, until the tangle is destroyed
+ */
+void NetworkedTangle::checkpoints(){
+    std::unique_lock lock(checkpointMutex);
+    while(true){
+        checkpointCondition.wait(lock, [this]{ return checkpointWanted || checkpointStopping; });
+        if(checkpointStopping) return;
+        checkpointWanted = false;
+
+        lock.unlock();
+        try {
+            checkpoint();
+        } catch (std::exception& e) { std::cerr << "Failed to checkpoint the tangle" << std::endl << "\t" << e.what() << std::endl; }
+        lock.lock();
+    }
+}
+
+/**
+ * @brief Function which saves the whole tangle as a checkpoint and truncates the journal
+ * @note Does nothing if the tangle isn't being persisted
+ */
+void NetworkedTangle::checkpoint(){
+    if(!journal) return;
+
+    std::string snapshot;
+    WriteAheadLog::Freeze frozen;
+    {
+        // Can't add or remove nodes while we are snapshotting the tangle
+        std::scoped_lock lock(mutex);
+        std::stringstream out;
+        saveTangle(out);
+        snapshot = out.str();
+
+        // Freeze the log before unlocking so no records can slip in between the snapshot and the truncation
+        frozen = journal->freeze();
+    }
+    journal->checkpoint(snapshot, std::move(frozen));
+}
+
+
+// -- Message Listeners --
 
-// Storage for the ID of the last key receiver
-boost::uuids::uuid NetworkedTangle::PublicKeySyncRequest::lastSent;
 
 /**
  * @brief Listener for PublicKeySyncRequest events. Sends our public key to the requesting party
@@ -370,7 +748,7 @@ boost::uuids::uuid NetworkedTangle::PublicKeySyncRequest::lastSent;
  * @param networkData - The event recieved
  * @param t - The tangle which recieved the event
  */
-void NetworkedTangle::PublicKeySyncRequest::listener(breep::tcp::netdata_wrapper<PublicKeySyncRequest>& networkData, NetworkedTangle& t){
+void NetworkedTangle::PublicKeySyncRequest::listener(transport::netdata_wrapper<PublicKeySyncRequest>& networkData, NetworkedTangle& t){
     // If we don't have a keypair, error
     if(!t.personalKeys)
         throw key::InvalidKey("Missing Personal Keypair!");
@@ -379,11 +757,11 @@ void NetworkedTangle::PublicKeySyncRequest::listener(breep::tcp::netdata_wrapper
         throw key::InvalidKey("Personal Keypair's public and private key were not created from eachother!");
 
     // Don't service this request if we just sent this person our key
-    if(lastSent != networkData.source.id()){
+    if(t.lastKeySent != networkData.source.id()){
         t.network.send_object_to(networkData.source, PublicKeySyncResponse(*t.personalKeys));
         std::cout << "Sent public key to `" << networkData.source.id() << "`" << std::endl;
     }
-    lastSent = networkData.source.id();
+    t.lastKeySent = networkData.source.id();
 
     // If we don't have keys for this peer, request them
     if(!t.peerKeys.contains(networkData.source.id()))
@@ -410,7 +788,7 @@ NetworkedTangle::GenesisVoteResponse::GenesisVoteResponse(const NetworkedTangle&
  * @param networkData - The event recieved
  * @param t - The tangle which recieved the event
  */
-void NetworkedTangle::GenesisVoteResponse::listener(breep::tcp::netdata_wrapper<GenesisVoteResponse> &networkData, NetworkedTangle &t) {
+void NetworkedTangle::GenesisVoteResponse::listener(transport::netdata_wrapper<GenesisVoteResponse> &networkData, NetworkedTangle &t) {
     // If we aren't accepting votes... ignore the message
     if(!t.genesisVotes) return;
     // If we don't have the sender's public key, ask for it and then ask for their vote again
@@ -436,14 +814,16 @@ void NetworkedTangle::GenesisVoteResponse::listener(breep::tcp::netdata_wrapper<
 
     
     // Lambda which accepts a vote from a peer
-    auto acceptVote = [&t](const breep::tcp::peer& source, std::string_view expectedHash){
+    auto acceptVote = [&t](const transport::Peer& source, std::string_view expectedHash){
         // Clear the votes
         t.genesisVotes.reset(nullptr);
 
         // Mark that we are expecting the hash at the back of the list (the last hash is the actual hash, as opposed to the parent hashes)
         t.genesisSyncExpectedHash = expectedHash;
-        // Request a tangle sync from the recieved voter
-        t.network.send_object_to(source, TangleSynchronizeRequest());
+        // Mark the voter's synchronization transactions as exempt from rate limits
+        t.synchronizationSource = source.id();
+        // Request a snapshot of the tangle from the recieved voter
+        t.network.send_object_to(source, TangleSnapshotRequest());
     };
 
     // If this genesis pair has a majority of the vote
@@ -463,8 +843,9 @@ void NetworkedTangle::GenesisVoteResponse::listener(breep::tcp::netdata_wrapper<
             });
 
             // Request a tangle sync from the first voter for the best genesis
-            if(t.network.peers().contains(best.second.first))
-                acceptVote(t.network.peers().at(best.second.first), best.first.back());
+            auto peers = t.network.peers();
+            if(auto voter = peers.find(best.second.first); voter != peers.end())
+                acceptVote(voter->second, best.first.back());
         }
     }
 }
@@ -475,19 +856,23 @@ void NetworkedTangle::GenesisVoteResponse::listener(breep::tcp::netdata_wrapper<
  * @param networkData - The event recieved
  * @param t - The tangle which recieved the event
  */
-void NetworkedTangle::SyncGenesisRequest::listener(breep::tcp::netdata_wrapper<SyncGenesisRequest>& networkData, NetworkedTangle& t){
+void NetworkedTangle::SyncGenesisRequest::listener(transport::netdata_wrapper<SyncGenesisRequest>& networkData, NetworkedTangle& t){
     // If we didn't request a new genesis... do nothing
     if(t.genesisSyncExpectedHash == INVALID_HASH)
         return;
+    // NOTE: the transaction's hash was calculated from its contents when it was decoded, so it is the actual hash
+    const Transaction& received = networkData.data.genesis;
+    Hash& claimedHash = networkData.data.claimedHash;
+
     // Don't start with a new genesis if its hash matches the current genesis
-    if(t.genesis->hash == networkData.data.genesis.hash)
+    if(t.genesis->hash == claimedHash)
         return;
     // If the genesis isn't the one we are looking for, it is invalid
-    if(t.genesisSyncExpectedHash != networkData.data.genesis.hash)
+    if(t.genesisSyncExpectedHash != claimedHash)
         throw std::runtime_error("Recieved genesis sync with invalid hash, discarding");
     // If the remote transaction's hash doesn't match what is actual... it has an invalid hash
-    if(networkData.data.genesis.hashTransaction() != networkData.data.actualHash)
-        throw Transaction::InvalidHash(networkData.data.actualHash, networkData.data.genesis.hash); // TODO: Exception caught by Breep, need alternative error handling?
+    if(received.hash != networkData.data.actualHash)
+        throw Transaction::InvalidHash(received.hash, networkData.data.actualHash); // TODO: Exception caught by Breep, need alternative error handling?
     // If we don't have the sender's public key, ask for it and then ask them to resend the tangle
     if(!t.peerKeys.contains(networkData.source.id())){
         t.network.send_object_to(networkData.source, PublicKeySyncRequest());
@@ -495,49 +880,291 @@ void NetworkedTangle::SyncGenesisRequest::listener(breep::tcp::netdata_wrapper<S
         return;
     }
     // If we can't verify the transaction discard it
-    if(!key::verifyMessage(t.peerKeys[networkData.source.id()], networkData.data.genesis.hash + networkData.data.genesis.hashTransaction(), networkData.data.validitySignature))
-        throw std::runtime_error("Syncing of genesis with hash `" + networkData.data.genesis.hash + "` failed, sender's identity failed to be verified, discarding.");
+    if(!key::verifyMessage(t.peerKeys[networkData.source.id()], claimedHash + received.hash, networkData.data.validitySignature))
+        throw std::runtime_error("Syncing of genesis with hash `" + claimedHash + "` failed, sender's identity failed to be verified, discarding.");
 
     // Ensure the genesis transaction doesn't have any inputs
-    if(!networkData.data.genesis.inputs.empty())
-        throw std::runtime_error("Remote genesis with hash `" + networkData.data.genesis.hash + "` failed, genesis transactions can't have inputs!");
+    if(!received.inputs.empty())
+        throw std::runtime_error("Remote genesis with hash `" + claimedHash + "` failed, genesis transactions can't have inputs!");
 
 
-    t.setGenesis(TransactionNode::create(t, networkData.data.genesis));
-    util::mutable_cast(t.genesis->hash) = networkData.data.claimedHash;
+    auto genesis = TransactionNode::create(t, received);
+    genesis->setClaimedHash(claimedHash);
+    t.setGenesis(genesis);
 
     std::cout << "Synchronized new genesis with hash `" + t.genesis->hash + "` from `" << networkData.source.id() << "`" << std::endl;
     t.genesisSyncExpectedHash = INVALID_HASH;
 }
 
 /**
- * @brief Listener for AddTransactionRequestBase events. Validates the transaction and either adds it to the tangle or enqueues it to be added later
+ * @brief Listener for TangleSnapshotRequest events. Sends the requester a snapshot of our tangle
+ * 
+ * @param networkData - The event recieved
+ * @param t - The tangle which recieved the event
+ */
+void NetworkedTangle::TangleSnapshotRequest::listener(transport::netdata_wrapper<TangleSnapshotRequest>& networkData, NetworkedTangle& t){
+    TangleSnapshot snapshot(t);
+    t.network.send_object_to(networkData.source, snapshot);
+    std::cout << "Sent " << snapshot.snapshot.size() << " byte tangle snapshot to `" << networkData.source.id() << "`" << std::endl;
+}
+
+/**
+ * @brief Construct a snapshot of the provided tangle
+ * @note Layout (before compression): genesis hash, hashes the genesis aliases, genesis transaction (without parents), transaction count, transactions (sorted by time)
+ * 
+ * @param t - The tangle to snapshot
+ */
+NetworkedTangle::TangleSnapshot::TangleSnapshot(NetworkedTangle& t){
+    std::scoped_lock lock(t.mutex); // Can't add or remove nodes while we are snapshotting the tangle
+
+    // The snapshot starts from our genesis (the genesis we vote for, see GenesisVoteResponse) so that the requester ends up with the genesis the network voted for
+    auto genesis = t.genesis;
+    std::vector<std::string> aliases(genesis->parentHashes.begin(), genesis->parentHashes.end());
+
+    // Everything else is part of the recent subtangle, sorted by time so that parents come before their children
+    std::list<TransactionNode*> transactions = t.listTransactions();
+    transactions.remove_if([](TransactionNode* node){ return node->isGenesis; });
+    transactions.sort([](Transaction* a, Transaction* b){ return a->timestamp < b->timestamp; });
+
+    // The genesis is sent without its parents (the aliased hashes are sent separately)
+    Transaction body = *genesis;
+    util::mutable_cast(body.parentHashes) = util::SharedVector<std::string>();
+
+    breep::serializer s;
+    s << genesis->hash;
+    s << aliases;
+    s << body;
+    s << uint64_t(transactions.size());
+    for(Transaction* trx: transactions)
+        s << *trx;
+
+    // Compress the snapshot and sign its digest
+    auto raw = s.str();
+    snapshot = util::compress(*(std::string*) &raw);
+    signature = key::signMessage(*t.personalKeys, util::hash(snapshot));
+}
+
+/**
+ * @brief Listener for TangleSnapshot events. Validates the snapshot and queues it to be installed by the ingest thread (behind anything the sender has already sent us)
+ * 
+ * @param networkData - The event recieved
+ * @param t - The tangle which recieved the event
+ */
+void NetworkedTangle::TangleSnapshot::listener(transport::netdata_wrapper<TangleSnapshot>& networkData, NetworkedTangle& t){
+    // If we didn't request a snapshot from the sender... do nothing
+    if(t.synchronizationSource != networkData.source.id())
+        return;
+    // If we don't have the sender's public key, ask for it and then ask them to resend the snapshot
+    if(!t.peerKeys.contains(networkData.source.id())){
+        t.network.send_object_to(networkData.source, PublicKeySyncRequest());
+        t.network.send_object_to(networkData.source, TangleSnapshotRequest());
+        return;
+    }
+    // If we can't verify the snapshot discard it
+    if(!key::verifyMessage(t.peerKeys[networkData.source.id()], util::hash(networkData.data.snapshot), networkData.data.signature))
+        throw std::runtime_error("Tangle snapshot failed to be verified, sender's identity failed to be verified, discarding.");
+
+    // The ingest thread owns the tangle's synchronization flags, so it installs the snapshot
+    auto& source = networkData.source.id();
+    t.enqueue(source, BulkLane, {std::nullopt, true, SnapshotInstallation{source, std::move(networkData.data.snapshot)}}, /*bounded*/ false);
+}
+
+/**
+ * @brief Function which sets a validated snapshot's genesis as our genesis, and adds the rest of its transactions
+ * @note Called by the ingest thread
+ * 
+ * @param source - The peer who sent the snapshot
+ * @param snapshot - The (compressed) snapshot
+ * @param t - The tangle to install the snapshot into
+ */
+void NetworkedTangle::TangleSnapshot::install(const boost::uuids::uuid& source, const std::string& snapshot, NetworkedTangle& t){
+    // If the synchronization was abandoned (or already completed) while the snapshot was waiting... do nothing
+    if(t.synchronizationSource != source)
+        return;
+
+    // Decompress the snapshot
+    auto raw = util::decompress(snapshot);
+    breep::deserializer d(*(std::basic_string<unsigned char>*) &raw);
+
+    // Read and set the genesis
+    std::string claimedHash;
+    std::vector<std::string> aliases;
+    Transaction body;
+    d >> claimedHash;
+    d >> aliases;
+    d >> body;
+    // If the genesis isn't the one the network voted for, the snapshot is invalid
+    if(claimedHash != t.genesisSyncExpectedHash)
+        throw std::runtime_error("Tangle snapshot's genesis `" + claimedHash + "` isn't the genesis that was voted for, discarding.");
+    if(!body.inputs.empty())
+        throw std::runtime_error("Snapshot genesis with hash `" + claimedHash + "` failed, genesis transactions can't have inputs!");
+
+    auto genesis = TransactionNode::create(t, body);
+    genesis->setClaimedHash(claimedHash);
+    genesis->setAliases(std::move(aliases));
+    t.setGenesis(genesis);
+
+    // Read the recent subtangle
+    uint64_t transactionCount;
+    d >> transactionCount;
+    std::list<Transaction> pending;
+    for(uint64_t i = 0; i < transactionCount; i++){
+        pending.emplace_back();
+        d >> pending.back();
+    }
+
+    // Add the transactions (without relaying them or updating weights), repeating until no more of them can be added in case any came before their parents
+    size_t added = 0;
+    for(bool progress = true; progress && !pending.empty(); ){
+        progress = false;
+        for(auto trx = pending.begin(); trx != pending.end(); ){
+            bool parentsFound = true;
+            for(Hash& hash: trx->parentHashes)
+                if(!t.find(hash)){
+                    parentsFound = false;
+                    break;
+                }
+            if(!parentsFound) { trx++; continue; }
+
+            try {
+                (*(Tangle*) &t).add(TransactionNode::create(t, *trx), /*updateWeights*/ false);
+                t.seen.insert(trx->hash);
+                added++;
+            } catch (std::exception& e) { std::cerr << "Invalid transaction in tangle snapshot, discarding" << std::endl << "\t" << e.what() << std::endl; }
+            trx = pending.erase(trx);
+            progress = true;
+        }
+    }
+
+    // Update all the weights (in a thread)
+    if(t.weightUpdateThreads) std::thread([&t](){ t.updateCumulativeWeights(); }).detach();
+    else t.updateCumulativeWeights();
+
+    t.synchronizationSource.reset();
+    t.genesisSyncExpectedHash = INVALID_HASH;
+    std::cout << "Bootstrapped from a " << snapshot.size() << " byte snapshot (genesis `" << t.genesis->hash << "` and " << added << " transactions) from `" << source << "`";
+    if(!pending.empty()) std::cout << ", " << pending.size() << " transactions were orphaned";
+    std::cout << std::endl;
+}
+
+/**
+ * @brief Listener for InventoryAnnouncement events. Requests any announced transactions we don't have (and haven't already requested) from the announcer
+ * 
+ * @param networkData - The event recieved
+ * @param t - The tangle which recieved the event
+ */
+void NetworkedTangle::InventoryAnnouncement::listener(transport::netdata_wrapper<InventoryAnnouncement>& networkData, NetworkedTangle& t){
+    t.limitInventory(networkData.source.id(), networkData.data.hashes);
+    t.requestTransactions(networkData.source, networkData.data.hashes);
+}
+
+/**
+ * @brief Listener for TransactionRequest events. Sends the requester the body of every requested transaction we have
+ * 
+ * @param networkData - The event recieved
+ * @param t - The tangle which recieved the event
+ */
+void NetworkedTangle::TransactionRequest::listener(transport::netdata_wrapper<TransactionRequest>& networkData, NetworkedTangle& t){
+    t.limitInventory(networkData.source.id(), networkData.data.hashes);
+    for(auto& hash: networkData.data.hashes)
+        if(auto node = t.find(hash); node && !node->isGenesis)
+            t.network.send_object_to(networkData.source, AddTransactionRequest(*node, *t.personalKeys));
+}
+
+/**
+ * @brief Constructs a request for a node in our tangle, reusing the node's cached encoding (and only encoding, compressing, and signing the node the first time it is sent)
+ * 
+ * @param node - The node to send
+ * @param keys - Keypair used for signing
+ */
+NetworkedTangle::AddTransactionRequestBase::AddTransactionRequestBase(const TransactionNode& node, const key::KeyPair& keys) : validityHash(node.hash), transaction(node) {
+    key::AccountID signer = key::AccountTable::intern(keys.pub);
+    encoded = node.wireEncoding.load();
+    if(encoded && encoded->signer == signer) return;
+
+    // NOTE: if two threads race to build the encoding they both produce valid encodings, whichever is stored last is kept
+    validitySignature = key::signMessage(keys, validityHash);
+    encoded = std::make_shared<const WireEncoding>(WireEncoding{signer, encodeBody()});
+    node.wireEncoding.store(encoded);
+}
+
+/**
+ * @brief Function which encodes the body of the request (its signature and transaction, compressed)
+ */
+std::string NetworkedTangle::AddTransactionRequestBase::encodeBody() const {
+    breep::serializer s;
+    s << validitySignature;
+    s << transaction;
+
+    auto uncompressed = s.str();
+    return util::compress(*(std::string*) &uncompressed);
+}
+
+/**
+ * @brief Function which decodes the body of a received request (its signature and transaction)
+ */
+void NetworkedTangle::AddTransactionRequestBase::decodeBody() {
+    auto uncompressed = util::decompress(body);
+    breep::deserializer d(*(std::basic_string<unsigned char>*) &uncompressed);
+    d >> validitySignature;
+    d >> transaction;
+    body.clear();
+}
+
+/**
+ * @brief Listener for AddTransactionRequestBase events. Checks the transaction against the sender's rate limit and queues it to be processed by the ingest thread
  * 
  * @param networkData - The event recieved
  * @param t - The tangle which recieved the event
+ * @param synchronization - (optional) Whether the transaction is part of a tangle synchronization (bulk) rather than a new transaction (live)
  */
-void NetworkedTangle::AddTransactionRequestBase::listener(breep::tcp::netdata_wrapper<AddTransactionRequestBase>& networkData, NetworkedTangle& t){
+void NetworkedTangle::AddTransactionRequestBase::listener(transport::netdata_wrapper<AddTransactionRequestBase>& networkData, NetworkedTangle& t, bool synchronization /*= false*/){
+    // If we have already processed the transaction, ignore it (without decompressing it)
+    if(t.seen.contains(networkData.data.validityHash)) return;
+
+    // If the sender is sending too quickly, drop the transaction before spending time decompressing it (they, or someone else, will announce it again)
+    auto& source = networkData.source.id();
+    IngestLane lane = synchronization ? BulkLane : LiveLane;
+    if(!t.admit(source, lane)) return;
+
+    networkData.data.decodeBody();
     const Transaction& transaction = networkData.data.transaction;
 
     // If the remote transaction's hash doesn't match what is claimed... it has an invalid hash
     if(transaction.hash != networkData.data.validityHash)
         throw Transaction::InvalidHash(networkData.data.validityHash, transaction.hash); // TODO: Exception caught by Breep, need alternative error handling?
 
+    // Queue the transaction behind the other transactions from the sender (our own transactions are never dropped)
+    if(!t.enqueue(source, lane, {TransactionAndHashVerificationPair(transaction, {source, networkData.data.validitySignature}), synchronization}, source != t.network.self().id()))
+        std::cerr << "Peer `" << source << "` has too many transactions waiting to be processed, dropping transaction with hash `" << transaction.hash << "`" << std::endl;
+}
+
+/**
+ * @brief Function which validates a transaction and either adds it to the tangle or enqueues it to be added later (then retries the transactions waiting on it)
+ * @note Called by the ingest thread
+ * 
+ * @param transaction - The transaction to add
+ * @param validityPair - Hash and key used for verification
+ * @param synchronization - Whether the transaction is part of a tangle synchronization (weights aren't updated and the transaction isn't relayed)
+ * @param t - The tangle to add the transaction to
+ */
+void NetworkedTangle::AddTransactionRequestBase::process(const Transaction& transaction, HashVerificationPair validityPair, bool synchronization, NetworkedTangle& t){
     // Try to add the transaction to the tangle
-    attemptToAddTransaction(transaction, {networkData.source.id(), networkData.data.validitySignature}, t);
+    boost::uuids::uuid source = validityPair.peerID;
+    attemptToAddTransaction(transaction, std::move(validityPair), synchronization, t);
 
     // For every transaction in the tangle's network addition queue... attempt to add that transaction
     size_t listSize = t.networkAdditionQueue.size();
     for(size_t i = 0; i < listSize; i++){
-        Transaction frontTrx = t.networkAdditionQueue.front().transaction;
-        HashVerificationPair frontSig = t.networkAdditionQueue.front().pair;
+        Transaction frontTrx = std::move(t.networkAdditionQueue.front().transaction);
+        HashVerificationPair frontSig = std::move(t.networkAdditionQueue.front().pair);
         t.networkAdditionQueue.pop();
-        attemptToAddTransaction(frontTrx, frontSig, t);
+        attemptToAddTransaction(frontTrx, frontSig, synchronization, t);
     }
     // Reduce the size of the network queue if we are wasting space
     t.shrinkNetworkQueue();
 
-    std::cout << "Processed remote transaction add with hash `" + transaction.hash + "` from " << networkData.source.id() << std::endl;
+    std::cout << "Processed remote transaction add with hash `" + transaction.hash + "` from " << source << std::endl;
 }
 
 /**
@@ -545,13 +1172,14 @@ void NetworkedTangle::AddTransactionRequestBase::listener(breep::tcp::netdata_wr
  * 
  * @param transaction - The transaction to add
  * @param validityPair - Hash and key used for verification
+ * @param synchronization - Whether the transaction is part of a tangle synchronization (weights aren't updated and the transaction isn't relayed, the whole tangle is being sent to us, not new transactions)
  * @param t - The tangle to add the transaction to
  */
-void NetworkedTangle::AddTransactionRequestBase::attemptToAddTransaction(const Transaction& transaction, HashVerificationPair validityPair, NetworkedTangle& t){
+void NetworkedTangle::AddTransactionRequestBase::attemptToAddTransaction(const Transaction& transaction, HashVerificationPair validityPair, bool synchronization, NetworkedTangle& t){
     try {
         // If we don't have the peer's public key, request it and enqueue the transaction for later
         if(!t.peerKeys.contains(validityPair.peerID)){
-            auto& peers = t.network.peers();
+            auto peers = t.network.peers();
             auto& sender = peers.at(validityPair.peerID);
             t.network.send_object_to(sender, PublicKeySyncRequest());
 
@@ -567,6 +1195,9 @@ void NetworkedTangle::AddTransactionRequestBase::attemptToAddTransaction(const T
         if(!key::verifyMessage(t.peerKeys[validityPair.peerID], transaction.hash, validityPair.signature))
             throw std::runtime_error("Transaction with hash `" + transaction.hash + "` sender's identity failed to be verified, discarding.");
 
+        // Remember that we have seen the transaction (it is either about to be added, queued, or found to be invalid) so that copies from other peers are dropped when they arrive
+        t.seen.insert(transaction.hash);
+
 
         // Validate the transaction's parents
         bool parentsFound = true;
@@ -583,14 +1214,25 @@ void NetworkedTangle::AddTransactionRequestBase::attemptToAddTransaction(const T
                 t.networkAdditionQueue.emplace(transaction, validityPair);
                 parentsFound = false;
                 std::cout << "Remote transaction with hash `" + transaction.hash + "` is temporarily orphaned... enqueuing for later" << std::endl;
+
+                // Ask the sender for the missing parents (gossip only delivers what was announced)
+                if(!synchronization){
+                    auto peers = t.network.peers();
+                    if(auto sender = peers.find(validityPair.peerID); sender != peers.end())
+                        t.requestTransactions(sender->second, { transaction.parentHashes.begin(), transaction.parentHashes.end() });
+                }
                 break;
             }
         }
 
         // If the transaction's parents could be validated... add the transaction to the tangle
         if(parentsFound) {
-            (*(Tangle*) &t).add(TransactionNode::create(t, transaction)); // Call the tangle version so that we don't spam the network with extra messages
+            (*(Tangle*) &t).add(TransactionNode::create(t, transaction), /*updateWeights*/ !synchronization); // Call the tangle version so that we don't spam the network with extra messages
             std::cout << "Added remote transaction with hash `" + transaction.hash + "` to the tangle" << std::endl;
+            if(t.remoteTransactionAdded) t.remoteTransactionAdded(transaction.hash);
+
+            // Relay the transaction to some of our other peers
+            if(!synchronization) t.announce({transaction.hash}, validityPair.peerID);
         }
     // If an exception is thrown by the add process, discard the transaction and display an error message
     } catch (std::exception& e) { std::cerr << "Invalid transaction in network queue, discarding" << std::endl << "\t" << e.what() << std::endl; }
@@ -628,59 +1270,44 @@ breep::deserializer& operator>>(breep::deserializer& _d, NetworkedTangle::SyncGe
 	util::mutable_cast(r.actualHash).clear();
 	d >> util::mutable_cast(r.actualHash);
 	d >> r.validitySignature;
-	d >> r.genesis;
-	util::mutable_cast(r.genesis.hash) = r.claimedHash;
+	d >> r.genesis; // NOTE: the genesis keeps the hash calculated while decoding, the listener compares it to the actual hash
 	return _d;
 }
 
 breep::serializer& operator<<(breep::serializer& _s, const NetworkedTangle::AddTransactionRequest& r) {
-	breep::serializer s;
-	s << r.validityHash;
-	s << r.validitySignature;
-	s << r.transaction;
-
-    // Compress the request
-	auto uncompressed = s.str();
-	_s << util::compress(*(std::string*) &uncompressed);
+    // The hash travels uncompressed (so duplicates can be detected without decompressing), followed by the compressed request (reusing the cached encoding if there is one)
+	_s << r.validityHash;
+	if(r.encoded) _s << r.encoded->bytes;
+	else _s << r.encodeBody();
 	return _s;
 }
 breep::deserializer& operator>>(breep::deserializer& _d, NetworkedTangle::AddTransactionRequest& r) {
-    // Decompress the request
-	std::basic_string<unsigned char> compressed;
-	_d >> compressed;
-	auto uncompressed = util::decompress(*(std::string*) &compressed);
-	breep::deserializer d(*(std::basic_string<unsigned char>*) &uncompressed);
-
 	std::string validityHash;
-	d >> validityHash;
+	_d >> validityHash;
 	(*(std::string*) &r.validityHash) = validityHash;
-	d >> r.validitySignature;
-	d >> r.transaction;
+
+	// The body is only decompressed and decoded once the receiver knows it hasn't already seen the transaction (see AddTransactionRequestBase::listener)
+	std::basic_string<unsigned char> compressed;
+	_d >> compressed;
+	r.body.assign((const char*) compressed.data(), compressed.size());
 	return _d;
 }
 
 breep::serializer& operator<<(breep::serializer& _s, const NetworkedTangle::SynchronizationAddTransactionRequest& r) {
-	breep::serializer s;
-	s << r.validityHash;
-	s << r.validitySignature;
-	s << r.transaction;
-
-    // Compress the request
-	auto uncompressed = s.str();
-	_s << util::compress(*(std::string*) &uncompressed);
+    // The hash travels uncompressed (so duplicates can be detected without decompressing), followed by the compressed request (reusing the cached encoding if there is one)
+	_s << r.validityHash;
+	if(r.encoded) _s << r.encoded->bytes;
+	else _s << r.encodeBody();
 	return _s;
 }
 breep::deserializer& operator>>(breep::deserializer& _d, NetworkedTangle::SynchronizationAddTransactionRequest& r) {
-    // Decompress the request
-	std::basic_string<unsigned char> compressed;
-	_d >> compressed;
-	auto uncompressed = util::decompress(*(std::string*) &compressed);
-	breep::deserializer d(*(std::basic_string<unsigned char>*) &uncompressed);
-
 	std::string validityHash;
-	d >> validityHash;
+	_d >> validityHash;
 	(*(std::string*) &r.validityHash) = validityHash;
-	d >> r.validitySignature;
-	d >> r.transaction;
+
+	// The body is only decompressed and decoded once the receiver knows it hasn't already seen the transaction (see AddTransactionRequestBase::listener)
+	std::basic_string<unsigned char> compressed;
+	_d >> compressed;
+	r.body.assign((const char*) compressed.data(), compressed.size());
 	return _d;
 }
\ No newline at end of file
@@ -0,0 +1,113 @@
+/**
+ * @file replay.cpp
+ * @author Joshua Dahl (jdahl@unr.edu)
+ * @brief Tool which plays a capture (see capture.hpp) back into a networked tangle, so ingest behavior that depends on message arrival order can be reproduced and profiled
+ * @note The recorded node's keys aren't in the capture, so the replay signs with a fresh key pair. Keys only sign what the node sends (which is discarded), so they don't change what is added to the tangle
+ * @version 0.1
+ * @date 2021-12-12
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#define BOOST_BIND_GLOBAL_PLACEHOLDERS
+
+#include <fstream>
+
+#include "networking.hpp"
+#include "capture.hpp"
+
+/**
+ * @brief Main function
+ */
+int main(int argc, char* argv[]) {
+	// Parse the arguments
+	std::string capturePath, tanglePath;
+	double speed = 0; // 0 means as fast as possible
+	bool joining = false, rateLimits = false, validArguments = true;
+	for(int i = 1; i < argc; i++){
+		std::string arg = argv[i];
+		try {
+			if(arg.starts_with("--speed=")) speed = std::stod(arg.substr(8));
+			else if(arg.starts_with("--tangle=")) tanglePath = arg.substr(9);
+			else if(arg == "--joining") joining = true;
+			else if(arg == "--rate-limits") rateLimits = true;
+			else if(capturePath.empty() && !arg.starts_with("--")) capturePath = arg;
+			else validArguments = false;
+		} catch (std::exception&) { validArguments = false; }
+	}
+
+	// If we are given invalid arguments, explain to the user how to use the program
+	if(!validArguments || capturePath.empty() || speed < 0) {
+		std::cout << "Usage: " << argv[0] << " <capture> [--speed=<factor>] [--tangle=<file>] [--joining] [--rate-limits]" << std::endl
+			<< "\t--speed plays the capture back at <factor> times the speed it was recorded at (by default as fast as possible, one message at a time)" << std::endl
+			<< "\t--tangle loads a saved tangle (see (S)ave) before replaying, the tangle the recorded node started with" << std::endl
+			<< "\t--joining marks the tangle as waiting for genesis votes (set if the recorded node joined an existing network)" << std::endl
+			<< "\t--rate-limits enforces peers' transaction rate limits (only meaningful when replaying at the original speed)" << std::endl;
+		return 1;
+	}
+
+	try {
+		transport::CaptureReader capture(capturePath);
+
+		// Create a tangle which impersonates the recorded node
+		auto backend = std::make_unique<transport::ReplayTransport>(capture.self());
+		auto& replay = *backend;
+		transport::Network network(std::move(backend));
+		NetworkedTangle t(network);
+		t.setKeyPair(std::make_shared<key::KeyPair>( key::generateKeyPair() ), /*networkSync*/ false);
+		t.enforceRateLimits = rateLimits;
+		// Unless replaying on the recorded schedule, weights are updated inline so they don't race the next record (balances depend on which conflicts are settled)
+		t.weightUpdateThreads = speed > 0;
+
+		if(!tanglePath.empty()){
+			std::ifstream fin(tanglePath, std::ios::binary);
+			if(!fin){
+				std::cerr << "Invalid path: `" << tanglePath << "`!" << std::endl;
+				return 2;
+			}
+			fin.seekg(0l, std::ios::end);
+			size_t size = fin.tellg();
+			fin.seekg(0l, std::ios::beg);
+			fin.clear();
+			t.loadTangle(fin, size);
+			t.waitForIngest();
+		}
+		if(joining) NetworkedTangle::GenesisVoteRequest{t};
+
+		// Deliver every record, either on the recorded schedule (scaled by the speed) or each one once the previous one has been completely processed (so the replay is deterministic)
+		size_t records = 0, messages = 0, bytes = 0, locals = 0;
+		auto start = std::chrono::steady_clock::now();
+		while(auto record = capture.next()){
+			if(speed > 0) std::this_thread::sleep_until(start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(record->time / speed));
+
+			// Transactions the recorded node originated are added to the tangle directly (everything else is delivered as if it was received)
+			if(record->kind == transport::CaptureRecord::Local){
+				breep::deserializer d(*(std::basic_string<unsigned char>*) &record->payload);
+				Transaction trx;
+				d >> trx;
+				try {
+					t.add(TransactionNode::create(t, trx));
+				} catch (std::exception& e) { std::cerr << "Failed to add local transaction with hash `" << trx.hash << "`" << std::endl << "\t" << e.what() << std::endl; }
+				locals++;
+			} else replay.replay(*record);
+			if(speed == 0) t.waitForIngest();
+
+			records++;
+			if(record->kind == transport::CaptureRecord::Message){
+				messages++;
+				bytes += record->payload.size();
+			}
+		}
+		t.waitForIngest();
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+		std::cout << std::endl << "Replayed " << records << " records (" << messages << " messages, " << bytes << " bytes, " << locals << " local transactions) in " << elapsed.count() << " seconds ("
+			<< (messages / elapsed.count()) << " messages/s)" << std::endl
+			<< "The tangle now contains " << t.listTransactions().size() << " transactions, replaying sent " << replay.sentMessages << " messages (" << replay.sentBytes << " bytes)" << std::endl;
+	} catch (std::exception& e) {
+		std::cerr << "Replay failed" << std::endl << "\t" << e.what() << std::endl;
+		return 3;
+	}
+
+	return 0;
+}
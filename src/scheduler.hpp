@@ -0,0 +1,206 @@
+/**
+ * @file scheduler.hpp
+ * @author Joshua Dahl (jdahl@unr.edu)
+ * @brief File which provides the token buckets and fair queues used to stop any one peer from monopolizing the tangle
+ * @version 0.1
+ * @date 2021-12-10
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+/**
+ * @brief Token bucket rate limiter, allows bursts of up to <burst> operations and <rate> operations per second on average
+ * @note Not thread safe, the owner is expected to protect it
+ */
+struct TokenBucket {
+	using clock = std::chrono::steady_clock;
+
+	// Tokens added every second
+	double rate;
+	// Maximum number of tokens the bucket can hold
+	double burst;
+	// Tokens currently in the bucket
+	double tokens;
+	// Flag which is set when the bucket refuses an operation and cleared once it allows one again
+	bool throttled = false;
+
+	TokenBucket(double rate, double burst) : rate(rate), burst(burst), tokens(burst), lastRefill(clock::now()) {}
+
+	/**
+	 * @brief Function which attempts to take tokens from the bucket
+	 *
+	 * @param cost - The number of tokens the operation costs
+	 * @param now - (optional) The current time
+	 * @return bool - True if the operation is allowed, false if it exceeds the rate limit
+	 */
+	bool tryConsume(double cost = 1, clock::time_point now = clock::now()){
+		// Refill the bucket for the time which has passed since it was last used
+		std::chrono::duration<double> elapsed = now - lastRefill;
+		tokens = std::min(burst, tokens + elapsed.count() * rate);
+		lastRefill = now;
+
+		throttled = tokens < cost;
+		if(!throttled) tokens -= cost;
+		return !throttled;
+	}
+
+	/**
+	 * @brief Function which takes tokens from the bucket whether or not it has them (going into debt, of at most <burst> tokens, which must be refilled before anything else is allowed)
+	 *
+	 * @param cost - The number of tokens to take
+	 * @param now - (optional) The current time
+	 */
+	void charge(double cost, clock::time_point now = clock::now()){
+		std::chrono::duration<double> elapsed = now - lastRefill;
+		tokens = std::max(-burst, std::min(burst, tokens + elapsed.count() * rate) - cost);
+		lastRefill = now;
+	}
+
+protected:
+	// When tokens were last added to the bucket
+	clock::time_point lastRefill;
+};
+
+/**
+ * @brief Thread safe queue which divides its capacity fairly between several sources, and its output between several priority lanes
+ * @note Each source has its own FIFO queue in each lane, the sources with waiting items in a lane are served round robin (so a chatty source only delays itself)
+ * @note Lanes are served by weighted round robin, lane i gets up to shares[i] items in a row before the next lane with waiting items gets a turn (so lower priority lanes are slowed, never starved)
+ *
+ * @tparam Source - Type identifying where items come from
+ * @tparam Item - Type of the queued items
+ * @tparam Lanes - The number of priority lanes
+ * @tparam SourceHash - Hash function for sources
+ */
+template<typename Source, typename Item, size_t Lanes = 2, typename SourceHash = std::hash<Source>>
+struct FairScheduler {
+	/**
+	 * @brief Creates a scheduler
+	 *
+	 * @param shares - How many items each lane gets per turn
+	 * @param limits - How many items each source may have waiting in each lane
+	 */
+	FairScheduler(std::array<size_t, Lanes> shares, std::array<size_t, Lanes> limits) : shares(shares), limits(limits) {}
+
+	/**
+	 * @brief Function which adds an item to a lane
+	 *
+	 * @param source - Where the item came from
+	 * @param lane - The lane to add the item to (0 is the highest priority)
+	 * @param item - The item to add
+	 * @param bounded - (optional) Whether the source's limit in the lane applies
+	 * @return bool - True if the item was queued, false if the source already has too many items waiting
+	 */
+	bool push(const Source& source, size_t lane, Item item, bool bounded = true){
+		{
+			std::scoped_lock lock(mutex);
+			if(closed) return false;
+
+			auto& l = lanes[lane];
+			auto& queue = l.queues[source];
+			if(bounded && queue.size() >= limits[lane]) return false;
+
+			// If the source didn't have anything waiting, it joins the back of the lane's rotation
+			if(queue.empty()) l.active.push_back(source);
+			queue.push_back(std::move(item));
+			total++;
+		}
+		ready.notify_one();
+		return true;
+	}
+
+	/**
+	 * @brief Function which removes the next item, waiting for one to be pushed if needed
+	 *
+	 * @return std::optional<Item> - The next item, or nothing if the scheduler has been closed
+	 */
+	std::optional<Item> pop(){
+		std::unique_lock lock(mutex);
+		ready.wait(lock, [this]{ return total > 0 || closed; });
+		if(closed) return {};
+
+		// Find a lane with waiting items which hasn't used up its turn (after checking every lane, the turns start over)
+		for(size_t i = 0; i <= Lanes; i++){
+			if(!lanes[currentLane].active.empty() && served < shares[currentLane]){
+				served++;
+				return popFrom(lanes[currentLane]);
+			}
+			currentLane = (currentLane + 1) % Lanes;
+			served = 0;
+		}
+		return {}; // Unreachable, there is always at least one waiting item
+	}
+
+	/**
+	 * @brief Function which stops the scheduler, waking any waiting threads (remaining items are discarded)
+	 */
+	void close(){
+		{
+			std::scoped_lock lock(mutex);
+			closed = true;
+		}
+		ready.notify_all();
+	}
+
+	/**
+	 * @brief Function which determines how many items are waiting (across every lane)
+	 */
+	size_t size() const {
+		std::scoped_lock lock(mutex);
+		return total;
+	}
+	bool empty() const { return size() == 0; }
+
+protected:
+	// The waiting items in a lane
+	struct Lane {
+		// Each source's waiting items
+		std::unordered_map<Source, std::deque<Item>, SourceHash> queues;
+		// Sources with waiting items, in the order they will be served
+		std::deque<Source> active;
+	};
+
+	std::array<Lane, Lanes> lanes;
+	// How many items each lane gets per turn, and how many items each source may have waiting in each lane
+	const std::array<size_t, Lanes> shares, limits;
+	// The lane currently taking its turn, and how many items it has been given so far
+	size_t currentLane = 0, served = 0;
+	// Total number of waiting items
+	size_t total = 0;
+	// Flag marking that the scheduler has been closed
+	bool closed = false;
+
+	// Mutex protecting the scheduler, and condition notified when items are pushed
+	mutable std::mutex mutex;
+	std::condition_variable ready;
+
+	/**
+	 * @brief Function which takes the next item from the source at the front of a lane's rotation, and sends that source to the back of the rotation
+	 */
+	Item popFrom(Lane& lane){
+		Source source = std::move(lane.active.front());
+		lane.active.pop_front();
+
+		auto queue = lane.queues.find(source);
+		Item item = std::move(queue->second.front());
+		queue->second.pop_front();
+		if(queue->second.empty()) lane.queues.erase(queue);
+		else lane.active.push_back(std::move(source));
+
+		total--;
+		return item;
+	}
+};
+
+#endif /* end of include guard: SCHEDULER_HPP */
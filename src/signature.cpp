@@ -0,0 +1,255 @@
+/**
+ * @file signature.cpp
+ * @author Joshua Dahl (jdahl@unr.edu)
+ * @brief Code backing the signature schemes
+ * @version 0.1
+ * @date 2021-12-08
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#include "signature.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "cryptopp/oids.h"
+#include "cryptopp/osrng.h"
+
+namespace key::scheme {
+
+	/**
+	 * @brief Function which converts a buffer of bytes into a hex string (for printing keys)
+	 *
+	 * @param data - The bytes to convert
+	 * @param size - The number of bytes
+	 * @return std::string - The hex representation
+	 */
+	static std::string hex(const byte* data, size_t size){
+		std::stringstream out;
+		for(size_t i = 0; i < size; i++)
+			out << std::hex << std::setw(2) << std::setfill('0') << (int) data[i];
+		return out.str();
+	}
+
+	/**
+	 * @brief Function which provides a random number generator for the calling thread (so that one isn't seeded every time we sign)
+	 *
+	 * @return CryptoPP::AutoSeededRandomPool& - This thread's random number generator
+	 */
+	static CryptoPP::AutoSeededRandomPool& threadRNG(){
+		thread_local CryptoPP::AutoSeededRandomPool prng;
+		return prng;
+	}
+
+	// Function which verifies a batch of <count> signatures by splitting it between several threads
+	bool verifyParallel(size_t count, const std::function<bool(size_t begin, size_t end)>& verifyChunk){
+		// Determine how many threads are worth starting
+		size_t threadCount = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), count / SIGNATURE_BATCH_MIN_PER_THREAD);
+		if(threadCount <= 1) return verifyChunk(0, count);
+
+		// Give each thread an (almost) equal chunk of the batch, the calling thread takes the first chunk
+		std::atomic<bool> good = true;
+		std::vector<std::thread> threads;
+		size_t chunkSize = (count + threadCount - 1) / threadCount;
+		for(size_t begin = chunkSize; begin < count; begin += chunkSize)
+			threads.emplace_back([&, begin](){
+				if(!verifyChunk(begin, std::min(begin + chunkSize, count)))
+					good = false;
+			});
+
+		if(!verifyChunk(0, chunkSize))
+			good = false;
+		for(auto& thread: threads)
+			thread.join();
+
+		return good;
+	}
+
+
+	// -- ECDSA --
+
+
+	// Function which generates a private key
+	ECDSA::PrivateKey ECDSA::generatePrivateKey(){
+		PrivateKey key;
+		key.Initialize(threadRNG(), CryptoPP::ASN1::secp160r1());
+		if(!key.Validate(threadRNG(), 3))
+			throw InvalidKey("Private Key failed to pass validation.");
+
+		return key;
+	}
+
+	// Function which generates a public key
+	ECDSA::PublicKey ECDSA::generatePublicKey(const PrivateKey& privateKey){
+		PublicKey publicKey;
+		privateKey.MakePublicKey(publicKey);
+		if(!publicKey.Validate(threadRNG(), 3))
+			throw InvalidKey("Public Key failed to pass validation.");
+
+		return publicKey;
+	}
+
+	// Function which converts a public key into its compressed point
+	std::string ECDSA::encodePublic(const PublicKey& key){
+		auto params = key.GetGroupParameters();
+		params.SetPointCompression(true);
+
+		std::string out(params.GetEncodedElementSize(true), '\0');
+		params.EncodeElement(true, key.GetPublicElement(), (byte*) out.data());
+		return out;
+	}
+
+	// Function which converts a compressed point (on secp160r1) into a public key
+	ECDSA::PublicKey ECDSA::decodePublic(std::string_view encoded){
+		CryptoPP::DL_GroupParameters_EC<CryptoPP::ECP> params(CryptoPP::ASN1::secp160r1());
+		params.SetPointCompression(true);
+		if(encoded.size() != params.GetEncodedElementSize(true))
+			throw InvalidKey("Compressed public key has the wrong size.");
+
+		PublicKey key;
+		key.Initialize(params, params.DecodeElement((const byte*) encoded.data(), true));
+		return key;
+	}
+
+	// Function which signs the provided message
+	std::string ECDSA::sign(const PrivateKey& key, std::string_view message){
+		Base::Signer signer(key);
+		std::string signature(signer.MaxSignatureLength(), '\0');
+		signature.resize(signer.SignMessage(threadRNG(), (const byte*) message.data(), message.size(), (byte*) signature.data()));
+		return signature;
+	}
+
+	// Function which creates a reusable verifier for <key>, precomputing multiples of its public point
+	std::unique_ptr<const ECDSA::Verifier> ECDSA::makeVerifier(const PublicKey& key){
+		auto verifier = std::make_unique<Verifier>(key);
+		verifier->AccessKey().Precompute(SIGNATURE_PRECOMPUTATION_STORAGE);
+		return verifier;
+	}
+
+	// Function which confirms that the signature was created from the message with the private key matching the verifier
+	bool ECDSA::verify(const Verifier& verifier, std::span<const byte> message, std::span<const byte> signature){
+		return verifier.VerifyMessage(message.data(), message.size(), signature.data(), signature.size());
+	}
+
+	// Function which confirms that the signature was created from the message with the matching private key
+	bool ECDSA::verify(const PublicKey& key, std::string_view message, std::string_view signature){
+		return verify(Verifier(key), bytes(message), bytes(signature));
+	}
+
+	// Function which confirms that every signature in the batch is valid
+	bool ECDSA::verifyBatch(std::span<const Job> jobs){
+		return verifyParallel(jobs.size(), [jobs](size_t begin, size_t end){
+			for(size_t i = begin; i < end; i++)
+				if(!verify(*jobs[i].verifier, jobs[i].message, jobs[i].signature))
+					return false;
+			return true;
+		});
+	}
+
+	// Function which prints a private key
+	void ECDSA::print(const PrivateKey& key){
+		std::cout << std::endl;
+		std::cout << "Private Exponent:" << std::endl;
+		std::cout << " " << key.GetPrivateExponent() << std::endl;
+	}
+
+	// Function which prints a public key
+	void ECDSA::print(const PublicKey& key){
+		std::cout << std::endl;
+		std::cout << "Public Element:" << std::endl;
+		std::cout << " X: " << key.GetPublicElement().x << std::endl;
+		std::cout << " Y: " << key.GetPublicElement().y << std::endl;
+	}
+
+
+	// -- Ed25519 --
+
+
+	// Function which generates a private key
+	Ed25519::PrivateKey Ed25519::generatePrivateKey(){
+		PrivateKey key;
+		key.GenerateRandom(threadRNG());
+		if(!key.Validate(threadRNG(), 3))
+			throw InvalidKey("Private Key failed to pass validation.");
+
+		return key;
+	}
+
+	// Function which generates a public key
+	Ed25519::PublicKey Ed25519::generatePublicKey(const PrivateKey& privateKey){
+		PublicKey publicKey;
+		privateKey.MakePublicKey(publicKey);
+		if(!publicKey.Validate(threadRNG(), 3))
+			throw InvalidKey("Public Key failed to pass validation.");
+
+		return publicKey;
+	}
+
+	// Function which converts a public key into its 32 byte encoding
+	std::string Ed25519::encodePublic(const PublicKey& key){
+		return { (const char*) key.GetPublicKeyBytePtr(), PublicKey::PUBLIC_KEYLENGTH };
+	}
+
+	// Function which converts a 32 byte encoding into a public key
+	Ed25519::PublicKey Ed25519::decodePublic(std::string_view encoded){
+		if(encoded.size() != PublicKey::PUBLIC_KEYLENGTH)
+			throw InvalidKey("Encoded public key has the wrong size.");
+
+		CryptoPP::ed25519Verifier verifier((const byte*) encoded.data());
+		return dynamic_cast<const PublicKey&>(verifier.GetPublicKey());
+	}
+
+	// Function which signs the provided message (Ed25519 signatures are deterministic so no randomness is needed)
+	std::string Ed25519::sign(const PrivateKey& key, std::string_view message){
+		std::string signature(SIGNATURE_SIZE, '\0');
+		CryptoPP::ed25519Signer(key).SignMessage(CryptoPP::NullRNG(), (const byte*) message.data(), message.size(), (byte*) signature.data());
+		return signature;
+	}
+
+	// Function which creates a reusable verifier for <key>
+	std::unique_ptr<const Ed25519::Verifier> Ed25519::makeVerifier(const PublicKey& key){
+		return std::make_unique<Verifier>(key);
+	}
+
+	// Function which confirms that the signature was created from the message with the private key matching the verifier
+	bool Ed25519::verify(const Verifier& verifier, std::span<const byte> message, std::span<const byte> signature){
+		if(signature.size() != SIGNATURE_SIZE) return false;
+		return verifier.VerifyMessage(message.data(), message.size(), signature.data(), signature.size());
+	}
+
+	// Function which confirms that the signature was created from the message with the matching private key
+	bool Ed25519::verify(const PublicKey& key, std::string_view message, std::string_view signature){
+		return verify(Verifier(key), bytes(message), bytes(signature));
+	}
+
+	// Function which confirms that every signature in the batch is valid
+	bool Ed25519::verifyBatch(std::span<const Job> jobs){
+		return verifyParallel(jobs.size(), [jobs](size_t begin, size_t end){
+			for(size_t i = begin; i < end; i++)
+				if(!verify(*jobs[i].verifier, jobs[i].message, jobs[i].signature))
+					return false;
+			return true;
+		});
+	}
+
+	// Function which prints a private key
+	void Ed25519::print(const PrivateKey& key){
+		std::cout << std::endl;
+		std::cout << "Private Key:" << std::endl;
+		std::cout << " " << hex(key.GetPrivateKeyBytePtr(), PrivateKey::SECRET_KEYLENGTH) << std::endl;
+	}
+
+	// Function which prints a public key
+	void Ed25519::print(const PublicKey& key){
+		std::cout << std::endl;
+		std::cout << "Public Key:" << std::endl;
+		std::cout << " " << hex(key.GetPublicKeyBytePtr(), PublicKey::PUBLIC_KEYLENGTH) << std::endl;
+	}
+
+} // key::scheme
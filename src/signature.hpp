@@ -0,0 +1,132 @@
+/**
+ * @file signature.hpp
+ * @author Joshua Dahl (jdahl@unr.edu)
+ * @brief File which provides the signature schemes keys can be backed by
+ * @version 0.1
+ * @date 2021-12-08
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#ifndef SIGNATURE_HPP
+#define SIGNATURE_HPP
+
+#include <functional>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "cryptopp/eccrypto.h"
+#include "cryptopp/xed25519.h"
+
+// Minimum number of signatures each thread is given when a batch is verified in parallel
+#define SIGNATURE_BATCH_MIN_PER_THREAD 16
+// Number of precomputed multiples of a public point stored by a prepared ECDSA verifier
+#define SIGNATURE_PRECOMPUTATION_STORAGE 16
+
+namespace key {
+	/**
+	 * @brief Exception thrown when we can't generate/verify a key
+	 */
+	struct InvalidKey : public std::runtime_error { using std::runtime_error::runtime_error; };
+}
+
+/**
+ * @brief Every signature scheme provides the same static interface:
+ *  - PublicKey, PrivateKey: The key types
+ *  - NAME: Human readable name of the scheme
+ *  - SIGNATURE_SIZE: Size (in bytes) of every signature
+ *  - generatePrivateKey, generatePublicKey: Key generation
+ *  - encodePublic, decodePublic: Conversion between a public key and its smallest binary form
+ *  - Verifier, makeVerifier: A reusable verifier for a single key (with any per key precomputation done up front)
+ *  - sign, verify: Signing and verification of a single message (verification against a key or a prepared verifier)
+ *  - verifyBatch: Verification of many messages at once
+ *  - print: Debug output of a key
+ */
+namespace key::scheme {
+	using byte = CryptoPP::byte;
+
+	// Function which views a string as a span of bytes
+	inline std::span<const byte> bytes(std::string_view view) { return { (const byte*) view.data(), view.size() }; }
+
+	/**
+	 * @brief A single signature to be checked as part of a batch
+	 *
+	 * @tparam Verifier - The type of verifier for the key the signature was made with
+	 */
+	template<typename Verifier>
+	struct VerificationJob {
+		const Verifier* verifier;
+		std::span<const byte> message;
+		std::span<const byte> signature;
+	};
+
+	// Function which verifies a batch of <count> signatures by splitting it between several threads
+	// <verifyChunk> is called with a range of indices and returns true if all of the signatures in that range are valid
+	bool verifyParallel(size_t count, const std::function<bool(size_t begin, size_t end)>& verifyChunk);
+
+	/**
+	 * @brief ECDSA (with SHA3_256) over secp160r1, the scheme the network originally used
+	 * @note Signatures are randomized and can not be batched beyond verifying them in parallel
+	 * @note Prepared verifiers hold precomputed multiples of the public point, which makes repeated verification against the same key several times cheaper
+	 */
+	struct ECDSA {
+		using Base = CryptoPP::ECDSA<CryptoPP::ECP, CryptoPP::SHA3_256>;
+		using PublicKey = Base::PublicKey;
+		using PrivateKey = Base::PrivateKey;
+		using Verifier = Base::Verifier;
+		using Job = VerificationJob<Verifier>;
+
+		static constexpr const char* NAME = "ECDSA (secp160r1)";
+		// Two integers the size of secp160r1's (161 bit) subgroup order
+		static constexpr size_t SIGNATURE_SIZE = 2 * 21;
+
+		static PrivateKey generatePrivateKey();
+		static PublicKey generatePublicKey(const PrivateKey& key);
+
+		static std::string encodePublic(const PublicKey& key);
+		static PublicKey decodePublic(std::string_view encoded);
+
+		static std::string sign(const PrivateKey& key, std::string_view message);
+		static std::unique_ptr<const Verifier> makeVerifier(const PublicKey& key);
+		static bool verify(const Verifier& verifier, std::span<const byte> message, std::span<const byte> signature);
+		static bool verify(const PublicKey& key, std::string_view message, std::string_view signature);
+		static bool verifyBatch(std::span<const Job> jobs);
+
+		static void print(const PrivateKey& key);
+		static void print(const PublicKey& key);
+	};
+
+	/**
+	 * @brief Ed25519, signatures are deterministic (no randomness needed to sign) and verification is much cheaper than ECDSA
+	 */
+	struct Ed25519 {
+		using PublicKey = CryptoPP::ed25519PublicKey;
+		using PrivateKey = CryptoPP::ed25519PrivateKey;
+		using Verifier = CryptoPP::ed25519Verifier;
+		using Job = VerificationJob<Verifier>;
+
+		static constexpr const char* NAME = "Ed25519";
+		static constexpr size_t SIGNATURE_SIZE = CryptoPP::ed25519PrivateKey::SIGNATURE_LENGTH;
+
+		static PrivateKey generatePrivateKey();
+		static PublicKey generatePublicKey(const PrivateKey& key);
+
+		static std::string encodePublic(const PublicKey& key);
+		static PublicKey decodePublic(std::string_view encoded);
+
+		static std::string sign(const PrivateKey& key, std::string_view message);
+		static std::unique_ptr<const Verifier> makeVerifier(const PublicKey& key);
+		static bool verify(const Verifier& verifier, std::span<const byte> message, std::span<const byte> signature);
+		static bool verify(const PublicKey& key, std::string_view message, std::string_view signature);
+		static bool verifyBatch(std::span<const Job> jobs);
+
+		static void print(const PrivateKey& key);
+		static void print(const PublicKey& key);
+	};
+
+} // key::scheme
+
+#endif /* end of include guard: SIGNATURE_HPP */
@@ -0,0 +1,131 @@
+/**
+ * @file sketch.hpp
+ * @author Joshua Dahl (jdahl@unr.edu)
+ * @brief File which provides a mergeable HyperLogLog sketch used to estimate the weight of a node's descendants
+ * @version 0.1
+ * @date 2021-12-09
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#ifndef SKETCH_HPP
+#define SKETCH_HPP
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <string_view>
+
+// Number of bits of an item's hash used to choose its register (the sketch has 2^precision registers, and an error of about 1.04 / sqrt(2^precision))
+#define WEIGHT_SKETCH_PRECISION 10
+// Number of sketch items which add up to a weight of 1 (a node of weight w is inserted as w * units distinct items)
+#define WEIGHT_SKETCH_UNITS 5
+
+/**
+ * @brief HyperLogLog sketch of a set of weighted items
+ * @note Sketches are merged by taking the maximum of each register, so merging is idempotent and a shared descendant reachable along several paths is only counted once
+ * @note Registers are atomic so that sketches can be merged and read from several threads at once
+ */
+struct WeightSketch {
+	// Number of registers in the sketch
+	static constexpr size_t REGISTERS = size_t(1) << WEIGHT_SKETCH_PRECISION;
+
+	/**
+	 * @brief Function which adds an item to the sketch
+	 *
+	 * @param itemHash - Well mixed 64 bit hash of the item
+	 * @return bool - True if the sketch changed
+	 */
+	bool add(uint64_t itemHash){
+		size_t index = itemHash >> (64 - WEIGHT_SKETCH_PRECISION);
+		uint8_t rank = std::countl_zero((itemHash << WEIGHT_SKETCH_PRECISION) | (uint64_t(1) << (WEIGHT_SKETCH_PRECISION - 1))) + 1;
+		return raise(index, rank);
+	}
+
+	/**
+	 * @brief Function which adds <units> items derived from <key> (see WEIGHT_SKETCH_UNITS)
+	 *
+	 * @param key - Unique identifier of the weighted item (the hash of a transaction)
+	 * @param units - How many units of weight the item carries
+	 * @return bool - True if the sketch changed
+	 */
+	bool addWeighted(std::string_view key, size_t units){
+		uint64_t base = std::hash<std::string_view>{}(key);
+		bool changed = false;
+		for(size_t i = 0; i < units; i++)
+			changed |= add(mix(base + i * 0x9E3779B97F4A7C15ull));
+		return changed;
+	}
+
+	/**
+	 * @brief Function which merges another sketch into this one (the union of the two sets)
+	 *
+	 * @param other - The sketch to merge in
+	 * @return bool - True if the sketch changed
+	 */
+	bool merge(const WeightSketch& other){
+		bool changed = false;
+		for(size_t i = 0; i < REGISTERS; i++)
+			changed |= raise(i, other.registers[i].load(std::memory_order_relaxed));
+		return changed;
+	}
+
+	/**
+	 * @brief Function which estimates the total number of items added to the sketch
+	 *
+	 * @return double - The estimated number of distinct items
+	 */
+	double estimate() const {
+		constexpr double m = REGISTERS;
+		constexpr double alpha = 0.7213 / (1 + 1.079 / m);
+
+		double sum = 0;
+		size_t zeros = 0;
+		for(auto& r: registers){
+			uint8_t value = r.load(std::memory_order_relaxed);
+			sum += std::ldexp(1.0, -value);
+			if(value == 0) zeros++;
+		}
+
+		// Small sets are estimated much more accurately by counting empty registers
+		double raw = alpha * m * m / sum;
+		if(raw <= 2.5 * m && zeros > 0)
+			return m * std::log(m / zeros);
+		return raw;
+	}
+
+	/**
+	 * @brief Function which estimates the total weight of the items added to the sketch
+	 */
+	double weight() const { return estimate() / WEIGHT_SKETCH_UNITS; }
+
+protected:
+	// Registers storing the longest run of leading zeros seen among the items assigned to them
+	std::array<std::atomic<uint8_t>, REGISTERS> registers = {};
+
+	/**
+	 * @brief Function which raises a register to at least <rank>
+	 *
+	 * @return bool - True if the register changed
+	 */
+	bool raise(size_t index, uint8_t rank){
+		uint8_t current = registers[index].load(std::memory_order_relaxed);
+		while(current < rank)
+			if(registers[index].compare_exchange_weak(current, rank, std::memory_order_relaxed))
+				return true;
+		return false;
+	}
+
+	/**
+	 * @brief Function which spreads the bits of a hash (SplitMix64 finalizer)
+	 */
+	static uint64_t mix(uint64_t x){
+		x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+		x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+		return x ^ (x >> 31);
+	}
+};
+
+#endif /* end of include guard: SKETCH_HPP */
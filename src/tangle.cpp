@@ -22,7 +22,7 @@
  * @param outputs - List of Transaction::Outputs
  * @param difficulty - The difficulty of mining this transaction
  */
-TransactionNode::TransactionNode(const std::vector<TransactionNode::const_ptr> parents, const std::vector<Input>& inputs, const std::vector<Output>& outputs, uint8_t difficulty /*= 3*/) :
+TransactionNode::TransactionNode(const std::vector<TransactionNode::const_ptr> parents, std::vector<Input> inputs, std::vector<Output> outputs, uint8_t difficulty /*= 3*/) :
 	// Construct the base transaction with the hashes of the parent nodes
 	Transaction([](const std::vector<TransactionNode::const_ptr>& parents) -> std::vector<std::string> {
 		// Make sure the node has no duplicate parents listed (comparing hashes)
@@ -35,7 +35,7 @@ TransactionNode::TransactionNode(const std::vector<TransactionNode::const_ptr> p
 		for(const TransactionNode::const_ptr& p: parents)
 			out.push_back(p->hash);
 		return out;
-	}(parents), inputs, outputs, difficulty), parents(parents) { }
+	}(parents), std::move(inputs), std::move(outputs), difficulty), parents(parents) { }
 
 /**
  * @brief Function which converts a transaction into a transaction node
@@ -45,36 +45,35 @@ TransactionNode::TransactionNode(const std::vector<TransactionNode::const_ptr> p
  * @param trx - The transaction to convert
  * @return TransactionNode::ptr - Pointer to the newly converted transaction
  */
-TransactionNode::ptr TransactionNode::create(const Tangle& t, const Transaction& trx) {
+template<TanglePolicies Policies>
+TransactionNode::ptr TransactionNode::create(const BasicTangle<Policies>& t, const Transaction& trx) {
 	std::vector<TransactionNode::const_ptr> parents;
 	for(Hash& hash: trx.parentHashes)
 		if(TransactionNode::const_ptr parent = t.find(hash); parent)
 			parents.push_back(parent);
-		else throw Tangle::NodeNotFoundException(hash);
+		else throw TangleBase::NodeNotFoundException(hash);
 
-	auto out = create(parents, trx.inputs, trx.outputs, trx.miningDifficulty);
-	util::mutable_cast(out->timestamp) = trx.timestamp;
-	util::mutable_cast(out->nonce) = trx.nonce;
-	util::mutable_cast(out->miningTarget) = trx.miningTarget;
-	util::mutable_cast(out->hash) = out->hashTransaction(); // Rehash since the timestamp and nonce have been overridden
-
-	return out;
+	// Wrap the transaction as is, it has already been hashed so there is no need to rehash it
+	return std::make_shared<TransactionNode>(parents, trx);
 }
 
 /**
- * @brief Create a transaction node, automatically mining and performing (G-IOTA) consensus on it
- * @note When this transaction is added to the tangle, verification of the transaction will automatically be preformed
+ * @brief Function which selects the parents a new transaction should approve, performing (G-IOTA) consensus
  * @note G-IOTA DOI: 10.1109/INFCOMW.2019.8845163
+ *
+ * @param t - The tangle to select tips from
+ * @return std::vector<TransactionNode::const_ptr> - The (distinct) parents
  */
-TransactionNode::ptr TransactionNode::createAndMine(const Tangle& t, const std::vector<Transaction::Input>& inputs, const std::vector<Transaction::Output>& outputs, uint8_t difficulty /*= 3*/){
+template<TanglePolicies Policies>
+std::vector<TransactionNode::const_ptr> TransactionNode::selectParents(const BasicTangle<Policies>& t){
 	// Select two different (unless there is only 1) tips at random
 	std::vector<TransactionNode::const_ptr> parents;
-	parents.push_back(t.biasedRandomWalk()); // Tip1 = front
-	parents.push_back(t.biasedRandomWalk()); // Tip2 = back
+	parents.push_back(t.selectTip()); // Tip1 = front
+	parents.push_back(t.selectTip()); // Tip2 = back
 	// 256 tries to find a different tip before giving up
 	for(auto [counter, tipCount] = std::make_pair(uint8_t(1), t.tips.read_lock()->size());
 	  tipCount > 1 && parents.front() == parents.back() && counter != 0; counter++)
-		parents.back() = t.biasedRandomWalk();
+		parents.back() = t.selectTip();
 
 	if(!parents.front() || !parents.back()) throw std::runtime_error("Failed to find a tip!");
 
@@ -93,9 +92,18 @@ TransactionNode::ptr TransactionNode::createAndMine(const Tangle& t, const std::
 
 	// Ensure that each node only appears once in the list of parents
 	util::removeDuplicates(parents);
+	return parents;
+}
 
+/**
+ * @brief Create a transaction node, automatically mining and performing (G-IOTA) consensus on it
+ * @note When this transaction is added to the tangle, verification of the transaction will automatically be preformed
+ * @note G-IOTA DOI: 10.1109/INFCOMW.2019.8845163
+ */
+template<TanglePolicies Policies>
+TransactionNode::ptr TransactionNode::createAndMine(const BasicTangle<Policies>& t, const std::vector<Transaction::Input>& inputs, const std::vector<Transaction::Output>& outputs, uint8_t difficulty /*= 3*/){
 	// Create and mine the transaction
-	TransactionNode::ptr trx = TransactionNode::create(parents, inputs, outputs, difficulty);
+	TransactionNode::ptr trx = TransactionNode::create(selectParents(t), inputs, outputs, difficulty);
 	trx->mineTransaction();
 	return trx;
 }
@@ -286,18 +294,25 @@ TransactionNode::const_ptr TransactionNode::biasedRandomWalk(double alpha /*= 10
 		return shared_from_this();
 
 	// Variable that stores the generated weighted list
-	std::vector<std::pair<TransactionNode::const_ptr, double>> weightedList(lock->size());
+	std::vector<std::pair<TransactionNode::const_ptr, double>> weightedList;
+	weightedList.reserve(lock->size());
 	// Variable that stores the total weight of the list
 	double totalWeight = 0;
 
-	// Create a weighted list of children
-	for(size_t i = 0; i < weightedList.size(); i++){
+	// Create a weighted list of children (skipping the subtangles on the losing side of a double-spend conflict)
+	for(size_t i = 0; i < lock->size(); i++){
 		TransactionNode::const_ptr child = lock[i];
+		if(child->conflictLoser()) continue;
+
 		double weight = std::max( std::exp(-alpha * (cumulativeWeight - child->cumulativeWeight)), std::numeric_limits<double>::min() );
-		weightedList[i] = {child, weight};
+		weightedList.emplace_back(child, weight);
 		totalWeight += weight;
 	}
 
+	// If every child is avoided, treat us as the tip
+	if(weightedList.empty())
+		return shared_from_this();
+
 	// Randomly choose a child from the weighted list
 	double random = util::rand2double(rng.GenerateWord32(), rng.GenerateWord32()) * totalWeight;
 	auto chosen = weightedList.begin();
@@ -368,6 +383,389 @@ float TransactionNode::confirmationConfidence() const {
 	return confidence / float(walkList.size());
 }
 
+/**
+ * @brief Function which determines if this node is (or approves) a transaction which lost a double-spend conflict
+ *
+ * @return bool - True if tip selection should avoid this node
+ */
+bool TransactionNode::conflictLoser() const {
+	auto lock = conflicts.read_lock();
+	for(size_t i = 0; i < lock->size(); i++)
+		if(!lock[i].set->preferred(lock[i].member))
+			return true;
+	return false;
+}
+
+
+// -- Conflicts --
+
+
+/**
+ * @brief Function which adds a transaction to the conflict
+ *
+ * @param member - The conflicting transaction
+ */
+void ConflictSet::add(const std::shared_ptr<const TransactionNode>& member){
+	std::scoped_lock lock(mutex);
+	for(auto& existing: members)
+		if(existing.lock() == member)
+			return;
+	members.push_back(member);
+}
+
+/**
+ * @brief Function which determines if the given member is the side of the conflict the network should build on
+ *
+ * @param memberHash - Hash of the member to check
+ * @return bool - True if the member is the heaviest remaining member of the conflict (ties broken by hash)
+ */
+bool ConflictSet::preferred(const std::string& memberHash) const {
+	std::scoped_lock lock(mutex);
+	TransactionNode::const_ptr best = nullptr;
+	for(auto& weak: members)
+		if(auto member = weak.lock())
+			if(!best || member->cumulativeWeight > best->cumulativeWeight
+			  || (member->cumulativeWeight == best->cumulativeWeight && member->hash < best->hash))
+				best = member;
+
+	// If every member has been pruned, the conflict has been settled
+	return !best || best->hash == memberHash;
+}
+
+/**
+ * @brief Function which determines if the conflict has been decided
+ *
+ * @return bool - True if a member has gathered enough weight to be settled, or at most one member remains unpruned
+ */
+bool ConflictSet::resolved() const {
+	std::scoped_lock lock(mutex);
+	size_t remaining = 0;
+	for(auto& weak: members)
+		if(auto member = weak.lock()){
+			if(member->cumulativeWeight >= CONFLICT_SETTLED_WEIGHT) return true;
+			remaining++;
+		}
+	return remaining <= 1;
+}
+
+/**
+ * @brief Creates an empty index
+ *
+ * @param shards - The number of shards to partition accounts into (by default one per core)
+ */
+ConflictIndex::ConflictIndex(size_t shards /*= hardware concurrency*/){
+	for(size_t i = 0; i < std::max<size_t>(shards, 1); i++)
+		this->shards.push_back(std::make_unique<Shard>());
+}
+
+/**
+ * @brief Function which locks every shard a node's inputs or outputs touch (in ascending order, so nodes spanning shards can't deadlock each other)
+ *
+ * @param node - The node whose shards should be locked
+ * @return std::vector<std::unique_lock<std::mutex>> - The locks (released when destroyed)
+ */
+std::vector<std::unique_lock<std::mutex>> ConflictIndex::lockShards(const TransactionNode& node){
+	std::vector<size_t> touched;
+	for(const Transaction::Input& input: node.inputs)
+		touched.push_back(input.accountID() % shards.size());
+	for(const Transaction::Output& output: node.outputs)
+		touched.push_back(output.accountID() % shards.size());
+	std::sort(touched.begin(), touched.end());
+	touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+
+	std::vector<std::unique_lock<std::mutex>> locks;
+	for(size_t shard: touched)
+		locks.emplace_back(shards[shard]->mutex);
+	return locks;
+}
+
+/**
+ * @brief Function which locks every shard (in ascending order)
+ *
+ * @return std::vector<std::unique_lock<std::mutex>> - The locks (released when destroyed)
+ */
+std::vector<std::unique_lock<std::mutex>> ConflictIndex::lockAll(){
+	std::vector<std::unique_lock<std::mutex>> locks;
+	for(auto& shard: shards)
+		locks.emplace_back(shard->mutex);
+	return locks;
+}
+
+/**
+ * @brief Function which validates a new node's spends against the index and records it
+ * @note Must be called before the node is linked into the tangle, only the shards the node touches are locked (unless it turns out to be part of a double spend)
+ *
+ * @param node - The node to add
+ * @param generation - (Optional) The generation of the index the node was validated against, if the index has been rebuilt since the node isn't recorded (and an exception is thrown)
+ * @param resolve - (Optional) Function which interns the accounts the node introduces (only its inputs are checked, they must already be interned), called once the node is known not to overdraw
+ * @return std::optional<Overdraft> - The account the node overdraws (in which case nothing is recorded), or nothing if the node was recorded
+ */
+std::optional<ConflictIndex::Overdraft> ConflictIndex::add(const TransactionNode::ptr& node, std::optional<size_t> generation /*= {}*/, const std::function<void()>& resolve /*= {}*/){
+	// Total how much the node takes from each account
+	std::unordered_map<key::AccountID, double> debits;
+	for(const Transaction::Input& input: node->inputs)
+		debits[input.accountID()] += input.amount;
+
+	// Check every account before modifying any of them (holding every shard if the node has accounts which don't have a shard yet)
+	auto locks = resolve ? lockAll() : lockShards(*node);
+	// NOTE: rebuilds hold every shard, so the generation can't change while we hold any of them
+	if(generation && *generation != generations)
+		throw std::runtime_error("The tangle's genesis changed while transaction with hash `" + node->hash + "` was being added, discarding.");
+	std::vector<key::AccountID> conflicting;
+	if(auto overdraft = check(*node, debits, conflicting))
+		return overdraft;
+
+	// If the node is part of a double spend... check it again holding every shard (marking the conflict holds back deposits the node's shards don't cover)
+	if(!conflicting.empty() && !resolve){
+		locks.clear();
+		locks = lockAll();
+		conflicting.clear();
+		if(auto overdraft = check(*node, debits, conflicting))
+			return overdraft;
+	}
+
+	// The node will be recorded, give its new accounts their IDs
+	if(resolve) resolve();
+
+	// Group the node with the spends it conflicts with (before it is recorded, so its own deposits are held back)
+	if(!conflicting.empty())
+		markConflict(node, conflicting);
+	record(node);
+	return {};
+}
+
+/**
+ * @brief Function which checks whether a node's spends are covered by the balances of the accounts they spend from
+ * @note The shards the node touches must be locked
+ *
+ * @param node - The node to check
+ * @param debits - How much the node takes from each account
+ * @param conflicting - Set to the accounts whose funds the node spends a second time
+ * @return std::optional<Overdraft> - The account the node overdraws, or nothing if every spend is covered (possibly by conflicting with concurrent spends)
+ */
+std::optional<ConflictIndex::Overdraft> ConflictIndex::check(const TransactionNode& node, const std::unordered_map<key::AccountID, double>& debits, std::vector<key::AccountID>& conflicting){
+	std::optional<std::optional<std::unordered_set<const TransactionNode*>>> ancestors;
+	for(auto& [id, amount]: debits){
+		Account& account = entry(id);
+		settle(account);
+
+		double remaining = account.balance - amount;
+		if(remaining >= 0) continue;
+
+		// If the spend would be covered were the account's concurrent unsettled spends dropped... it conflicts with them, otherwise it is an overdraft
+		// NOTE: spends the node approves are on the same branch as it, so they can't be dropped in its favor
+		if(!ancestors) ancestors = unsettledAncestors(node);
+		double concurrent = 0;
+		if(*ancestors)
+			for(auto& debit: account.pending)
+				if(auto spend = debit.node.lock(); spend && !(*ancestors)->contains(spend.get()))
+					concurrent += debit.amount;
+
+		if(concurrent > 0 && remaining + concurrent >= 0)
+			conflicting.push_back(id);
+		else return Overdraft{id, remaining};
+	}
+	return {};
+}
+
+/**
+ * @brief Function which recalculates the index from scratch (used when the genesis changes)
+ * @note Double spends are detected again as the tangle is indexed, overdrafts the tangle already accepted are recorded regardless
+ *
+ * @param genesis - The genesis of the tangle to index
+ */
+void ConflictIndex::rebuild(const TransactionNode::ptr& genesis){
+	auto locks = lockAll();
+	generations++;
+	for(auto& shard: shards)
+		shard->accounts.clear();
+	if(!genesis) return;
+
+	std::unordered_set<const TransactionNode*> considered;
+	std::queue<TransactionNode::ptr> q; q.push(genesis);
+	while(!q.empty()){
+		auto head = q.front();
+		q.pop();
+		if(!head || !considered.insert(head.get()).second) continue;
+
+		std::unordered_map<key::AccountID, double> debits;
+		for(const Transaction::Input& input: head->inputs)
+			debits[input.accountID()] += input.amount;
+		std::vector<key::AccountID> conflicting;
+		check(*head, debits, conflicting);
+		if(!conflicting.empty())
+			markConflict(head, conflicting);
+		record(head);
+
+		auto childLock = head->children.read_lock();
+		for(size_t i = 0; i < childLock->size(); i++)
+			q.push(childLock[i]);
+	}
+
+	for(auto& shard: shards)
+		for(auto& [id, account]: shard->accounts)
+			settle(account);
+}
+
+/**
+ * @brief Function which adds a node's spends and deposits to the index (without any validation)
+ * @note The shards the node touches must be locked
+ *
+ * @param node - The node to record
+ */
+void ConflictIndex::record(const TransactionNode::ptr& node){
+	for(const Transaction::Input& input: node->inputs){
+		Account& account = entry(input.accountID());
+		account.balance -= input.amount;
+		account.pending.push_back({node, input.amount});
+		account.pendingTotal += input.amount;
+	}
+
+	// Deposits made by a member of a conflict are held back until it is resolved
+	if(auto conflict = ownConflict(*node))
+		holdDeposits(*node, *conflict);
+	else for(const Transaction::Output& output: node->outputs)
+		entry(output.accountID()).balance += output.amount;
+}
+
+/**
+ * @brief Function which holds back a conflicting node's deposits until its conflict is resolved
+ * @note The shards the node's outputs touch must be locked, any deposits already credited must be taken back first
+ *
+ * @param node - The node whose deposits should be held
+ * @param mark - The node's membership in the conflict
+ */
+void ConflictIndex::holdDeposits(const TransactionNode& node, const ConflictMark& mark){
+	for(const Transaction::Output& output: node.outputs)
+		entry(output.accountID()).held.push_back({mark, output.amount});
+}
+
+/**
+ * @brief Function which applies resolved conflicts to an account and drops its spends which have been settled (pruned, heavy enough, or too old to track)
+ * @note The losing members of a conflict never happened, their spends are refunded and their deposits dropped
+ *
+ * @param account - The account to update
+ */
+void ConflictIndex::settle(Account& account){
+	std::erase_if(account.pending, [&account](const PendingDebit& debit){
+		auto node = debit.node.lock();
+		bool settled = !node;
+		if(node){
+			if(auto conflict = ownConflict(*node)){
+				settled = conflict->set->resolved();
+				if(settled && !conflict->set->preferred(conflict->member))
+					account.balance += debit.amount;
+			} else settled = node->cumulativeWeight >= CONFLICT_SETTLED_WEIGHT;
+		}
+
+		if(settled) account.pendingTotal -= debit.amount;
+		return settled;
+	});
+
+	std::erase_if(account.held, [&account](const HeldCredit& credit){
+		if(!credit.mark.set->resolved()) return false;
+		if(credit.mark.set->preferred(credit.mark.member))
+			account.balance += credit.amount;
+		return true;
+	});
+
+	// Stop tracking the oldest spends past the limit (unless they are waiting on a conflict, which would lose their refund)
+	for(auto debit = account.pending.begin(); account.pending.size() > CONFLICT_MAX_PENDING && debit != account.pending.end(); )
+		if(auto node = debit->node.lock(); node && ownConflict(*node))
+			debit++;
+		else {
+			account.pendingTotal -= debit->amount;
+			debit = account.pending.erase(debit);
+		}
+}
+
+/**
+ * @brief Function which finds the conflict a node is a member of (rather than only approving)
+ *
+ * @param node - The node to check
+ * @return std::optional<ConflictMark> - The node's membership, or nothing if it isn't a member of a conflict
+ */
+std::optional<ConflictMark> ConflictIndex::ownConflict(const TransactionNode& node){
+	auto lock = node.conflicts.read_lock();
+	for(size_t i = 0; i < lock->size(); i++)
+		if(lock[i].member == node.hash)
+			return lock[i];
+	return {};
+}
+
+/**
+ * @brief Function which finds the unsettled transactions a node (directly or indirectly) approves
+ * @note A settled transaction can't approve an unsettled one (it would be at least as heavy), so the walk stops at settled transactions
+ *
+ * @param node - The node to start from
+ * @return std::optional<std::unordered_set<const TransactionNode*>> - The unsettled ancestors, or nothing if there are more than CONFLICT_ANCESTRY_LIMIT of them
+ */
+std::optional<std::unordered_set<const TransactionNode*>> ConflictIndex::unsettledAncestors(const TransactionNode& node){
+	std::unordered_set<const TransactionNode*> ancestors;
+	std::queue<const TransactionNode*> q;
+	for(auto& parent: node.parents)
+		q.push(parent.get());
+
+	while(!q.empty()){
+		auto head = q.front();
+		q.pop();
+		if(!head || head->isGenesis || head->cumulativeWeight >= CONFLICT_SETTLED_WEIGHT || !ancestors.insert(head).second) continue;
+		if(ancestors.size() > CONFLICT_ANCESTRY_LIMIT) return {};
+
+		for(auto& parent: head->parents)
+			q.push(parent.get());
+	}
+	return ancestors;
+}
+
+/**
+ * @brief Function which places a node in the same conflict as the concurrent unsettled spends of the accounts it spends twice
+ * @note Every shard must be locked
+ *
+ * @param node - The conflicting node
+ * @param accounts - The accounts whose funds are being spent twice
+ */
+void ConflictIndex::markConflict(const TransactionNode::ptr& node, const std::vector<key::AccountID>& accounts){
+	// Gather the other (concurrent) spends
+	auto ancestors = unsettledAncestors(*node).value_or(std::unordered_set<const TransactionNode*>{});
+	std::vector<TransactionNode::const_ptr> members;
+	for(key::AccountID id: accounts)
+		for(auto& debit: entry(id).pending)
+			if(auto member = debit.node.lock(); member && member != node && !ancestors.contains(member.get())
+			  && std::find(members.begin(), members.end(), member) == members.end())
+				members.push_back(member);
+
+	// Reuse a conflict one of the members is already in, otherwise start a new one
+	std::shared_ptr<ConflictSet> set = nullptr;
+	for(auto& member: members)
+		if(auto conflict = ownConflict(*member)){
+			set = conflict->set;
+			break;
+		}
+	if(!set) set = std::make_shared<ConflictSet>();
+
+	// Add every member (and the node) to the conflict, marking them
+	members.push_back(node);
+	for(auto& member: members){
+		// Members which weren't already in a conflict had their deposits credited, take them back until the conflict is resolved
+		bool credited = member != node && !ownConflict(*member);
+		set->add(member);
+
+		ConflictMark mark = {set, member->hash};
+		{
+			auto lock = util::mutable_cast(member->conflicts).write_lock();
+			if(std::find(lock->begin(), lock->end(), mark) == lock->end())
+				lock->push_back(mark);
+		}
+
+		if(credited){
+			for(const Transaction::Output& output: member->outputs)
+				entry(output.accountID()).balance -= output.amount;
+			holdDeposits(*member, mark);
+		}
+	}
+}
+
 
 // -- Tangle --
 
@@ -377,23 +775,33 @@ float TransactionNode::confirmationConfidence() const {
  *
  * @param genesis - The new genesis
  */
-void Tangle::setGenesis(TransactionNode::ptr genesis){
-	// Mark the new node as the genesis
-	if(genesis) util::mutable_cast(genesis->isGenesis) = true;
+template<TanglePolicies Policies>
+void BasicTangle<Policies>::setGenesis(TransactionNode::ptr genesis){
+	// Mark the new node as the genesis (and add the accounts it introduces to the account table)
+	if(genesis){
+		util::mutable_cast(genesis->isGenesis) = true;
+		genesis->internAccounts();
+	}
+
+	{ // Begin Critical Region (so adds can't link nodes into the graph while it is being replaced)
+		std::scoped_lock lock(mutex);
 
-	// Free the memory for every child of the old genesis (if it exists)
-	if(this->genesis)
-		for(auto lock = this->genesis->children.read_lock(); !lock->empty(); )
-			for(auto [i, tipsLock] = std::make_pair(size_t(0), util::mutable_cast(tips).read_lock()); i < tipsLock->size(); i++)
-				removeTip(tipsLock[0]);
+		// Free the memory for every child of the old genesis (if it exists)
+		if(this->genesis)
+			for(auto lock = this->genesis->children.read_lock(); !lock->empty(); )
+				for(auto [i, tipsLock] = std::make_pair(size_t(0), util::mutable_cast(tips).read_lock()); i < tipsLock->size(); i++)
+					removeTip(tipsLock[0]);
 
-	// Update the genesis
-	util::mutable_cast(this->genesis) = genesis;
+		// Update the genesis (and start storing the new graph)
+		util::mutable_cast(this->genesis) = genesis;
+		storage.reset(genesis);
+
+		// Reindex the balances of the new tangle
+		conflictIndex.rebuild(genesis);
+	} // End Critical Region
 
-	// If we are updating weights... start updating weights
-	if(updateWeights) std::thread([this](){
-		updateCumulativeWeights(this->genesis);
-	}).detach();
+	// Start updating weights
+	scheduleWeightUpdate(genesis);
 }
 
 //
@@ -401,9 +809,11 @@ void Tangle::setGenesis(TransactionNode::ptr genesis){
  * @brief Function which adds a node to the tangle, validates that the node is acceptable before adding it
  *
  * @param node - The node to add
+ * @param updateWeights - (Optional) Whether the weights of the node's ancestors should be recalculated (bulk additions skip this and update every weight once they are done)
  * @return Hash - Hash of the node once added
  */
-Hash Tangle::add(const TransactionNode::ptr node){
+template<TanglePolicies Policies>
+Hash BasicTangle<Policies>::add(const TransactionNode::ptr node, bool updateWeights /*= true*/){
 	// Ensure that the transaction passes verification
 	if(!node->validateTransaction())
 		throw std::runtime_error("Transaction with hash `" + node->hash + "` failed to pass validation, discarding.");
@@ -414,36 +824,8 @@ Hash Tangle::add(const TransactionNode::ptr node){
 	if(!node->validateTransactionMined())
 		throw std::runtime_error("Transaction with hash `" + node->hash + "` wasn't mined, discarding.");
 
-	// Validate that the inputs to this transaction do not cause their owner's balance to go into the negatives
-	std::vector<std::pair<key::PublicKey, double>> balanceMap; // List acting as a bootleg map of keys to balances
-	for(const Transaction::Input& input: node->inputs){
-		auto inputAccount = input.account();
-		// The account's balance is invalid
-		double balance = -1;
-
-		// If the account's balance is cached... use the cached balance
-		int i = 0;
-		for(auto& [account, bal]: balanceMap){
-			i++;
-			if(account == inputAccount){
-				balance = bal;
-				break;
-			}
-		}
-		// Otherwise... query its balance
-		if(balance < 0) balance = queryBalance(inputAccount);
-
-		// Subtace the input from the balance and ensure it doesn't cause the transaction to go into the negatives
-		balance -= input.amount;
-		if(balance < 0)
-			throw InvalidBalance(node, inputAccount, balance);
-
-		// Cache the balance (adding to the list if not already present)
-		if(i == balanceMap.size())
-			balanceMap.emplace_back(inputAccount, balance);
-		else balanceMap[i].second = balance;
-	}
-
+	// Note which version of the index the node is validated against (if the genesis changes before the node is linked, its parents are gone)
+	size_t generation = conflictIndex.generation();
 
 	// For each parent of the new node... preform error validation
 	for(const TransactionNode::const_ptr& parent: node->parents) {
@@ -457,10 +839,57 @@ Hash Tangle::add(const TransactionNode::ptr node){
 				throw std::runtime_error("Transaction with hash `" + parent->hash + "` already has a child with hash `" + node->hash + "`");
 	}
 
+	// Reserve the node's hash until it is linked (or rejected), so a duplicate added concurrently is rejected before it is recorded in the conflict index
+	struct Reservation {
+		BasicTangle& t;
+		const Hash& hash;
+		~Reservation() { std::scoped_lock lock(t.inFlightMutex); t.inFlight.erase(hash); }
+	};
+	{
+		std::scoped_lock lock(inFlightMutex);
+		if(find(node->hash) || !inFlight.insert(node->hash).second)
+			throw std::runtime_error("Transaction with hash `" + node->hash + "` is already in (or being added to) the tangle, discarding.");
+	}
+	Reservation reservation{*this, node->hash};
+
+	// Transactions which introduce accounts (to the account table) are only recorded once nothing else can reject them, so rejected transactions don't grow the table
+	// NOTE: an account which isn't in the table has never been paid, so spending from one is always an overdraft
+	bool introducesAccounts = !node->accountsInterned();
+	for(const Transaction::Input& input: node->inputs)
+		if(!input.interned())
+			throw std::runtime_error("Transaction with hash `" + node->hash + "` spends from an account which has never been paid, discarding.");
+
+	// Validate that the inputs to this transaction do not cause their owner's balance to go into the negatives (recording any double spends it causes)
+	// NOTE: the index only locks the shards of the accounts the transaction touches, so transactions between unrelated accounts are validated in parallel
+	// NOTE: if the genesis changed since the checks above the node isn't recorded (the rebuilt index never sees it)
+	if(!introducesAccounts)
+		if(auto overdraft = conflictIndex.add(node, generation))
+			throw InvalidBalance(node, key::AccountTable::lookup(overdraft->account), overdraft->balance);
 
 	{ // Begin Critical Region
 		std::scoped_lock lock(mutex);
 
+		// The genesis may have changed after the node was recorded, if it did the rebuild already dropped the node's record (and its parents may be gone)
+		// NOTE: duplicates can't slip in between the checks above and here, the reservation keeps them out
+		if(conflictIndex.generation() != generation)
+			throw std::runtime_error("The tangle's genesis changed while transaction with hash `" + node->hash + "` was being added, discarding.");
+
+		// Now that nothing but its balance can reject it... check and record a transaction which introduces accounts, interning them only once it is known to be recorded
+		if(introducesAccounts)
+			if(auto overdraft = conflictIndex.add(node, generation, [&node](){ node->internAccounts(); }))
+				throw InvalidBalance(node, key::AccountTable::lookup(overdraft->account), overdraft->balance);
+
+		// Inherit the conflicts of every node this node approves
+		{
+			auto conflictLock = node->conflicts.write_lock();
+			for(const TransactionNode::const_ptr& parent: node->parents){
+				auto parentLock = parent->conflicts.read_lock();
+				for(size_t i = 0; i < parentLock->size(); i++)
+					if(std::find(conflictLock->begin(), conflictLock->end(), parentLock[i]) == conflictLock->end())
+						conflictLock->push_back(parentLock[i]);
+			}
+		}
+
 		// For each parent of the new node...
 		// NOTE: this happens in a second loop since we need to ensure all of the parents are valid before we add the node as a child of any of them
 		for(const TransactionNode::const_ptr& parent: node->parents){
@@ -474,10 +903,14 @@ Hash Tangle::add(const TransactionNode::ptr node){
 			tipsLock->push_back(node);
 		}
 
+		// Store the node so it can be found
+		storage.insert(node);
+
+		// Journal the node (the commit happens in the background so we don't hold the lock while waiting on the disk)
+		if(journal) journal->append(*node);
+
 		// Update the weights of all the nodes aproved by this node
-		if(updateWeights) std::thread([this, node](){
-			updateCumulativeWeights(node);
-		}).detach();
+		if(updateWeights) scheduleWeightUpdate(node);
 
 		// Add the current tips as canidate to become a new genesis
 		if (auto tipsLock = tips.read_lock(); tipsLock->size() <= GENESIS_CANDIDATE_THRESHOLD)
@@ -494,7 +927,8 @@ Hash Tangle::add(const TransactionNode::ptr node){
  *
  * @param tip - The tip to remove
  */
-void Tangle::removeTip(TransactionNode::const_ptr tip){
+template<TanglePolicies Policies>
+void BasicTangle<Policies>::removeTip(TransactionNode::const_ptr tip){
 	// Make sure the pointer is valid
 	if(!tip) return;
 
@@ -522,6 +956,9 @@ void Tangle::removeTip(TransactionNode::const_ptr tip){
 		// Remove the node from the list of tips
 		std::erase(util::mutable_cast(tips.unsafe()), tip);
 
+		// Stop storing the node
+		storage.erase(tip->hash);
+
 		// Clear the list of parents
 		util::mutable_cast(tip->parents).clear();
 	} // End Critical Region
@@ -537,7 +974,8 @@ void Tangle::removeTip(TransactionNode::const_ptr tip){
  * @param confidenceThreshold - (Optional) Confidence threshold the node must be above to be considered in the calculation
  * @return double - The account's balance
  */
-double Tangle::queryBalance(const key::PublicKey& account, float confidenceThreshold /*= 0*/) const {
+template<TanglePolicies Policies>
+double BasicTangle<Policies>::queryBalance(key::AccountID account, float confidenceThreshold /*= 0*/) const {
 	std::list<std::string> considered;
 	// The queue starts with the genesis
 	std::queue<TransactionNode::ptr> q; q.push(genesis);
@@ -549,21 +987,22 @@ double Tangle::queryBalance(const key::PublicKey& account, float confidenceThres
 		q.pop();
 		if(!head) continue;
 
-		// Add up how this transaction takes away from the balance of interest
+		// Add up how this transaction takes away from the balance of interest (ignoring transactions which lost a double-spend conflict)
+		bool counted = !head->conflictLoser();
 		for(const Transaction::Input& input: head->inputs)
-			if(input.account() == account)
+			if(counted && input.accountID() == account)
 				balance -= input.amount;
 		// If the balance becomes negative except
 		if(balance < 0)
-			throw InvalidBalance(head, account, balance);
+			throw InvalidBalance(head, key::AccountTable::lookup(account), balance);
 
 		// Add up how this transaction adds to the balance of interest
 		for(const Transaction::Output& output: head->outputs)
-			if(output.account() == account)
+			if(counted && output.accountID() == account)
 				balance += output.amount;
 		// If the balance becomes negative except
 		if(balance < 0)
-			throw InvalidBalance(head, account, balance);
+			throw InvalidBalance(head, key::AccountTable::lookup(account), balance);
 
 		// Add the children to the queue (if they have sufficient confidence and/or haven't already been considered)
 		{
@@ -583,10 +1022,17 @@ double Tangle::queryBalance(const key::PublicKey& account, float confidenceThres
 
 /**
  * @brief Function which updates the weights of nodes working backwards from a <source> node
+ * @note Each node's descendant sketch is merged into its parents, propagation stops along any path where merging doesn't change the parent's sketch
  * 
  * @param source The node to work backwards from
  */
-void Tangle::updateCumulativeWeights(TransactionNode::const_ptr source){
+template<TanglePolicies Policies>
+void BasicTangle<Policies>::updateCumulativeWeights(TransactionNode::const_ptr source){
+	if(!source) return;
+	auto mutableSource = util::mutable_cast(source.get());
+	mutableSource->sketchOwnWeight(Policies::Weight::ownWeight(*source));
+	util::mutable_cast(source->cumulativeWeight) = source->descendants.weight();
+
 	// Add the source node to the queue
 	std::queue<TransactionNode::const_ptr> q; q.push(source);
 
@@ -594,16 +1040,33 @@ void Tangle::updateCumulativeWeights(TransactionNode::const_ptr source){
 	while(!q.empty()){
 		auto head = q.front();
 		q.pop();
-		if(!head) continue;
-
-		// Update the weight of this node based on the weights of the children
-		float cumulativeWeight = head->ownWeight();
-		for(size_t i = 0, size = head->children.read_lock()->size(); i < size; i++)
-			cumulativeWeight += head->children.read_lock()[i]->cumulativeWeight;
-		util::mutable_cast(head->cumulativeWeight) = cumulativeWeight;
 
-		// Add this node's parents to the back of the queue
-		for(auto& parent: head->parents)
-			q.push(parent);
+		// Merge this node's sketch into each of its parents
+		for(auto& parent: head->parents){
+			if(!parent) continue;
+			auto mutableParent = util::mutable_cast(parent.get());
+			bool changed = mutableParent->sketchOwnWeight(Policies::Weight::ownWeight(*parent));
+			changed |= mutableParent->descendants.merge(head->descendants);
+
+			// If the parent learned about new descendants... update its weight and pass them along to its parents
+			if(changed){
+				util::mutable_cast(parent->cumulativeWeight) = parent->descendants.weight();
+				q.push(parent);
+			}
+		}
 	}
 }
+
+
+// -- Instantiations --
+
+
+// Instantiates a tangle specialized with <Policies> (and the node functions which operate on it)
+#define INSTANTIATE_TANGLE(Policies) \
+	template struct BasicTangle<Policies>; \
+	template TransactionNode::ptr TransactionNode::create(const BasicTangle<Policies>& t, const Transaction& trx); \
+	template std::vector<TransactionNode::const_ptr> TransactionNode::selectParents(const BasicTangle<Policies>& t); \
+	template TransactionNode::ptr TransactionNode::createAndMine(const BasicTangle<Policies>& t, const std::vector<Transaction::Input>& inputs, const std::vector<Transaction::Output>& outputs, uint8_t difficulty);
+
+INSTANTIATE_TANGLE(DefaultTanglePolicies)
+INSTANTIATE_TANGLE(SingleThreadedTanglePolicies)
@@ -11,20 +11,131 @@
 #ifndef TANGLE_HPP
 #define TANGLE_HPP
 
+#include <atomic>
+#include <concepts>
+#include <deque>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "monitor.hpp"
 #include "circular_buffer.hpp"
 
 #include "transaction.hpp"
+#include "sketch.hpp"
+#include "wal.hpp"
 
 // The number of tips there can be at most in a given instant of time to qualify to be converted into a genesis
 #define GENESIS_CANDIDATE_THRESHOLD 3
 // How many levels behind the current tips a transaction needs to be before it is considered left behind
 #define LEFT_BEHIND_TIP_THRESHOLD 5
 
+// Cumulative weight a spend needs before it is considered settled (and can no longer be part of a new double-spend conflict)
+#define CONFLICT_SETTLED_WEIGHT 10
+// Maximum number of unsettled spends tracked per account (the oldest are considered settled past this)
+#define CONFLICT_MAX_PENDING 64
+// Maximum number of unsettled transactions walked to determine which spends a new transaction approves (a spend with more is treated as an overdraft)
+#define CONFLICT_ANCESTRY_LIMIT 4096
+
 // Tangle forward declaration
-struct Tangle;
+struct TransactionNode;
+
+
+// -- Policy Concepts --
+
+
+/**
+ * @brief Policy which picks the tip a new transaction should approve
+ * @note Called with the tangle's genesis and its list of tips
+ */
+template<typename P>
+concept TipSelectionPolicy = requires(const TransactionNode& genesis, const monitor<std::vector<std::shared_ptr<const TransactionNode>>>& tips) {
+	{ P::selectTip(genesis, tips) } -> std::convertible_to<std::shared_ptr<const TransactionNode>>;
+};
+
+/**
+ * @brief Policy which determines how much weight a transaction contributes to those it (directly or indirectly) approves
+ */
+template<typename P>
+concept WeightPolicy = requires(const TransactionNode& node) {
+	{ P::ownWeight(node) } -> std::convertible_to<float>;
+};
+
+/**
+ * @brief Policy which determines how nodes are found in the graph
+ * @note The tangle notifies the storage whenever a node is added, removed, or the graph is replaced by a new genesis
+ */
+template<typename P>
+concept StoragePolicy = std::default_initializable<P> && requires(P storage, const P constStorage, const std::shared_ptr<TransactionNode>& node, const std::string& hash) {
+	storage.insert(node);
+	storage.erase(hash);
+	storage.reset(node);
+	{ constStorage.find(node, hash) } -> std::convertible_to<std::shared_ptr<TransactionNode>>;
+};
+
+/**
+ * @brief Policy which provides the mutex synchronizing modifications to the graph
+ * @note Tangles whose locking isn't concurrent update weights inline rather than in background threads
+ */
+template<typename P>
+concept LockingPolicy = requires(typename P::mutex_type& mutex) {
+	mutex.lock();
+	mutex.unlock();
+	{ P::concurrent } -> std::convertible_to<bool>;
+};
+
+/**
+ * @brief Set of policies a tangle is specialized with
+ */
+template<typename P>
+concept TanglePolicies = TipSelectionPolicy<typename P::TipSelection> && WeightPolicy<typename P::Weight>
+	&& StoragePolicy<typename P::Storage> && LockingPolicy<typename P::Locking>;
+
+template<TanglePolicies Policies>
+struct BasicTangle;
+
+/**
+ * @brief Group of transactions which spend the same funds on concurrent branches of the tangle
+ * @note Only the heaviest member (ties broken by hash) is preferred, tip selection avoids the subtangles of the rest
+ */
+struct ConflictSet {
+	void add(const std::shared_ptr<const TransactionNode>& member);
+	bool preferred(const std::string& memberHash) const;
+	bool resolved() const;
+
+protected:
+	// Mutex protecting the members
+	mutable std::mutex mutex;
+	// Transactions in the conflict
+	std::vector<std::weak_ptr<const TransactionNode>> members;
+};
+
+/**
+ * @brief Marks a node as being in (or approving) one side of a conflict
+ */
+struct ConflictMark {
+	// The conflict
+	std::shared_ptr<ConflictSet> set;
+	// Hash of the member of the conflict the marked node is or approves
+	std::string member;
+
+	bool operator==(const ConflictMark&) const = default;
+};
+
+/**
+ * @brief Encoding of a node ready to be sent over the network (see NetworkedTangle::AddTransactionRequestBase), cached so the node can be sent to many peers without being reencoded
+ */
+struct WireEncoding {
+	// Account whose signature is part of the encoding (the cache is stale if we change keys)
+	key::AccountID signer;
+	// The encoded (compressed and signed) node
+	std::string bytes;
+};
 
 // Transaction nodes act as a wrapper around transactions, providing graph connectivity information
 struct TransactionNode : public Transaction, public std::enable_shared_from_this<TransactionNode> {
@@ -32,16 +143,29 @@ struct TransactionNode : public Transaction, public std::enable_shared_from_this
 	using ptr = std::shared_ptr<TransactionNode>;
 	using const_ptr = std::shared_ptr<const TransactionNode>;
 
-	// Variable tracking the cumulative weight of this node
+	// Variable tracking the cumulative weight of this node (cached estimate of <descendants>)
 	const float cumulativeWeight = 0;
+	// Sketch of the weight of this node and every node which (directly or indirectly) approves it
+	WeightSketch descendants;
 	// Variable tracking weather or not this transaction is the genesis transaction
 	const bool isGenesis = false; // TODO: should this go in the base transaction or here?
 	// Immutable list of parents of the node
 	const std::vector<TransactionNode::const_ptr> parents;
 	// List of children of the node, thread safe access
 	monitor<std::vector<TransactionNode::ptr>> children;
+	// Double-spend conflicts this node is part of, or inherited from the nodes it approves, thread safe access
+	monitor<std::vector<ConflictMark>> conflicts;
+	// Cached network encoding of the node, built the first time the node is sent to a peer
+	mutable std::atomic<std::shared_ptr<const WireEncoding>> wireEncoding;
 
-	TransactionNode(const std::vector<TransactionNode::const_ptr> parents, const std::vector<Input>& inputs, const std::vector<Output>& outputs, uint8_t difficulty = 3);
+	TransactionNode(const std::vector<TransactionNode::const_ptr> parents, std::vector<Input> inputs, std::vector<Output> outputs, uint8_t difficulty = 3);
+	/**
+	 * @brief Creates a transaction node wrapping an existing transaction (its hash, and whether that hash is verified, carry over)
+	 *
+	 * @param parents - List of pointers to parents (must match the transaction's parent hashes)
+	 * @param trx - The transaction to wrap
+	 */
+	TransactionNode(const std::vector<TransactionNode::const_ptr> parents, const Transaction& trx) : Transaction(trx), parents(parents) {}
 
 	/**
 	 * @brief Function which creates a pointer to a transaction node
@@ -53,11 +177,15 @@ struct TransactionNode : public Transaction, public std::enable_shared_from_this
 	 * @return TransactionNode::ptr - Pointer to the newly converted transaction
 	 */
 	inline static TransactionNode::ptr create(const std::vector<TransactionNode::const_ptr>& parents, std::vector<Input> inputs, std::vector<Output> outputs, uint8_t difficulty = 3) {
-		return std::make_shared<TransactionNode>(parents, inputs, outputs, difficulty);
+		return std::make_shared<TransactionNode>(parents, std::move(inputs), std::move(outputs), difficulty);
 	}
 
-	static TransactionNode::ptr create(const Tangle& t, const Transaction& trx);
-	static TransactionNode::ptr createAndMine(const Tangle& t, const std::vector<Input>& inputs, const std::vector<Output>& outputs, uint8_t difficulty = 3);
+	template<TanglePolicies Policies>
+	static TransactionNode::ptr create(const BasicTangle<Policies>& t, const Transaction& trx);
+	template<TanglePolicies Policies>
+	static std::vector<TransactionNode::const_ptr> selectParents(const BasicTangle<Policies>& t);
+	template<TanglePolicies Policies>
+	static TransactionNode::ptr createAndMine(const BasicTangle<Policies>& t, const std::vector<Input>& inputs, const std::vector<Output>& outputs, uint8_t difficulty = 3);
 	
 	// Function which dumps the metrics added over top a base transaction
 	void debugDump();
@@ -86,18 +214,240 @@ struct TransactionNode : public Transaction, public std::enable_shared_from_this
 	 * @return float - The weight of this transaction in isolation
 	 */
 	inline float ownWeight() const { return std::min(miningDifficulty / 5.f, 1.f); }
+	/**
+	 * @brief Function which adds this transaction's own weight to its descendant sketch
+	 *
+	 * @param weight - The weight of this transaction in isolation (as determined by the tangle's weight policy)
+	 * @return bool - True if the sketch changed (it wasn't already included)
+	 */
+	inline bool sketchOwnWeight(float weight) { return descendants.addWeighted(hash, std::lround(weight * WEIGHT_SKETCH_UNITS)); }
 
 	size_t height() const;
 	size_t depth() const;
 
 	TransactionNode::const_ptr biasedRandomWalk(double alpha = 10) const;
 	float confirmationConfidence() const;
+	bool conflictLoser() const;
 };
 
 /**
- * @brief Class managing the graph which represents our local Tangle
+ * @brief Index of every account's balance and unsettled spends, used to validate transactions and detect double spends in O(inputs)
+ * @note Balances include every branch of the tangle. A spend which overdraws its account, but which would be covered if concurrent unsettled spends (those it doesn't approve) were dropped,
+ * 	is accepted as a conflict with those spends (see ConflictSet) rather than rejected. Spending on top of an unsettled spend the transaction approves is an overdraft.
+ * @note The deposits of the members of a conflict are held back from their recipients' balances until the conflict resolves,
+ * 	then the preferred member's deposits are released while the other members' deposits are dropped and their spends refunded.
+ * @note Accounts are partitioned into shards (by account ID), each with its own lock, so transactions touching disjoint accounts are validated in parallel.
+ * 	A transaction touching several shards locks all of them (in ascending order, so concurrent transactions can't deadlock) and is checked and recorded atomically.
+ * 	A transaction found to be part of a double spend is rechecked holding every shard, since marking the conflict moves deposits between arbitrary accounts.
+ */
+struct ConflictIndex {
+	/**
+	 * @brief Description of an account a transaction would overdraw
+	 */
+	struct Overdraft {
+		key::AccountID account;
+		double balance;
+	};
+
+	ConflictIndex(size_t shards = std::max(1u, std::thread::hardware_concurrency()));
+
+	std::optional<Overdraft> add(const TransactionNode::ptr& node, std::optional<size_t> generation = {}, const std::function<void()>& resolve = {});
+	void rebuild(const TransactionNode::ptr& genesis);
+
+	// The number of times the index has been rebuilt (nodes recorded before a rebuild are no longer in the index)
+	size_t generation() const { return generations; }
+
+	/**
+	 * @brief Function which finds the spendable balance of an account (including every branch of the tangle, but not deposits held by unresolved conflicts)
+	 */
+	double balance(key::AccountID account) const {
+		auto& shard = shardOf(account);
+		std::scoped_lock lock(shard.mutex);
+		if(auto found = shard.accounts.find(account); found != shard.accounts.end()){
+			settle(found->second);
+			return found->second.balance;
+		}
+		return 0;
+	}
+
+	// The number of shards the accounts are partitioned into
+	size_t shardCount() const { return shards.size(); }
+
+protected:
+	/**
+	 * @brief Spend which hasn't gathered enough weight to be settled
+	 */
+	struct PendingDebit {
+		std::weak_ptr<const TransactionNode> node;
+		double amount;
+	};
+
+	/**
+	 * @brief Deposit made by a member of a conflict, held back until the conflict resolves
+	 */
+	struct HeldCredit {
+		// The conflict, and the member which made the deposit
+		ConflictMark mark;
+		double amount;
+	};
+
+	/**
+	 * @brief Entry in the index
+	 */
+	struct Account {
+		// Spendable balance
+		double balance = 0;
+		// Unsettled spends, and their total
+		std::deque<PendingDebit> pending;
+		double pendingTotal = 0;
+		// Deposits waiting for their conflicts to resolve
+		std::vector<HeldCredit> held;
+	};
+
+	/**
+	 * @brief Partition of the index's accounts
+	 */
+	struct Shard {
+		// Mutex protecting the shard's accounts
+		mutable std::mutex mutex;
+		// Map of accounts to their entries
+		std::unordered_map<key::AccountID, Account> accounts;
+	};
+
+	// The shards (pointers since shards can't be moved)
+	std::vector<std::unique_ptr<Shard>> shards;
+	// The number of times the index has been rebuilt (only changed with every shard locked)
+	std::atomic<size_t> generations = 0;
+
+	// The shard an account belongs to, and its entry (the shard must be locked)
+	Shard& shardOf(key::AccountID account) const { return *shards[account % shards.size()]; }
+	Account& entry(key::AccountID account) { return shardOf(account).accounts[account]; }
+
+	std::vector<std::unique_lock<std::mutex>> lockShards(const TransactionNode& node);
+	std::vector<std::unique_lock<std::mutex>> lockAll();
+	std::optional<Overdraft> check(const TransactionNode& node, const std::unordered_map<key::AccountID, double>& debits, std::vector<key::AccountID>& conflicting);
+	void record(const TransactionNode::ptr& node);
+	void markConflict(const TransactionNode::ptr& node, const std::vector<key::AccountID>& accounts);
+	void holdDeposits(const TransactionNode& node, const ConflictMark& mark);
+
+	static void settle(Account& account);
+	static std::optional<ConflictMark> ownConflict(const TransactionNode& node);
+	static std::optional<std::unordered_set<const TransactionNode*>> unsettledAncestors(const TransactionNode& node);
+};
+
+
+
+// -- Policies --
+
+
+/**
+ * @brief Tip selection which performs a biased random walk from the genesis
+ * @tparam Alpha - Tradeoff between randomness and weight, low values are completely random, high values are completely based on weight differences
+ */
+template<double Alpha = 10.0>
+struct BiasedRandomWalkTipSelection {
+	static constexpr double alpha = Alpha;
+	static TransactionNode::const_ptr selectTip(const TransactionNode& genesis, const monitor<std::vector<TransactionNode::const_ptr>>& tips) { return genesis.biasedRandomWalk(alpha); }
+};
+
+/**
+ * @brief Tip selection which picks a tip uniformly at random (ignoring weight, cheap enough for replaying large tangles)
+ */
+struct UniformTipSelection {
+	static TransactionNode::const_ptr selectTip(const TransactionNode& genesis, const monitor<std::vector<TransactionNode::const_ptr>>& tips) {
+		thread_local std::mt19937 rng(std::random_device{}());
+		auto tipLock = util::mutable_cast(tips).read_lock();
+		if(tipLock->empty()) return nullptr;
+		return tipLock[std::uniform_int_distribution<size_t>(0, tipLock->size() - 1)(rng)];
+	}
+};
+
+/**
+ * @brief Weight based on a transaction's mining difficulty (see TransactionNode::ownWeight)
+ */
+struct DifficultyWeight {
+	static float ownWeight(const TransactionNode& node) { return node.ownWeight(); }
+};
+
+/**
+ * @brief Storage which keeps nothing beyond the graph itself, nodes are found by searching it from the genesis
+ */
+struct GraphSearchStorage {
+	void insert(const TransactionNode::ptr& node) {}
+	void erase(const std::string& hash) {}
+	void reset(const TransactionNode::ptr& genesis) {}
+	TransactionNode::ptr find(const TransactionNode::ptr& genesis, Hash& hash) const { return genesis->find(hash); }
+};
+
+/**
+ * @brief Storage which indexes every node in the graph by hash, so nodes are found in constant time
+ * @note The index isn't internally synchronized, lookups made outside the tangle's lock (validating a new node's parents) race with concurrent adds, so only pair it with single threaded access
  */
-struct Tangle {
+struct HashIndexStorage {
+	void insert(const TransactionNode::ptr& node) { index[node->hash] = node; }
+	void erase(const std::string& hash) { index.erase(hash); }
+	void reset(const TransactionNode::ptr& genesis) {
+		index.clear();
+		if(genesis) insert(genesis);
+	}
+	TransactionNode::ptr find(const TransactionNode::ptr& genesis, Hash& hash) const {
+		auto node = index.find(hash);
+		return node == index.end() ? nullptr : node->second.lock();
+	}
+
+protected:
+	std::unordered_map<std::string, std::weak_ptr<TransactionNode>> index;
+};
+
+/**
+ * @brief Locking which synchronizes modifications to the graph with a (recursive) mutex
+ */
+struct RecursiveLocking {
+	using mutex_type = std::recursive_mutex;
+	static constexpr bool concurrent = true;
+};
+
+/**
+ * @brief Locking which doesn't synchronize anything, for tangles only ever accessed by one thread
+ * @note Weights are updated inline (on the thread adding the transaction), so no background thread touches the tangle
+ */
+struct SingleThreadedLocking {
+	struct mutex_type {
+		void lock() {}
+		void unlock() {}
+		bool try_lock() { return true; }
+	};
+	static constexpr bool concurrent = false;
+};
+
+/**
+ * @brief The policies of a networked tangle: weighted tip selection, graph search, and modifications synchronized across threads
+ */
+struct DefaultTanglePolicies {
+	using TipSelection = BiasedRandomWalkTipSelection<>;
+	using Weight = DifficultyWeight;
+	using Storage = GraphSearchStorage;
+	using Locking = RecursiveLocking;
+};
+
+/**
+ * @brief The policies of a tangle only ever accessed by one thread (replaying or pre-mining transactions), nodes are indexed by hash and nothing is locked
+ */
+struct SingleThreadedTanglePolicies {
+	using TipSelection = BiasedRandomWalkTipSelection<>;
+	using Weight = DifficultyWeight;
+	using Storage = HashIndexStorage;
+	using Locking = SingleThreadedLocking;
+};
+
+
+// -- Tangle --
+
+
+/**
+ * @brief Members shared by every specialization of the tangle
+ */
+struct TangleBase {
 	/**
 	 * @brief Exception thrown when a node can't be found in the graph
 	 */
@@ -112,18 +462,38 @@ struct Tangle {
 		const key::PublicKey& account;
 		InvalidBalance(TransactionNode::const_ptr node, const key::PublicKey& account, double balance) : std::runtime_error("Node with hash `" + node->hash + "` results in a balance of `" + std::to_string(balance) + "` for an account."), node(node), account(account) {}
 	};
+};
 
+/**
+ * @brief Class managing the graph which represents our local Tangle
+ * @note Specialized at compile time by a set of policies (tip selection, weight, storage, and locking), see DefaultTanglePolicies
+ * @note Member functions are defined in tangle.cpp and explicitly instantiated for each set of policies in use
+ */
+template<TanglePolicies Policies>
+struct BasicTangle : public TangleBase {
 	// Pointer to the Genesis block
 	const TransactionNode::ptr genesis;
 	// List of tips, with thread safe access
 	const monitor<std::vector<TransactionNode::const_ptr>> tips;
+	// Flag which determines if weights are recalculated in background threads (only when the tangle is accessed concurrently), disabled when replaying captures deterministically
+	bool weightUpdateThreads = true;
 
 protected:
 	// Mutex used to synchronize modifications across threads
-	std::recursive_mutex mutex;
+	typename Policies::Locking::mutex_type mutex;
 
-	// Flag which determines if a transaction add should recalculate weights or not
-	bool updateWeights = true;
+	// Storage used to find nodes in the graph
+	typename Policies::Storage storage;
+
+	// Index of account balances and double-spend conflicts (internally locked, per shard of accounts)
+	ConflictIndex conflictIndex;
+
+	// Hashes of the nodes currently being added (so concurrent duplicates are rejected before they reach the conflict index), and the mutex protecting them
+	std::unordered_set<std::string> inFlight;
+	std::mutex inFlightMutex;
+
+	// Log which accepted transactions are journaled to (nullptr if the tangle isn't persisted)
+	std::unique_ptr<WriteAheadLog> journal = nullptr;
 
 	// Circular buffer queue of size 10 of candidates to be converted into the genesis
 	ModifiableQueue<std::vector<TransactionNode::const_ptr>, secure_circular_buffer_array<std::vector<TransactionNode::const_ptr>, 10>> genesisCandidates;
@@ -131,15 +501,15 @@ protected:
 public:
 
 	// Upon creation generate a genesis block
-	Tangle() : genesis([]() -> TransactionNode::ptr {
+	BasicTangle() : genesis([]() -> TransactionNode::ptr {
 		std::vector<TransactionNode::const_ptr> parents;
 		std::vector<Transaction::Input> inputs;
 		std::vector<Transaction::Output> outputs;
 		return std::make_shared<TransactionNode>(parents, inputs, outputs);
-	}()) {}
+	}()) { storage.reset(genesis); }
 
 	// Clean up the graph, in memory, on exit
-	~Tangle() { setGenesis(nullptr); }
+	~BasicTangle() { setGenesis(nullptr); }
 
 	void setGenesis(TransactionNode::ptr genesis);
 
@@ -149,7 +519,7 @@ public:
 	 * @param hash - The hash to search for
 	 * @return TransactionNode::const_ptr - The discovered node or nullptr if not found
 	 */
-	inline TransactionNode::const_ptr find(Hash hash) const { return genesis->find(hash); }
+	inline TransactionNode::const_ptr find(Hash hash) const { return storage.find(genesis, hash); }
 	/**
 	 * @brief Function which finds a node in the graph given its hash
 	 * @note Non-const version
@@ -157,9 +527,8 @@ public:
 	 * @param hash - The hash to search for
 	 * @return TransactionNode::const_ptr - The discovered node or nullptr if not found
 	 */
-	inline TransactionNode::ptr find(Hash hash) { return genesis->find(hash); }
+	inline TransactionNode::ptr find(Hash hash) { return storage.find(genesis, hash); }
 
-	// 
 	/**
 	 * @brief Function which performs a biased random walk on the tangle
 	 * 
@@ -167,12 +536,27 @@ public:
  	 * @return TransactionNode::const_ptr - The tip this walk results in
 	 */
 	inline TransactionNode::const_ptr biasedRandomWalk(double alpha = 10) const { return genesis->biasedRandomWalk(alpha); }
+	/**
+	 * @brief Function which selects a tip for a new transaction to approve, using the tangle's tip selection policy
+	 *
+	 * @return TransactionNode::const_ptr - The selected tip
+	 */
+	inline TransactionNode::const_ptr selectTip() const { return Policies::TipSelection::selectTip(*genesis, tips); }
 
-	Hash add(const TransactionNode::ptr node);
+	Hash add(const TransactionNode::ptr node, bool updateWeights = true);
 	void removeTip(TransactionNode::const_ptr node);
 
-	double queryBalance(const key::PublicKey& account, float confidenceThreshold = 0) const;
+	double queryBalance(key::AccountID account, float confidenceThreshold = 0) const;
+	inline double queryBalance(const key::PublicKey& account, float confidenceThreshold = 0) const { return queryBalance(key::AccountTable::intern(account), confidenceThreshold); }
 	inline double queryBalance(const key::KeyPair& pair, float confidenceThreshold = 0) const { return queryBalance(pair.pub, confidenceThreshold); }
+	/**
+	 * @brief Function which looks up an account's balance in the conflict index, in constant time rather than walking the tangle
+	 * @note Includes every branch of the tangle (unconfirmed and conflicting spends alike), use queryBalance for a confidence aware balance
+	 *
+	 * @param account - The account to look up
+	 * @return double - The account's balance
+	 */
+	inline double indexedBalance(key::AccountID account) const { return conflictIndex.balance(account); }
 
 	/**
 	 * @brief Function which prints out the tangle
@@ -197,6 +581,22 @@ public:
 protected:
 	void updateCumulativeWeights(TransactionNode::const_ptr source);
 
+	/**
+	 * @brief Function which updates the weights of the nodes approved by <source>
+	 * @note Done in a background thread if the tangle is accessed concurrently (and weightUpdateThreads is set), otherwise inline so nothing outlives the tangle
+	 *
+	 * @param source - The node to work backwards from
+	 */
+	void scheduleWeightUpdate(TransactionNode::const_ptr source){
+		if(!source) return;
+		if constexpr (Policies::Locking::concurrent)
+			if(weightUpdateThreads){
+				std::thread([this, source](){ updateCumulativeWeights(source); }).detach();
+				return;
+			}
+		updateCumulativeWeights(source);
+	}
+
 	/**
 	 * @brief Update the cumulative weight of each of the current tips
 	 */
@@ -207,4 +607,9 @@ protected:
 
 };
 
+// The tangle every node in the network uses
+using Tangle = BasicTangle<DefaultTanglePolicies>;
+// Tangle for replaying or pre-mining transactions on a single thread
+using SingleThreadedTangle = BasicTangle<SingleThreadedTanglePolicies>;
+
 #endif /* end of include guard: TANGLE_HPP */
@@ -23,35 +23,60 @@
  * @param outputs Outputs of the transaction
  * @param difficulty The difficulty of mining this transaction (increased difficulty results in increased weight)
  */
-Transaction::Transaction(const std::span<Hash> parentHashes, const std::vector<Input>& inputs, const std::vector<Output>& outputs, uint8_t difficulty /*= 3*/) : timestamp(util::utc_now()), miningDifficulty(difficulty), inputs(inputs), outputs(outputs),
+Transaction::Transaction(std::vector<std::string> parentHashes, std::vector<Input> inputs, std::vector<Output> outputs, uint8_t difficulty /*= 3*/) : timestamp(util::utc_now()), miningDifficulty(difficulty),
+	inputs(std::move(inputs)), outputs(std::move(outputs)),
 	// Set a random initial value for the nonce
 	nonce([]() -> size_t {
 		// Seed random number generator
 		static CryptoPP::AutoSeededRandomPool rng;
 		return rng.GenerateWord32() + rng.GenerateWord32();
 	}()),
-	// Copy the parent hashes so that they are locally owned
-	parentHashes([](std::span<Hash> parentHashes) -> std::span<Hash> {
-		// Ensure that there are no duplicate parent hashes
-		std::unordered_set<std::string> uniqueHashesSet;
-		for(auto& hash: parentHashes)
-			uniqueHashesSet.insert(hash);
-		// Sort the hashes
-		std::vector<std::string> uniqueHashes(uniqueHashesSet.begin(), uniqueHashesSet.end());
-		std::sort(uniqueHashes.begin(), uniqueHashes.end());
-
-		// Create local storage for the hashes and copy the unique sorted hashes into it
-		Hash* backing = new Hash[uniqueHashes.size()];
-		for(size_t i = 0; i < uniqueHashes.size(); i++)
-			*util::mutable_cast(backing + i) = uniqueHashes[i]; // Drop the const to allow a copy to occur
-
-		return {backing, uniqueHashes.size()};
-	}(parentHashes)),
+	// Make sure the parent hashes are in canonical order
+	parentHashes(sortParentHashes(std::move(parentHashes))),
 	// Hash everything stored
-	hash(hashTransaction()) {}
+	hash(hashTransaction()), hashVerified(true) {}
+
+/**
+ * @brief Construct a Transaction whose every field is already known (along with the hash calculated from them)
+ * @note Used when decoding transactions so that they aren't hashed more than once
+ *
+ * @param sortedParentHashes Parents of this transaction (must already be sorted and unique)
+ * @param inputs Inputs to the transaction
+ * @param outputs Outputs of the transaction
+ * @param difficulty The difficulty the transaction was mined at
+ * @param timestamp The time the transaction was created
+ * @param nonce The nonce the transaction was mined with
+ * @param miningTarget The character the transaction was mined towards
+ * @param verifiedHash The hash calculated from all of the other fields
+ */
+Transaction::Transaction(std::vector<std::string> sortedParentHashes, std::vector<Input> inputs, std::vector<Output> outputs, uint8_t difficulty, int64_t timestamp, size_t nonce, char miningTarget, std::string verifiedHash)
+	: timestamp(timestamp), nonce(nonce), miningDifficulty(difficulty), miningTarget(miningTarget), inputs(std::move(inputs)), outputs(std::move(outputs)),
+	parentHashes(std::move(sortedParentHashes)), hash(std::move(verifiedHash)), hashVerified(true) {}
+
+/**
+ * @brief Move constructor, steals the other transaction's handles and hash
+ *
+ * @param other The transaction to move into us
+ */
+Transaction::Transaction(Transaction&& other) : timestamp(other.timestamp), nonce(other.nonce), miningDifficulty(other.miningDifficulty), miningTarget(other.miningTarget),
+	inputs(std::move(util::mutable_cast(other.inputs))), outputs(std::move(util::mutable_cast(other.outputs))), parentHashes(std::move(util::mutable_cast(other.parentHashes))),
+	hash(std::move(util::mutable_cast(other.hash))), hashVerified(other.hashVerified) {}
+
+/**
+ * @brief Function which puts a set of parent hashes in canonical order
+ *
+ * @param parentHashes - The hashes to sort
+ * @return std::vector<std::string> - The sorted, unique, hashes
+ */
+std::vector<std::string> Transaction::sortParentHashes(std::vector<std::string> parentHashes){
+	std::sort(parentHashes.begin(), parentHashes.end());
+	parentHashes.erase(std::unique(parentHashes.begin(), parentHashes.end()), parentHashes.end());
+	return parentHashes;
+}
 
 /**
  * @brief Assignment operator
+ * @note Only the handles to the inputs, outputs, and parent hashes are copied
  *
  * @param _new The transaction to copy into us
  * @return Transaction& - Reference to ourselves for chained assignment
@@ -63,14 +88,9 @@ Transaction& Transaction::operator=(const Transaction& _new){
 	util::mutable_cast(miningTarget) = _new.miningTarget;
 	util::mutable_cast(inputs) = _new.inputs;
 	util::mutable_cast(outputs) = _new.outputs;
-
-	// Create new parent hash memory and copy the data across
-	Hash* backing = new Hash[_new.parentHashes.size()];
-	for(size_t i = 0; i < _new.parentHashes.size(); i++)
-		*util::mutable_cast(backing + i) = _new.parentHashes[i]; // Drop the const to allow a copy to occur
-
-	util::mutable_cast(parentHashes) = {backing, _new.parentHashes.size()};
+	util::mutable_cast(parentHashes) = _new.parentHashes;
 	util::mutable_cast(hash) = _new.hash;
+	util::mutable_cast(hashVerified) = _new.hashVerified;
 
 	return *this;
 }
@@ -86,11 +106,11 @@ Transaction& Transaction::operator=(Transaction&& _new){
 	util::mutable_cast(nonce) = _new.nonce;
 	util::mutable_cast(miningDifficulty) = _new.miningDifficulty;
 	util::mutable_cast(miningTarget) = _new.miningTarget;
-	util::mutable_cast(inputs) = std::move(_new.inputs);
-	util::mutable_cast(outputs) = std::move(_new.outputs);
-	util::mutable_cast(parentHashes) = _new.parentHashes;
-	util::mutable_cast(_new.parentHashes) = {(Hash*) nullptr, 0}; // The memory is now managed by this object... not the other one
-	util::mutable_cast(hash) = _new.hash;
+	util::mutable_cast(inputs) = std::move(util::mutable_cast(_new.inputs));
+	util::mutable_cast(outputs) = std::move(util::mutable_cast(_new.outputs));
+	util::mutable_cast(parentHashes) = std::move(util::mutable_cast(_new.parentHashes));
+	util::mutable_cast(hash) = std::move(util::mutable_cast(_new.hash));
+	util::mutable_cast(hashVerified) = _new.hashVerified;
 
 	return *this;
 }
@@ -111,11 +131,11 @@ void Transaction::debugDump(){
 
 	std::cout << "Inputs: [" << std::endl;
 	for(auto& i: inputs)
-		std::cout << "\t Account: " << key::hash(i.account()) << ", Amount: " << i.amount << std::endl;
+		std::cout << "\t Account: " << (i.interned() ? key::AccountTable::hash(i.accountID()) : key::hash(key::loadCompressed(i.compressedAccount()))) << ", Amount: " << i.amount << std::endl;
 	std::cout << "]" << std::endl
 		<< "Outputs: [" << std::endl;
 	for(auto& o: outputs)
-		std::cout << "\t Account: " << key::hash(o.account()) << ", Amount: " << o.amount << std::endl;
+		std::cout << "\t Account: " << (o.interned() ? key::AccountTable::hash(o.accountID()) : key::hash(key::loadCompressed(o.compressedAccount()))) << ", Amount: " << o.amount << std::endl;
 	std::cout << "]" << std::endl;
 }
 
@@ -144,13 +164,38 @@ void Transaction::mineTransaction(){
 	// Time how long it took to mine (and display the result to the user)
 	Timer t;
 
+	// Encode the transaction once, only the nonce changes between attempts
+	std::string encoded = encode();
+
 	// While the transaction is not successfully mined
 	while( !validateTransactionMined() ){
 		// Increment the nonce...
 		util::mutable_cast(nonce)++;
+		util::writeInteger<uint64_t>(encoded, TRANSACTION_NONCE_OFFSET, nonce);
 		// And rehash
-		util::mutable_cast(hash) = hashTransaction();
+		util::mutable_cast(hash) = util::hash(encoded);
 	}
+	util::mutable_cast(hashVerified) = true;
+}
+
+/**
+ * @brief Function which continues mining the transaction, giving up after <attempts> nonces
+ * @note Picks up from the current nonce, so mining can be done in slices (and abandoned between them)
+ *
+ * @param attempts - The maximum number of nonces to try
+ * @return bool - True if the transaction has been mined
+ */
+bool Transaction::mineTransaction(uint64_t attempts){
+	std::string encoded = encode();
+	for(uint64_t i = 0; !validateTransactionMined(); i++){
+		if(i == attempts) return false;
+
+		util::mutable_cast(nonce)++;
+		util::writeInteger<uint64_t>(encoded, TRANSACTION_NONCE_OFFSET, nonce);
+		util::mutable_cast(hash) = util::hash(encoded);
+	}
+	util::mutable_cast(hashVerified) = true;
+	return true;
 }
 
 /**
@@ -159,18 +204,105 @@ void Transaction::mineTransaction(){
  * @return Hash - The hashed transaction
  */
 Hash Transaction::hashTransaction() const {
-	std::stringstream hash;
-	hash << timestamp;
-	hash << nonce;
-	for(Input input: inputs)
-		hash << input.hashContribution();
-	for(Output output: outputs)
-		hash << output.hashContribution();
+	return util::hash(encode());
+}
 
+/**
+ * @brief Function which creates the canonical binary encoding of the transaction
+ * @note This is the hash preimage as well as what is sent over the network and saved to disk
+ * @note Layout (all integers little endian): timestamp (8), nonce (8), difficulty (1), target (1),
+ * 	parent count (4) + length prefixed parent hashes, input count (4) + inputs, output count (4) + outputs
+ *
+ * @return std::string - The encoded transaction
+ */
+std::string Transaction::encode() const {
+	std::string out;
+	util::appendInteger<int64_t>(out, timestamp);
+	util::appendInteger<uint64_t>(out, nonce);
+	util::appendInteger<uint8_t>(out, miningDifficulty);
+	util::appendInteger<uint8_t>(out, miningTarget);
+
+	util::appendInteger<uint32_t>(out, parentHashes.size());
 	for(Hash& h: parentHashes)
-		hash << h;
+		util::appendBytes(out, h);
+
+	util::appendInteger<uint32_t>(out, inputs.size());
+	for(const Input& input: inputs)
+		input.encode(out);
+
+	util::appendInteger<uint32_t>(out, outputs.size());
+	for(const Output& output: outputs)
+		output.encode(out);
+
+	return out;
+}
+
+/**
+ * @brief Function which reads an output from its canonical encoding
+ *
+ * @param in - Reader positioned at the start of the output
+ * @return Output - The decoded output
+ */
+Transaction::Output Transaction::Output::decode(util::ByteReader& in){
+	Output out;
+	out.findAccount(in.readBytes());
+	out.amount = std::bit_cast<double>(in.readInteger<uint64_t>());
+	return out;
+}
 
-	return util::hash(hash.str());
+/**
+ * @brief Function which reads an input from its canonical encoding
+ *
+ * @param in - Reader positioned at the start of the input
+ * @return Input - The decoded input
+ */
+Transaction::Input Transaction::Input::decode(util::ByteReader& in){
+	Input out;
+	out.findAccount(in.readBytes());
+	out.amount = std::bit_cast<double>(in.readInteger<uint64_t>());
+	out.signature = key::toSignature(in.readFixed(key::SIGNATURE_SIZE));
+	return out;
+}
+
+/**
+ * @brief Function which reconstructs a transaction from its canonical encoding
+ * @note The transaction's hash is calculated directly from the provided bytes
+ *
+ * @param encoded - The encoded transaction
+ * @return Transaction - The decoded transaction
+ */
+Transaction Transaction::decode(std::string_view encoded){
+	util::ByteReader in(encoded);
+
+	// Read freestanding values
+	int64_t timestamp = in.readInteger<int64_t>();
+	size_t nonce = in.readInteger<uint64_t>();
+	uint8_t miningDifficulty = in.readInteger<uint8_t>();
+	char miningTarget = in.readInteger<uint8_t>();
+
+	// Read parent hashes (which must be sorted and unique to be canonical)
+	std::vector<std::string> parentHashes(in.readCount(TRANSACTION_MIN_PARENT_SIZE));
+	for(size_t i = 0; i < parentHashes.size(); i++){
+		parentHashes[i] = in.readBytes();
+		if(i > 0 && parentHashes[i - 1] >= parentHashes[i])
+			throw std::runtime_error("Encoded transaction's parent hashes are not in canonical order");
+	}
+
+	// Read inputs
+	std::vector<Transaction::Input> inputs(in.readCount(TRANSACTION_MIN_INPUT_SIZE));
+	for(auto& input: inputs)
+		input = Input::decode(in);
+
+	// Read outputs
+	std::vector<Transaction::Output> outputs(in.readCount(TRANSACTION_MIN_OUTPUT_SIZE));
+	for(auto& output: outputs)
+		output = Output::decode(in);
+
+	if(!in.done())
+		throw std::runtime_error("Encoded transaction has trailing data");
+
+	// Create the transaction, the encoding is the hash preimage so this is the only time it needs to be hashed
+	return Transaction(std::move(parentHashes), std::move(inputs), std::move(outputs), miningDifficulty, timestamp, nonce, miningTarget, util::hash(encoded));
 }
 
 /**
@@ -197,94 +329,69 @@ bool Transaction::validateTransactionTotals() const {
  */
 bool Transaction::validateTransaction() const {
 	bool good = true;
-	// Make sure the hash matches
-	good &= hashTransaction() == hash;
-
-	// Make sure all of the inputs agreed to their contribution
-	for(const Input& input: inputs)
-		good &= key::verifyMessage(input.account(), std::to_string(input.amount), input.signature);
+	// Make sure the hash matches (unless it was already calculated from the transaction's contents)
+	good &= hashVerified || hashTransaction() == hash;
+
+	// Make sure all of the inputs agreed to their contribution (checking all of their signatures as one batch)
+	std::vector<std::string> amounts;
+	std::vector<key::VerificationJob> jobs;
+	std::vector<std::unique_ptr<const key::Scheme::Verifier>> uninterned; // Verifiers for accounts which aren't in the account table (yet)
+	amounts.reserve(inputs.size());
+	jobs.reserve(inputs.size());
+	for(const Input& input: inputs){
+		const key::Scheme::Verifier* verifier;
+		if(input.interned()) verifier = &key::AccountTable::verifier(input.accountID());
+		else verifier = uninterned.emplace_back(key::Scheme::makeVerifier(key::loadCompressed(input.compressedAccount()))).get();
+
+		amounts.push_back(encodeAmount(input.amount));
+		jobs.push_back({ verifier, key::scheme::bytes(amounts.back()), input.signature });
+	}
+	good &= key::verifyBatch(jobs);
 
 	return good;
 }
 
+/**
+ * @brief Function which checks if every account the transaction references is in the account table
+ *
+ * @return True if every account is interned, false if the transaction introduces new accounts
+ */
+bool Transaction::accountsInterned() const {
+	return std::all_of(inputs.begin(), inputs.end(), [](const Input& input){ return input.interned(); })
+		&& std::all_of(outputs.begin(), outputs.end(), [](const Output& output){ return output.interned(); });
+}
 
-// -- De/serialization --
+/**
+ * @brief Function which adds the accounts a decoded transaction introduces to the account table
+ * @note The transaction gets its own copies of its inputs and outputs (referring to the interned IDs), the storage shared with other copies of the transaction isn't modified
+ * @note Called once the transaction is known to be accepted (see BasicTangle::add), so transactions from the network which are rejected don't grow the table
+ */
+void Transaction::internAccounts() {
+	if(accountsInterned()) return;
+
+	std::vector<Input> internedInputs(inputs.begin(), inputs.end());
+	for(Input& input: internedInputs)
+		input.intern();
+	std::vector<Output> internedOutputs(outputs.begin(), outputs.end());
+	for(Output& output: internedOutputs)
+		output.intern();
+
+	util::mutable_cast(inputs) = std::move(internedInputs);
+	util::mutable_cast(outputs) = std::move(internedOutputs);
+}
 
 
-breep::serializer& operator<<(breep::serializer& s, const Transaction& t) {
-	// Mark how many hashes we have then output them all
-	s << t.parentHashes.size();
-	for(Hash &h: t.parentHashes)
-		s << h;
-
-	s << t.timestamp;
-	s << t.nonce;
-	s << t.miningDifficulty;
-	s << t.miningTarget;
-
-	// Mark how many inputs we have then output their values
-	s << t.inputs.size();
-	for(const Transaction::Input& input: t.inputs){
-		s << input._accountBase64;
-		s << input.amount;
-		s << input.signature;
-	}
+// -- De/serialization --
 
-	// Mark how many outputs we have then output their values
-	s << t.outputs.size();
-	for(const Transaction::Output& output: t.outputs){
-		s << output._accountBase64;
-		s << output.amount;
-	}
 
+breep::serializer& operator<<(breep::serializer& s, const Transaction& t) {
+	// Transactions travel as their canonical encoding
+	s << t.encode();
 	return s;
 }
 breep::deserializer& operator>>(breep::deserializer& d, Transaction& t) {
-	// Read parent hashes
-	size_t parentHashesSize;
-	std::vector<std::string> parentHashes;
-	d >> parentHashesSize;
-	parentHashes.resize(parentHashesSize);
-	for(int i = 0; i < parentHashesSize; i++)
-		d >> parentHashes[i];
-
-	// Read freestanding values
-	int64_t timestamp;
-	size_t nonce;
-	uint8_t miningDifficulty;
-	char miningTarget;
-	d >> timestamp;
-	d >> nonce;
-	d >> miningDifficulty;
-	d >> miningTarget;
-
-	// Read inputs
-	size_t inputsSize;
-	std::vector<Transaction::Input> inputs;
-	d >> inputsSize;
-	inputs.resize(inputsSize);
-	for(int i = 0; i < inputsSize; i++){
-		d >> inputs[i]._accountBase64;
-		d >> inputs[i].amount;
-		d >> inputs[i].signature;
-	}
-
-	// Read outputs
-	size_t outputsSize;
-	std::vector<Transaction::Output> outputs;
-	d >> outputsSize;
-	outputs.resize(outputsSize);
-	for(int i = 0; i < outputsSize; i++){
-		d >> outputs[i]._accountBase64;
-		d >> outputs[i].amount;
-	}
-
-	// Create the transaction
-	t = Transaction(parentHashes, inputs, outputs, miningDifficulty);
-	// Update several variables behind the scenes
-	util::mutable_cast(t.timestamp) = timestamp;
-	util::mutable_cast(t.nonce) = nonce;
-	util::mutable_cast(t.miningTarget) = miningTarget;
-	util::mutable_cast(t.hash) = t.hashTransaction(); // Rehash since the timestamp and nonce have been overridden
+	std::string encoded;
+	d >> encoded;
+	t = Transaction::decode(encoded);
 	return d;
-}
\ No newline at end of file
+}
@@ -11,8 +11,8 @@
 #ifndef TRANSACTION_HPP
 #define TRANSACTION_HPP
 
+#include <bit>
 #include <iomanip>
-#include <span>
 
 #include "keys.hpp"
 
@@ -22,6 +22,13 @@ typedef const std::string Hash;
 // Invalid hash string
 #define INVALID_HASH "Invalid"
 
+// Byte offset of the nonce in a transaction's canonical encoding (it follows the 8 byte timestamp)
+#define TRANSACTION_NONCE_OFFSET sizeof(int64_t)
+// Smallest possible encodings of a parent hash (its length prefix), an output (account length prefix and amount), and an input (an output plus its signature)
+#define TRANSACTION_MIN_PARENT_SIZE sizeof(uint32_t)
+#define TRANSACTION_MIN_OUTPUT_SIZE (sizeof(uint32_t) + sizeof(uint64_t))
+#define TRANSACTION_MIN_INPUT_SIZE (TRANSACTION_MIN_OUTPUT_SIZE + key::SIGNATURE_SIZE)
+
 // Structure representing a transcation in the tangle
 struct Transaction {
 	// Mark the deserializer as a friend so it can use the copy operator
@@ -46,34 +53,58 @@ struct Transaction {
 	 * @note Used as a base for transaction inputs
 	 */
 	struct Output {
-		// Mark de/serializastion as friends so they can access the raw account
-		friend breep::serializer& operator<<(breep::serializer& s, const Transaction& t);
-		friend breep::deserializer& operator>>(breep::deserializer& d, Transaction& t);
 	protected:
-		// The base 64 representation of the key
-		std::string _accountBase64;
+		// ID of the account in the shared account table (INVALID_ACCOUNT if the account was decoded but not yet interned)
+		key::AccountID _accountID = key::INVALID_ACCOUNT;
+		// Compressed point of a decoded account which isn't in the account table (interned once the transaction is validated, see internAccounts)
+		std::shared_ptr<const std::string> pendingAccount;
 	public:
 		// The public key of the account
-		key::PublicKey account() const { return key::loadPublicBase64(_accountBase64); }
+		const key::PublicKey& account() const { return key::AccountTable::lookup(_accountID); }
+		// The ID of the account (outputs with the same ID refer to the same account), only valid once the account is interned
+		key::AccountID accountID() const { return _accountID; }
+		// The compressed point of the account
+		const std::string& compressedAccount() const { return pendingAccount ? *pendingAccount : key::AccountTable::compressed(_accountID); }
+		// Whether the account is in the account table
+		bool interned() const { return !pendingAccount; }
 		// The amount of money transferred
 		double amount;
 
 		/**
-		 * @brief Calculates what this output contributes to the hash
+		 * @brief Appends this output's canonical encoding (length prefixed compressed account, followed by the amount) to <out>
 		 *
-		 * @return Hash - The hash contribution
+		 * @param out - The encoding being built
+		 */
+		inline void encode(std::string& out) const {
+			util::appendBytes(out, compressedAccount());
+			util::appendInteger(out, std::bit_cast<uint64_t>(amount));
+		}
+		static Output decode(util::ByteReader& in);
+
+		/**
+		 * @brief Function which adds a decoded account to the account table (if it isn't already)
 		 */
-		inline Hash hashContribution() const {
-			std::stringstream contrib;
-			contrib << _accountBase64;
-			contrib << amount;
-			return contrib.str();
+		void intern(){
+			if(!pendingAccount) return;
+			_accountID = key::AccountTable::intern(*pendingAccount);
+			pendingAccount.reset();
 		}
 
 		Output() = default;
-		Output(const key::KeyPair& pair, const double amount) : _accountBase64( key::saveBase64(pair.pub) ), amount(amount) {}
-		Output(const key::PublicKey& account, double amount) : _accountBase64( key::saveBase64(account) ), amount(amount) {}
-		Output(const key::PublicKey&& account, double amount) : Output(account, amount) {}
+		Output(const key::KeyPair& pair, const double amount) : Output(pair.pub, amount) {}
+		Output(const key::PublicKey& account, double amount) : _accountID( key::AccountTable::intern(account) ), amount(amount) {}
+		Output(key::AccountID account, double amount) : _accountID(account), amount(amount) {}
+
+	protected:
+		/**
+		 * @brief Function which refers to a decoded account by its ID if it is already interned, otherwise remembers its compressed point (see intern)
+		 *
+		 * @param compressed - The account's compressed point
+		 */
+		void findAccount(std::string_view compressed){
+			if(auto id = key::AccountTable::find(compressed)) _accountID = *id;
+			else pendingAccount = std::make_shared<const std::string>(compressed);
+		}
 	};
 
 	/**
@@ -81,58 +112,97 @@ struct Transaction {
 	 */
 	struct Input : public Output {
 		// Signature proving that the sender approves this transaction
-		std::string signature;
+		key::Signature signature;
 
 		/**
-		 * @brief Calculates what this output contributes to the hash
+		 * @brief Appends this input's canonical encoding (the output encoding followed by the fixed size signature) to <out>
 		 *
-		 * @return Hash - The hash contribution
+		 * @param out - The encoding being built
 		 */
-		inline Hash hashContribution() const {
-			std::stringstream contrib;
-			contrib << _accountBase64;
-			contrib << amount;
-			contrib << signature;
-			return contrib.str();
+		inline void encode(std::string& out) const {
+			Output::encode(out);
+			out.append(key::signatureView(signature));
 		}
+		static Input decode(util::ByteReader& in);
 
 		Input() = default;
-		// Constructor automatically signs the string version of the amount
-		Input(const key::KeyPair& pair, const double amount) : Output(pair, amount), signature( key::signMessage(pair.pri, std::to_string(amount))) {}
-		Input(const key::PublicKey& account, double amount, std::string signature) : Output(account, amount), signature(signature) {}
-		Input(const key::PublicKey&& account, double amount, std::string signature) : Output(account, amount), signature(signature) {}
+		// Constructor automatically signs the canonical encoding of the amount
+		Input(const key::KeyPair& pair, const double amount) : Output(pair, amount), signature( key::toSignature(key::signMessage(pair.pri, encodeAmount(amount))) ) {}
+		Input(const key::PublicKey& account, double amount, std::string_view signature) : Output(account, amount), signature( key::toSignature(signature) ) {}
 	};
 
-	// Inputs to this transaction
-	const std::vector<Input> inputs = {};
-	// outputs from this transaction
-	const std::vector<Output> outputs = {};
+	// Inputs to this transaction (shared between copies)
+	const util::SharedVector<Input> inputs = {};
+	// outputs from this transaction (shared between copies)
+	const util::SharedVector<Output> outputs = {};
 
-	// List of hashes of parent transactions
-	const std::span<Hash> parentHashes;
+	// Sorted list of hashes of parent transactions (shared between copies)
+	const util::SharedVector<std::string> parentHashes = {};
 	// The hash of this transaction
 	Hash hash = INVALID_HASH;
+	// Token marking that the hash was calculated from this transaction's contents (rather than claimed by a peer), lets validation skip rehashing
+	const bool hashVerified = false;
 
 	Transaction() = default;
-	Transaction(const std::span<Hash> parentHashes, const std::vector<Input>& inputs, const std::vector<Output>& outputs, uint8_t difficulty = 3);
-
-	Transaction(const Transaction& other) : timestamp(other.timestamp), inputs(other.inputs), outputs(other.outputs), parentHashes(other.parentHashes), hash(other.hash) { *this = other; }
-	Transaction(const Transaction&& other) : timestamp(other.timestamp), inputs(other.inputs), outputs(other.outputs), parentHashes(other.parentHashes), hash(other.hash) { *this = std::move(other); }
+	Transaction(std::vector<std::string> parentHashes, std::vector<Input> inputs, std::vector<Output> outputs, uint8_t difficulty = 3);
+	Transaction(std::vector<std::string> sortedParentHashes, std::vector<Input> inputs, std::vector<Output> outputs, uint8_t difficulty, int64_t timestamp, size_t nonce, char miningTarget, std::string verifiedHash);
 
-	// Clean up the parent hashes so that we don't have a memory leak
-	~Transaction(){ if(parentHashes.data()) delete [] parentHashes.data(); }
+	// Copying only copies the handles to the (immutable) inputs, outputs, and parent hashes
+	Transaction(const Transaction& other) = default;
+	Transaction(Transaction&& other);
 
 	Transaction& operator=(const Transaction& _new);
 	Transaction& operator=(Transaction&& _new);
 
 	void debugDump();
 
+	/**
+	 * @brief Function which overrides the hash of the transaction (used when a genesis aliases another transaction)
+	 * @note The new hash is no longer verified against the transaction's contents
+	 *
+	 * @param claimed - The new hash
+	 */
+	void setClaimedHash(Hash claimed) {
+		util::mutable_cast(hash) = claimed;
+		util::mutable_cast(hashVerified) = false;
+	}
+
+	/**
+	 * @brief Function which sets the hashes a genesis aliases (stored as its parent hashes, in canonical order so that the genesis can still be decoded once encoded)
+	 *
+	 * @param aliases - The aliased hashes
+	 */
+	void setAliases(std::vector<std::string> aliases) {
+		util::mutable_cast(parentHashes) = sortParentHashes(std::move(aliases));
+	}
+
 	bool validateTransactionMined();
 	void mineTransaction();
+	bool mineTransaction(uint64_t attempts);
 	Hash hashTransaction() const;
 
+	std::string encode() const;
+	static Transaction decode(std::string_view encoded);
+
+	/**
+	 * @brief Function which converts an amount into the bytes an input's signature covers
+	 *
+	 * @param amount - The amount to encode
+	 * @return std::string - The little endian IEEE-754 bits of the amount
+	 */
+	static std::string encodeAmount(double amount) {
+		std::string out;
+		util::appendInteger(out, std::bit_cast<uint64_t>(amount));
+		return out;
+	}
+
 	bool validateTransactionTotals() const;
 	bool validateTransaction() const;
+	bool accountsInterned() const;
+	void internAccounts();
+
+protected:
+	static std::vector<std::string> sortParentHashes(std::vector<std::string> parentHashes);
 };
 
 // De/serialization
@@ -0,0 +1,527 @@
+/**
+ * @file transport.hpp
+ * @author Joshua Dahl (jdahl@unr.edu)
+ * @brief File which provides the message layer the networked tangle talks through, and the transport backends which carry its messages (Breep, io_uring, and in-process loopback)
+ * @version 0.1
+ * @date 2021-12-11
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#ifndef TRANSPORT_HPP
+#define TRANSPORT_HPP
+
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#define BOOST_BIND_GLOBAL_PLACEHOLDERS
+#include <breep/network/tcp.hpp>
+#include <boost/uuid/uuid.hpp>
+#include <boost/uuid/uuid_io.hpp>
+#include <boost/functional/hash.hpp>
+
+// Number of submission queue entries in an io_uring transport's ring (the completion queue is twice as large)
+#define URING_RING_ENTRIES 256
+// Number and size of the buffers provided to the kernel for multishot receives
+#define URING_RECV_BUFFERS 128
+#define URING_RECV_BUFFER_SIZE 16384
+// Largest frame an io_uring transport accepts, a peer announcing a bigger one is disconnected (rather than buffering it without bound)
+#define URING_MAX_FRAME_SIZE (64 * 1024 * 1024)
+
+namespace transport {
+	// Unique identifier of a peer
+	using PeerID = boost::uuids::uuid;
+	// Identifier of a message listener (used to remove it later)
+	using listener_id = uint64_t;
+	// Identifier of the type of a message
+	using MessageType = uint64_t;
+
+	/**
+	 * @brief Exception thrown when a transport backend isn't supported on this machine
+	 */
+	struct Unavailable : public std::runtime_error { using std::runtime_error::runtime_error; };
+
+	/**
+	 * @brief A peer we are (or were) connected to
+	 */
+	struct Peer {
+		Peer(const PeerID& id, bool connected = true) : _id(id), connected(connected) {}
+
+		const PeerID& id() const { return _id; }
+		bool is_connected() const { return connected; }
+
+	protected:
+		PeerID _id;
+		bool connected;
+	};
+
+	/**
+	 * @brief Interface every transport backend provides, the delivery of opaque messages between peers
+	 * @note Handlers are called from the backend's own thread(s), send may be called from any thread
+	 */
+	struct Transport {
+		// Called with the sender and contents of every received message (the contents are only valid during the call)
+		using MessageHandler = std::function<void(const PeerID& source, std::string_view message)>;
+		// Called when a peer connects (true) or disconnects (false)
+		using ConnectionHandler = std::function<void(const PeerID& peer, bool connected)>;
+
+		virtual ~Transport() = default;
+
+		// Human readable name of the backend
+		virtual const char* name() const = 0;
+		// Our identity on the network
+		virtual const PeerID& self() const = 0;
+
+		// Sets the functions received messages and dis/connections are passed to (must be called before the backend is started)
+		virtual void handle(MessageHandler onMessage, ConnectionHandler onConnection) = 0;
+		// Starts accepting connections and delivering messages
+		virtual void start() = 0;
+		// Connects to a peer (and through it the rest of the network), starting the backend if needed
+		virtual bool connect(const boost::asio::ip::address& address, unsigned short port) = 0;
+		// Sends a message to a peer
+		virtual void send(const PeerID& to, std::string_view message) = 0;
+		// Disconnects from every peer and stops delivering messages
+		virtual void disconnect() = 0;
+	};
+
+
+	// -- Message Layer --
+
+
+	struct Network;
+	struct CaptureWriter;
+
+	/**
+	 * @brief A received message, and who sent it
+	 */
+	template<typename T>
+	struct netdata_wrapper {
+		Network& network;
+		const Peer& source;
+		T& data;
+	};
+
+	/**
+	 * @brief Typed messaging on top of a transport backend
+	 * @note Messages are serialized with their breep (de)serialization operators and tagged with the hash of their type (see BREEP_DECLARE_TYPE)
+	 * @note Listeners are never called concurrently, messages sent to ourselves are delivered immediately on the sending thread
+	 */
+	struct Network {
+		Network(std::unique_ptr<Transport> transport);
+		~Network();
+
+		// The backend carrying our messages
+		Transport& backend() { return *transport; }
+		const Peer& self() const { return _self; }
+		/**
+		 * @brief Function which provides the peers we are connected to
+		 * @note Returns a copy (taken under the peer lock, so it never waits on a listener) since peers dis/connect on the backend's thread
+		 */
+		std::unordered_map<PeerID, Peer, boost::hash<PeerID>> peers() const {
+			std::scoped_lock lock(peersMutex);
+			return _peers;
+		}
+
+		void awake() { transport->start(); }
+		bool connect(const boost::asio::ip::address& address, unsigned short port) { return transport->connect(address, port); }
+		void disconnect();
+
+		void startCapture(const std::string& path);
+		void stopCapture();
+
+		/**
+		 * @brief Function which records something we originated (instead of received) to the capture (see CaptureRecord::Local)
+		 *
+		 * @param serialize - Function providing the record's payload (only called while capturing)
+		 */
+		template<typename F>
+		void captureLocal(F&& serialize){
+			std::scoped_lock lock(mutex);
+			if(capture) recordLocal(serialize());
+		}
+
+		/**
+		 * @brief Number of messages (and bytes) of a type sent to peers
+		 */
+		struct Traffic {
+			size_t messages = 0, bytes = 0;
+		};
+		/**
+		 * @brief Function which provides how much of each type of message (see breep::type_traits<T>::hash_code) has been sent to peers
+		 */
+		std::unordered_map<MessageType, Traffic> traffic() const {
+			std::scoped_lock lock(trafficMutex);
+			return sent;
+		}
+
+		/**
+		 * @brief Function which sends a message to every peer
+		 */
+		template<typename T>
+		void send_object(const T& object){
+			std::string message = encode(object);
+			std::vector<PeerID> ids;
+			{
+				std::scoped_lock lock(peersMutex);
+				ids.reserve(_peers.size());
+				for(auto& [id, peer]: _peers)
+					ids.push_back(id);
+			}
+			for(auto& id: ids)
+				transport->send(id, message);
+			count(breep::type_traits<T>::hash_code(), ids.size(), message.size());
+		}
+
+		/**
+		 * @brief Function which sends a message to a single peer
+		 */
+		template<typename T>
+		void send_object_to(const Peer& peer, const T& object){
+			std::string message = encode(object);
+			transport->send(peer.id(), message);
+			count(breep::type_traits<T>::hash_code(), 1, message.size());
+		}
+
+		/**
+		 * @brief Function which delivers a message to our own listeners
+		 */
+		template<typename T>
+		void send_object_to_self(const T& object){
+			dispatch(_self.id(), encode(object));
+		}
+
+		/**
+		 * @brief Function which adds a listener for messages of type T
+		 *
+		 * @param listener - Function called with a netdata_wrapper<T>& for every received T
+		 * @return listener_id - ID which can be used to remove the listener
+		 */
+		template<typename T, typename F>
+		listener_id add_data_listener(F&& listener){
+			std::scoped_lock lock(mutex);
+			auto& channel = channels[breep::type_traits<T>::hash_code()];
+			if(!channel) channel = std::make_unique<Channel<T>>();
+			listener_id id = nextListener++;
+			static_cast<Channel<T>&>(*channel).listeners.emplace_back(id, std::forward<F>(listener));
+			return id;
+		}
+
+		/**
+		 * @brief Function which removes a listener for messages of type T
+		 *
+		 * @return bool - True if the listener was found and removed
+		 */
+		template<typename T>
+		bool remove_data_listener(listener_id id){
+			std::scoped_lock lock(mutex);
+			auto channel = channels.find(breep::type_traits<T>::hash_code());
+			if(channel == channels.end()) return false;
+			return std::erase_if(static_cast<Channel<T>&>(*channel->second).listeners, [id](const auto& listener){ return listener.first == id; }) > 0;
+		}
+
+		template<typename F>
+		void add_connection_listener(F&& listener){
+			std::scoped_lock lock(mutex);
+			connectionListeners.emplace_back(std::forward<F>(listener));
+		}
+		template<typename F>
+		void add_disconnection_listener(F&& listener){
+			std::scoped_lock lock(mutex);
+			disconnectionListeners.emplace_back(std::forward<F>(listener));
+		}
+
+	protected:
+		/**
+		 * @brief The listeners of a single type of message
+		 */
+		struct ChannelBase {
+			virtual ~ChannelBase() = default;
+			virtual void dispatch(Network& network, const Peer& source, std::string_view payload) = 0;
+		};
+		template<typename T>
+		struct Channel : public ChannelBase {
+			std::vector<std::pair<listener_id, std::function<void(netdata_wrapper<T>&)>>> listeners;
+
+			// Decodes the message once and passes it to every listener
+			void dispatch(Network& network, const Peer& source, std::string_view payload) override {
+				breep::deserializer d(std::basic_string<uint8_t>((const uint8_t*) payload.data(), payload.size()));
+				T data;
+				d >> data;
+
+				netdata_wrapper<T> wrapper{network, source, data};
+				for(size_t i = 0; i < listeners.size(); i++){
+					auto listener = listeners[i].second; // Copied since the listener may add more listeners
+					listener(wrapper);
+				}
+			}
+		};
+
+		// The backend carrying our messages
+		std::unique_ptr<Transport> transport;
+		// Our identity, and the peers we are connected to
+		Peer _self;
+		std::unordered_map<PeerID, Peer, boost::hash<PeerID>> _peers;
+
+		// The listeners of each type of message
+		std::unordered_map<MessageType, std::unique_ptr<ChannelBase>> channels;
+		std::vector<std::function<void(Network&, const Peer&)>> connectionListeners, disconnectionListeners;
+		listener_id nextListener = 1;
+		// Mutex serializing the delivery of messages (and protecting the listeners, the peers are only modified while it is held so dispatch can read them)
+		mutable std::recursive_mutex mutex;
+		// Mutex protecting the peers (held only while they are read or modified, never while calling out, so it never waits on a listener)
+		mutable std::mutex peersMutex;
+		// Capture everything received from peers is recorded to (if capturing)
+		std::unique_ptr<CaptureWriter> capture;
+		// How much of each type of message has been sent (and the mutex protecting it)
+		std::unordered_map<MessageType, Traffic> sent;
+		mutable std::mutex trafficMutex;
+
+		void recordLocal(std::string_view payload);
+
+		void count(MessageType type, size_t messages, size_t size){
+			std::scoped_lock lock(trafficMutex);
+			auto& traffic = sent[type];
+			traffic.messages += messages;
+			traffic.bytes += messages * size;
+		}
+
+		/**
+		 * @brief Function which converts a message into its type tag followed by its serialized form
+		 */
+		template<typename T>
+		static std::string encode(const T& object){
+			breep::serializer s;
+			s << object;
+			auto payload = s.str();
+
+			std::string out(sizeof(MessageType) + payload.size(), '\0');
+			MessageType type = breep::type_traits<T>::hash_code();
+			std::memcpy(out.data(), &type, sizeof(type));
+			std::memcpy(out.data() + sizeof(type), payload.data(), payload.size());
+			return out;
+		}
+
+		void dispatch(const PeerID& source, std::string_view message);
+		void connection(const PeerID& peer, bool connected);
+	};
+
+
+	// -- Breep --
+
+
+	/**
+	 * @brief Transport backed by a Breep TCP network (Boost.Asio)
+	 */
+	struct BreepTransport : public Transport {
+		BreepTransport(unsigned short port);
+
+		const char* name() const override { return "Breep"; }
+		const PeerID& self() const override { return network.self().id(); }
+
+		void handle(MessageHandler onMessage, ConnectionHandler onConnection) override;
+		void start() override { network.awake(); }
+		bool connect(const boost::asio::ip::address& address, unsigned short port) override { return network.connect(address, port); }
+		void send(const PeerID& to, std::string_view message) override;
+		void disconnect() override { network.disconnect(); }
+
+	protected:
+		breep::tcp::network network;
+	};
+
+
+	// -- io_uring --
+
+
+	/**
+	 * @brief Transport which drives TCP sockets through a single io_uring
+	 * @note Every socket has a multishot receive armed which fills buffers handed to the kernel up front (a provided buffer group), so receiving takes no syscalls or allocations.
+	 * 	Frames which arrive whole are delivered straight out of the provided buffer
+	 * @note Sends (from any thread) are gathered per peer and every operation queued during an iteration of the event loop is submitted with a single io_uring_enter
+	 * @note Wire format: frames of (length (4), kind (1), payload), each side of a connection first sends a hello (its ID and listening port),
+	 * 	the accepting side then sends the addresses of its other peers so the network forms a mesh (as Breep's does)
+	 */
+	struct UringTransport : public Transport {
+		UringTransport(unsigned short port);
+		~UringTransport();
+
+		const char* name() const override { return "io_uring"; }
+		const PeerID& self() const override { return id; }
+
+		void handle(MessageHandler onMessage, ConnectionHandler onConnection) override { this->onMessage = std::move(onMessage); this->onConnection = std::move(onConnection); }
+		void start() override;
+		bool connect(const boost::asio::ip::address& address, unsigned short port) override;
+		void send(const PeerID& to, std::string_view message) override;
+		void disconnect() override;
+
+	protected:
+		struct Ring;
+		struct Connection;
+
+		// Our identity and the port we listen on
+		PeerID id;
+		unsigned short port;
+		int listener = -1;
+		// File descriptor used to wake the event loop when there is work for it (and where the wakeups are read into)
+		int wakeup = -1;
+		uint64_t wakeups = 0;
+
+		// Memory backing the provided receive buffers
+		std::unique_ptr<char[]> buffers;
+		std::unique_ptr<Ring> ring;
+
+		// Connections (owned by the event loop), indexed by serial number
+		std::unordered_map<uint64_t, std::unique_ptr<Connection>> connections;
+		uint64_t nextSerial = 1;
+		// Map from identified peers to the serial number of their connection (owned by the event loop)
+		std::unordered_map<PeerID, uint64_t, boost::hash<PeerID>> peers;
+
+		// Work handed to the event loop by other threads: messages to send, and newly connected sockets
+		std::vector<std::pair<PeerID, std::string>> outbox;
+		std::vector<int> connected;
+		std::mutex outboxMutex;
+
+		MessageHandler onMessage;
+		ConnectionHandler onConnection;
+		std::thread loop;
+		std::atomic<bool> running = false;
+
+		void run();
+		void wake();
+		void completed(uint64_t userData, int32_t result, uint32_t flags);
+		Connection& adopt(int fd, bool accepted);
+		void dial(uint32_t address, unsigned short port);
+		void armReceive(Connection& connection);
+		void armSend(Connection& connection);
+		void cancel(Connection& connection);
+		void received(Connection& connection, std::string_view data);
+		void frame(Connection& connection, uint8_t kind, std::string_view payload);
+		void identify(Connection& connection, const PeerID& peer, unsigned short listeningPort);
+		void queue(Connection& connection, uint8_t kind, std::string_view payload);
+		void close(Connection& connection);
+	};
+
+
+
+	// -- Loopback --
+
+
+	/**
+	 * @brief Lock-free multiple producer single consumer queue (Vyukov's intrusive linked list)
+	 * @note Any thread may push, only one thread may pop
+	 */
+	template<typename T>
+	struct MPSCQueue {
+		MPSCQueue() : head(new Node), tail(head.load()) {}
+		~MPSCQueue(){
+			while(pop());
+			delete tail;
+		}
+
+		void push(T value){
+			Node* node = new Node{ {nullptr}, std::move(value) };
+			Node* previous = head.exchange(node, std::memory_order_acq_rel);
+			previous->next.store(node, std::memory_order_release);
+		}
+
+		/**
+		 * @brief Function which removes the oldest item
+		 * @return std::optional<T> - The item, or nothing if the queue is empty (or a push is halfway done)
+		 */
+		std::optional<T> pop(){
+			Node* next = tail->next.load(std::memory_order_acquire);
+			if(!next) return {};
+			std::optional<T> out = std::move(next->value);
+			delete tail;
+			tail = next; // The popped node becomes the new (empty) sentinel
+			return out;
+		}
+
+	protected:
+		struct Node {
+			std::atomic<Node*> next = nullptr;
+			T value;
+		};
+		// Most recently pushed node (shared by the producers), and the sentinel before the oldest node (owned by the consumer)
+		std::atomic<Node*> head;
+		Node* tail;
+	};
+
+	/**
+	 * @brief Transport which connects transports in the same process without any sockets (for exercising the tangle at rates real networks can't reach)
+	 * @note Transports find each other by port (the address is ignored), connecting to one also connects to all of its peers (so they form a mesh as Breep's do)
+	 * @note Sending moves the message into the receiver's lock-free inbox, each transport's own thread empties its inbox into the handlers.
+	 * 	Only connecting and disconnecting take a lock
+	 */
+	struct LoopbackTransport : public Transport {
+		LoopbackTransport(unsigned short port);
+		~LoopbackTransport();
+
+		const char* name() const override { return "loopback"; }
+		const PeerID& self() const override { return endpoint->id; }
+
+		void handle(MessageHandler onMessage, ConnectionHandler onConnection) override { endpoint->onMessage = std::move(onMessage); endpoint->onConnection = std::move(onConnection); }
+		void start() override;
+		bool connect(const boost::asio::ip::address& address, unsigned short port) override;
+		void send(const PeerID& to, std::string_view message) override;
+		void disconnect() override;
+
+	protected:
+		/**
+		 * @brief Something delivered to a transport's inbox, a message or a peer dis/connecting
+		 */
+		struct Envelope {
+			enum Kind : uint8_t { Message, Connected, Disconnected } kind;
+			PeerID source;
+			std::string payload;
+		};
+
+		/**
+		 * @brief The part of a transport its peers hold on to (so it stays valid while they are sending to it)
+		 */
+		struct Endpoint {
+			PeerID id;
+			unsigned short port;
+			MPSCQueue<Envelope> inbox;
+			// Number of envelopes pushed to the inbox (the delivery thread sleeps on it)
+			std::atomic<uint64_t> pushed = 0;
+
+			// The peers we are connected to (replaced, never modified, so it can be read without locking)
+			using PeerTable = std::unordered_map<PeerID, std::shared_ptr<Endpoint>, boost::hash<PeerID>>;
+			std::atomic<std::shared_ptr<const PeerTable>> peers = std::make_shared<const PeerTable>();
+
+			MessageHandler onMessage;
+			ConnectionHandler onConnection;
+
+			void deliver(Envelope envelope){
+				inbox.push(std::move(envelope));
+				pushed.fetch_add(1, std::memory_order_release);
+				pushed.notify_one();
+			}
+		};
+
+		std::shared_ptr<Endpoint> endpoint;
+		std::thread delivery;
+		std::atomic<bool> running = false;
+
+		// Every loopback transport in the process, indexed by port (and the mutex protecting it, and every peer table change)
+		static std::unordered_map<unsigned short, std::weak_ptr<Endpoint>> registry;
+		static std::mutex registryMutex;
+
+		void run();
+		static void link(const std::shared_ptr<Endpoint>& a, const std::shared_ptr<Endpoint>& b);
+	};
+
+} // transport
+
+#endif /* end of include guard: TRANSPORT_HPP */
@@ -0,0 +1,138 @@
+/**
+ * @file transport_loopback.cpp
+ * @author Joshua Dahl (jdahl@unr.edu)
+ * @brief The code backing the in-process loopback backend of transport.hpp
+ * @version 0.1
+ * @date 2021-12-11
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#include "transport.hpp"
+
+#include <boost/uuid/random_generator.hpp>
+
+namespace transport {
+
+	std::unordered_map<unsigned short, std::weak_ptr<LoopbackTransport::Endpoint>> LoopbackTransport::registry;
+	std::mutex LoopbackTransport::registryMutex;
+
+	/**
+	 * @brief Creates a loopback transport which other loopback transports can connect to on <port>
+	 * @exception std::runtime_error - Thrown if another loopback transport in the process is already using the port
+	 */
+	LoopbackTransport::LoopbackTransport(unsigned short port) : endpoint(std::make_shared<Endpoint>()) {
+		endpoint->id = boost::uuids::random_generator()();
+		endpoint->port = port;
+
+		std::scoped_lock lock(registryMutex);
+		if(auto existing = registry.find(port); existing != registry.end() && !existing->second.expired())
+			throw std::runtime_error("Loopback port " + std::to_string(port) + " is already in use");
+		registry[port] = endpoint;
+	}
+
+	LoopbackTransport::~LoopbackTransport(){
+		disconnect();
+	}
+
+	/**
+	 * @brief Function which starts the thread delivering our inbox
+	 */
+	void LoopbackTransport::start(){
+		if(running.exchange(true)) return;
+		delivery = std::thread([this](){ run(); });
+	}
+
+	/**
+	 * @brief Function which connects to the loopback transport on <port> and all of its peers
+	 */
+	bool LoopbackTransport::connect(const boost::asio::ip::address& address, unsigned short port){
+		start();
+
+		std::scoped_lock lock(registryMutex);
+		auto found = registry.find(port);
+		if(found == registry.end()) return false;
+		auto target = found->second.lock();
+		if(!target || target == endpoint) return false;
+
+		link(endpoint, target);
+		for(auto& [id, peer]: *target->peers.load())
+			if(peer != endpoint) link(endpoint, peer);
+		return true;
+	}
+
+	/**
+	 * @brief Function which moves a message into a peer's inbox
+	 */
+	void LoopbackTransport::send(const PeerID& to, std::string_view message){
+		auto peers = endpoint->peers.load(std::memory_order_acquire);
+		if(auto peer = peers->find(to); peer != peers->end())
+			peer->second->deliver({ Envelope::Message, endpoint->id, std::string(message) });
+	}
+
+	/**
+	 * @brief Function which disconnects from every peer and stops the delivery thread
+	 */
+	void LoopbackTransport::disconnect(){
+		{
+			std::scoped_lock lock(registryMutex);
+			if(auto found = registry.find(endpoint->port); found != registry.end() && found->second.lock() == endpoint)
+				registry.erase(found);
+
+			// Remove ourselves from every peer's table (and let them know we left)
+			auto peers = endpoint->peers.exchange(std::make_shared<const Endpoint::PeerTable>());
+			for(auto& [id, peer]: *peers){
+				auto table = std::make_shared<Endpoint::PeerTable>(*peer->peers.load());
+				table->erase(endpoint->id);
+				peer->peers.store(std::move(table), std::memory_order_release);
+				peer->deliver({ Envelope::Disconnected, endpoint->id, {} });
+			}
+		}
+
+		if(running.exchange(false)){
+			endpoint->pushed.fetch_add(1, std::memory_order_release);
+			endpoint->pushed.notify_one();
+			if(delivery.get_id() == std::this_thread::get_id()) delivery.detach();
+			else if(delivery.joinable()) delivery.join();
+		}
+	}
+
+	/**
+	 * @brief The delivery thread, passes everything in our inbox to the handlers (sleeping while it is empty)
+	 */
+	void LoopbackTransport::run(){
+		while(true){
+			// Read the counter before draining, so a push made while we drain stops us from sleeping
+			uint64_t seen = endpoint->pushed.load(std::memory_order_acquire);
+			while(auto envelope = endpoint->inbox.pop())
+				try {
+					switch(envelope->kind){
+					case Envelope::Message: endpoint->onMessage(envelope->source, envelope->payload); break;
+					case Envelope::Connected: endpoint->onConnection(envelope->source, true); break;
+					case Envelope::Disconnected: endpoint->onConnection(envelope->source, false); break;
+					}
+				} catch (std::exception& e) { std::cerr << "Loopback delivery failed" << std::endl << "\t" << e.what() << std::endl; }
+
+			if(!running) break;
+			endpoint->pushed.wait(seen, std::memory_order_acquire);
+		}
+	}
+
+	/**
+	 * @brief Function which connects two endpoints to each other
+	 * @note Expects registryMutex to be held
+	 */
+	void LoopbackTransport::link(const std::shared_ptr<Endpoint>& a, const std::shared_ptr<Endpoint>& b){
+		if(a->peers.load()->contains(b->id)) return;
+
+		auto add = [](const std::shared_ptr<Endpoint>& to, const std::shared_ptr<Endpoint>& peer){
+			auto table = std::make_shared<Endpoint::PeerTable>(*to->peers.load());
+			table->emplace(peer->id, peer);
+			to->peers.store(std::move(table), std::memory_order_release);
+			to->deliver({ Envelope::Connected, peer->id, {} });
+		};
+		add(a, b);
+		add(b, a);
+	}
+
+} // transport
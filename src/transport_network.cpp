@@ -0,0 +1,172 @@
+/**
+ * @file transport_network.cpp
+ * @author Joshua Dahl (jdahl@unr.edu)
+ * @brief The code backing the message layer and the Breep backend of transport.hpp
+ * @version 0.1
+ * @date 2021-12-11
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#include "transport.hpp"
+#include "capture.hpp"
+
+namespace transport {
+
+
+	// -- Message Layer --
+
+
+	/**
+	 * @brief Creates a message layer on top of a transport backend, routing everything the backend receives to our listeners
+	 *
+	 * @param transport - The backend which carries the messages
+	 */
+	Network::Network(std::unique_ptr<Transport> transport) : transport(std::move(transport)), _self(this->transport->self()) {
+		this->transport->handle(
+			[this](const PeerID& source, std::string_view message){ dispatch(source, message); },
+			[this](const PeerID& peer, bool connected){ connection(peer, connected); }
+		);
+	}
+
+	/**
+	 * @brief Destructor which makes sure the backend has stopped calling us before we are destroyed
+	 */
+	Network::~Network(){
+		transport->disconnect();
+	}
+
+	/**
+	 * @brief Function which disconnects from the network
+	 */
+	void Network::disconnect(){
+		transport->disconnect();
+		std::scoped_lock lock(mutex);
+		{
+			std::scoped_lock peersLock(peersMutex);
+			_peers.clear();
+		}
+		if(capture) capture->flush();
+	}
+
+	/**
+	 * @brief Function which starts recording every message received from (and every dis/connection of) our peers to a capture file (see capture.hpp)
+	 *
+	 * @param path - Where to save the capture
+	 */
+	void Network::startCapture(const std::string& path){
+		std::scoped_lock lock(mutex);
+		capture = std::make_unique<CaptureWriter>(path, _self.id());
+	}
+
+	/**
+	 * @brief Function which stops recording (flushing the capture to disk)
+	 */
+	void Network::stopCapture(){
+		std::scoped_lock lock(mutex);
+		capture.reset();
+	}
+
+	/**
+	 * @brief Function which appends a record of something we originated to the capture
+	 * @note Called with the mutex held
+	 *
+	 * @param payload - What we originated (see CaptureRecord::Local)
+	 */
+	void Network::recordLocal(std::string_view payload){
+		capture->write(CaptureRecord::Local, _self.id(), payload);
+	}
+
+	/**
+	 * @brief Function which passes a received message to the listeners of its type
+	 *
+	 * @param source - The peer who sent the message
+	 * @param message - The message's type tag followed by its serialized form
+	 */
+	void Network::dispatch(const PeerID& source, std::string_view message){
+		std::scoped_lock lock(mutex);
+		// Messages we send ourselves aren't recorded, local transactions are recorded separately (see captureLocal) and tangles loaded from disk are reloaded by the replay tool (see --tangle)
+		if(capture && source != _self.id())
+			capture->write(CaptureRecord::Message, source, message);
+
+		if(message.size() < sizeof(MessageType)) return;
+		MessageType type;
+		std::memcpy(&type, message.data(), sizeof(type));
+
+		auto channel = channels.find(type);
+		if(channel == channels.end()) return; // Nobody is listening for this message
+
+		// Messages from peers the backend hasn't finished connecting (or ourselves) get a temporary peer
+		Peer temporary(source);
+		const Peer* peer = &temporary;
+		if(source == _self.id()) peer = &_self;
+		else if(auto found = _peers.find(source); found != _peers.end()) peer = &found->second;
+
+		try {
+			channel->second->dispatch(*this, *peer, message.substr(sizeof(MessageType)));
+		} catch (std::exception& e) { std::cerr << "Failed to process message from `" << source << "`" << std::endl << "\t" << e.what() << std::endl; }
+	}
+
+	/**
+	 * @brief Function which updates the list of peers and notifies the dis/connection listeners when a peer dis/connects
+	 *
+	 * @param id - The peer who dis/connected
+	 * @param connected - True if the peer connected, false if they disconnected
+	 */
+	void Network::connection(const PeerID& id, bool connected){
+		std::scoped_lock lock(mutex);
+		if(capture) capture->write(connected ? CaptureRecord::Connected : CaptureRecord::Disconnected, id);
+
+		if(connected){
+			Peer* peer;
+			{
+				std::scoped_lock peersLock(peersMutex);
+				peer = &_peers.insert_or_assign(id, Peer(id)).first->second;
+			}
+			for(auto& listener: connectionListeners)
+				listener(*this, *peer);
+		} else {
+			Peer peer(id, false);
+			{
+				std::scoped_lock peersLock(peersMutex);
+				_peers.erase(id);
+			}
+			for(auto& listener: disconnectionListeners)
+				listener(*this, peer);
+		}
+	}
+
+
+	// -- Breep --
+
+
+	/**
+	 * @brief Creates a Breep network listening on <port>
+	 */
+	BreepTransport::BreepTransport(unsigned short port) : network(port) {}
+
+	/**
+	 * @brief Function which forwards the Breep network's raw data and dis/connection events
+	 */
+	void BreepTransport::handle(MessageHandler onMessage, ConnectionHandler onConnection){
+		network.add_data_listener([onMessage](breep::tcp::network&, const breep::tcp::peer& source, auto data, size_t size, bool){
+			onMessage(source.id(), { (const char*) &*data, size });
+		});
+		network.add_connection_listener([onConnection](breep::tcp::network&, const breep::tcp::peer& peer){
+			onConnection(peer.id(), true);
+		});
+		network.add_disconnection_listener([onConnection](breep::tcp::network&, const breep::tcp::peer& peer){
+			onConnection(peer.id(), false);
+		});
+	}
+
+	/**
+	 * @brief Function which sends a message to a peer
+	 */
+	void BreepTransport::send(const PeerID& to, std::string_view message){
+		auto& peers = network.peers();
+		if(auto peer = peers.find(to); peer != peers.end())
+			network.send_to(peer->second, std::vector<uint8_t>(message.begin(), message.end()));
+	}
+
+} // transport
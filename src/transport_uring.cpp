@@ -0,0 +1,733 @@
+/**
+ * @file transport_uring.cpp
+ * @author Joshua Dahl (jdahl@unr.edu)
+ * @brief The code backing the io_uring backend of transport.hpp
+ * @note Talks to the kernel directly (io_uring_setup/enter/register) rather than through liburing, requires Linux 6.0 or newer (multishot receives)
+ * @version 0.1
+ * @date 2021-12-11
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#include "transport.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <optional>
+
+#include <arpa/inet.h>
+#include <linux/io_uring.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <boost/uuid/random_generator.hpp>
+
+namespace transport {
+
+	// Kinds of frames
+	enum FrameKind : uint8_t { HelloFrame = 0, PeersFrame = 1, MessageFrame = 2 };
+	// Size of a frame's header (length (4) and kind (1))
+	static constexpr size_t FRAME_HEADER_SIZE = 5;
+	// Size of a hello's payload (ID (16) and listening port (2)) and of an entry in a list of peers (IPv4 address (4) and port (2))
+	static constexpr size_t HELLO_SIZE = 18, PEER_ENTRY_SIZE = 6;
+
+	// Kinds of operations, stored in the low byte of an operation's user data (the serial number of the operation's connection is stored in the rest)
+	enum Operation : uint8_t { ProvideOperation = 0, AcceptOperation, WakeOperation, CancelOperation, ConnectOperation, ReceiveOperation, SendOperation };
+	static uint64_t userData(uint64_t serial, Operation operation) { return (serial << 8) | operation; }
+
+	// ID of the group of provided receive buffers
+	static constexpr uint16_t BUFFER_GROUP = 0;
+
+
+	// -- Ring --
+
+
+	/**
+	 * @brief Minimal wrapper around the memory shared with the kernel by an io_uring (its submission and completion rings)
+	 * @note Only used from the event loop's thread
+	 */
+	struct UringTransport::Ring {
+		int fd = -1;
+
+		// Submission queue
+		unsigned *sqHead, *sqTail, *sqArray, sqMask, sqEntries;
+		io_uring_sqe* sqes;
+		// Tail including the entries which have been prepared but not yet submitted
+		unsigned sqLocalTail = 0;
+
+		// Completion queue
+		unsigned *cqHead, *cqTail, cqMask;
+		io_uring_cqe* cqes;
+
+		// Mapped memory
+		void *sqRing = MAP_FAILED, *cqRing = MAP_FAILED, *sqeMemory = MAP_FAILED;
+		size_t sqRingSize = 0, cqRingSize = 0, sqeSize = 0;
+
+		/**
+		 * @brief Creates a ring
+		 *
+		 * @param entries - Size of the submission queue (the completion queue is twice as large)
+		 * @exception Unavailable - Thrown if the kernel doesn't support io_uring (or it is disabled)
+		 */
+		Ring(unsigned entries){
+			io_uring_params params = {};
+			params.flags = IORING_SETUP_CQSIZE;
+			params.cq_entries = entries * 2;
+			fd = syscall(__NR_io_uring_setup, entries, &params);
+			if(fd < 0) throw Unavailable(std::string("io_uring_setup failed: ") + std::strerror(errno));
+
+			// Map the rings (newer kernels share a single mapping between the submission and completion rings)
+			sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+			cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+			bool singleMapping = params.features & IORING_FEAT_SINGLE_MMAP;
+			if(singleMapping) sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+
+			sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+			if(sqRing == MAP_FAILED) { unmap(); throw Unavailable("Failed to map the io_uring submission ring"); }
+			cqRing = singleMapping ? sqRing : mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+			if(cqRing == MAP_FAILED) { unmap(); throw Unavailable("Failed to map the io_uring completion ring"); }
+			sqeSize = params.sq_entries * sizeof(io_uring_sqe);
+			sqeMemory = mmap(nullptr, sqeSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+			if(sqeMemory == MAP_FAILED) { unmap(); throw Unavailable("Failed to map the io_uring submission entries"); }
+
+			char* sq = (char*) sqRing;
+			sqHead = (unsigned*) (sq + params.sq_off.head);
+			sqTail = (unsigned*) (sq + params.sq_off.tail);
+			sqArray = (unsigned*) (sq + params.sq_off.array);
+			sqMask = *(unsigned*) (sq + params.sq_off.ring_mask);
+			sqEntries = *(unsigned*) (sq + params.sq_off.ring_entries);
+			sqes = (io_uring_sqe*) sqeMemory;
+			sqLocalTail = *sqTail;
+
+			char* cq = (char*) cqRing;
+			cqHead = (unsigned*) (cq + params.cq_off.head);
+			cqTail = (unsigned*) (cq + params.cq_off.tail);
+			cqMask = *(unsigned*) (cq + params.cq_off.ring_mask);
+			cqes = (io_uring_cqe*) (cq + params.cq_off.cqes);
+		}
+
+		~Ring(){ unmap(); }
+
+		/**
+		 * @brief Function which unmaps the shared memory and closes the ring
+		 */
+		void unmap(){
+			if(sqeMemory != MAP_FAILED) munmap(sqeMemory, sqeSize);
+			if(cqRing != MAP_FAILED && cqRing != sqRing) munmap(cqRing, cqRingSize);
+			if(sqRing != MAP_FAILED) munmap(sqRing, sqRingSize);
+			if(fd >= 0) ::close(fd);
+			sqeMemory = cqRing = sqRing = MAP_FAILED; fd = -1;
+		}
+
+		/**
+		 * @brief Function which hands <count> buffers of <size> bytes (starting at <memory>) to the kernel as the buffers receives fill
+		 * @note Queued, the kernel has the buffers after the next submit
+		 */
+		void provide(char* memory, unsigned count, unsigned size, uint16_t firstID){
+			io_uring_sqe* sqe = next();
+			sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+			sqe->fd = count;
+			sqe->addr = (uint64_t) memory;
+			sqe->len = size;
+			sqe->off = firstID;
+			sqe->buf_group = BUFFER_GROUP;
+			sqe->user_data = userData(0, ProvideOperation);
+		}
+
+		/**
+		 * @brief Function which provides the next free submission entry (submitting the prepared entries first if the queue is full)
+		 */
+		io_uring_sqe* next(){
+			while(sqLocalTail - std::atomic_ref<unsigned>(*sqHead).load(std::memory_order_acquire) >= sqEntries)
+				submit(0);
+
+			unsigned index = sqLocalTail++ & sqMask;
+			sqArray[index] = index;
+			io_uring_sqe* sqe = &sqes[index];
+			std::memset(sqe, 0, sizeof(*sqe));
+			return sqe;
+		}
+
+		/**
+		 * @brief Function which submits every prepared entry (in a single system call)
+		 *
+		 * @param waitFor - Number of completions to wait for
+		 */
+		void submit(unsigned waitFor){
+			std::atomic_ref<unsigned>(*sqTail).store(sqLocalTail, std::memory_order_release);
+			unsigned pending = sqLocalTail - std::atomic_ref<unsigned>(*sqHead).load(std::memory_order_acquire);
+
+			if(syscall(__NR_io_uring_enter, fd, pending, waitFor, waitFor ? IORING_ENTER_GETEVENTS : 0, nullptr, 0) < 0)
+				if(errno != EINTR && errno != EAGAIN && errno != EBUSY)
+					throw std::runtime_error(std::string("io_uring_enter failed: ") + std::strerror(errno));
+		}
+
+		/**
+		 * @brief Function which calls <f> with the user data, result, and flags of every available completion
+		 */
+		template<typename F>
+		void completions(F&& f){
+			unsigned head = *cqHead;
+			unsigned tail = std::atomic_ref<unsigned>(*cqTail).load(std::memory_order_acquire);
+			for(; head != tail; head++){
+				const io_uring_cqe& cqe = cqes[head & cqMask];
+				f(cqe.user_data, cqe.res, cqe.flags);
+			}
+			std::atomic_ref<unsigned>(*cqHead).store(head, std::memory_order_release);
+		}
+	};
+
+
+	// -- Connections --
+
+
+	/**
+	 * @brief State of a single socket
+	 */
+	struct UringTransport::Connection {
+		uint64_t serial;
+		int fd;
+		// True if the peer connected to us, false if we connected to them
+		bool accepted;
+		// Address the peer can be reached at (their listening port is filled in once they say hello)
+		sockaddr_in address = {};
+		// The peer's ID (once they have said hello)
+		std::optional<PeerID> peer;
+
+		// Bytes of a frame which hasn't been completely received yet
+		std::string partial;
+		// Bytes waiting to be sent, and bytes the kernel is currently sending
+		std::string pending, sending;
+
+		// Number of operations the kernel has in flight for the connection (it can't be freed until they are all complete)
+		size_t inflight = 0;
+		bool closing = false;
+	};
+
+
+	// -- Transport --
+
+
+	/**
+	 * @brief Creates an io_uring transport listening on <port>
+	 * @exception Unavailable - Thrown if io_uring (or a feature it needs) isn't supported
+	 */
+	UringTransport::UringTransport(unsigned short port) : id(boost::uuids::random_generator()()), port(port) {
+		ring = std::make_unique<Ring>(URING_RING_ENTRIES);
+		buffers = std::make_unique<char[]>(size_t(URING_RECV_BUFFERS) * URING_RECV_BUFFER_SIZE);
+		ring->provide(buffers.get(), URING_RECV_BUFFERS, URING_RECV_BUFFER_SIZE, 0);
+
+		wakeup = eventfd(0, EFD_CLOEXEC);
+		if(wakeup < 0) throw std::runtime_error(std::string("Failed to create an eventfd: ") + std::strerror(errno));
+
+		// Start listening
+		listener = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		int enable = 1;
+		setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+		sockaddr_in address = {};
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_ANY);
+		address.sin_port = htons(port);
+		if(listener < 0 || bind(listener, (sockaddr*) &address, sizeof(address)) < 0 || listen(listener, SOMAXCONN) < 0)
+			throw std::runtime_error("Failed to listen on port " + std::to_string(port) + ": " + std::strerror(errno));
+	}
+
+	UringTransport::~UringTransport(){
+		disconnect();
+		ring.reset(); // The kernel must stop using the buffers before they are freed
+		if(listener >= 0) ::close(listener);
+		if(wakeup >= 0) ::close(wakeup);
+	}
+
+	/**
+	 * @brief Function which starts the event loop
+	 */
+	void UringTransport::start(){
+		if(running.exchange(true)) return;
+		loop = std::thread([this](){
+			try {
+				run();
+			} catch (std::exception& e) { std::cerr << "io_uring transport stopped" << std::endl << "\t" << e.what() << std::endl; }
+		});
+	}
+
+	/**
+	 * @brief Function which connects to a peer
+	 * @note The socket is connected on the calling thread and then handed to the event loop
+	 */
+	bool UringTransport::connect(const boost::asio::ip::address& address, unsigned short port){
+		if(!address.is_v4()) return false;
+		start();
+
+		sockaddr_in remote = {};
+		remote.sin_family = AF_INET;
+		remote.sin_addr.s_addr = htonl(address.to_v4().to_uint());
+		remote.sin_port = htons(port);
+
+		int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		if(fd < 0) return false;
+		if(::connect(fd, (sockaddr*) &remote, sizeof(remote)) < 0){
+			::close(fd);
+			return false;
+		}
+
+		{
+			std::scoped_lock lock(outboxMutex);
+			connected.push_back(fd);
+		}
+		wake();
+		return true;
+	}
+
+	/**
+	 * @brief Function which queues a message to be sent by the event loop
+	 */
+	void UringTransport::send(const PeerID& to, std::string_view message){
+		bool first;
+		{
+			std::scoped_lock lock(outboxMutex);
+			first = outbox.empty();
+			outbox.emplace_back(to, message);
+		}
+		// The event loop takes the whole outbox at once, so it only needs waking for the first message
+		if(first) wake();
+	}
+
+	/**
+	 * @brief Function which stops the event loop and closes every connection
+	 * @note The kernel references a connection's send buffer and address until its operations complete, so every operation is cancelled and waited for before the connections are freed
+	 */
+	void UringTransport::disconnect(){
+		if(running.exchange(false)){
+			wake();
+			if(loop.joinable()) loop.join();
+		}
+
+		// Shut the sockets down (completing any receive or send armed on them), and cancel whatever else is in flight (like a connect)
+		for(auto& [serial, connection]: connections){
+			connection->closing = true;
+			shutdown(connection->fd, SHUT_RDWR);
+			if(connection->inflight) cancel(*connection);
+		}
+
+		// Wait for the kernel to finish with every connection
+		try {
+			auto busy = [this](){ return std::any_of(connections.begin(), connections.end(), [](const auto& pair){ return pair.second->inflight > 0; }); };
+			while(busy()){
+				ring->submit(1);
+				ring->completions([&](uint64_t data, int32_t result, uint32_t flags){
+					switch(Operation(data & 0xFF)){
+					case AcceptOperation:
+						if(result >= 0) ::close(result); // Nobody will adopt the socket
+						break;
+					case ProvideOperation: case WakeOperation: case CancelOperation: break;
+					default:
+						completed(data, result, flags);
+					}
+				});
+			}
+		} catch (std::exception& e) {
+			// We can't tell what the kernel is still using, leak the connections rather than free memory it may write to
+			std::cerr << "Failed to wait for the io_uring transport's operations to finish" << std::endl << "\t" << e.what() << std::endl;
+			for(auto& [serial, connection]: connections){
+				::close(connection->fd);
+				connection.release();
+			}
+		}
+
+		for(auto& [serial, connection]: connections)
+			if(connection) ::close(connection->fd);
+		connections.clear();
+		peers.clear();
+	}
+
+	/**
+	 * @brief Function which wakes the event loop
+	 */
+	void UringTransport::wake(){
+		uint64_t one = 1;
+		[[maybe_unused]] auto _ = write(wakeup, &one, sizeof(one));
+	}
+
+	/**
+	 * @brief The event loop, every iteration queues the work handed to it, submits everything queued in one system call, and then handles the completions
+	 */
+	void UringTransport::run(){
+		// Arm a multishot accept on the listening socket, and a read of the wakeup eventfd
+		auto armAccept = [this](){
+			io_uring_sqe* sqe = ring->next();
+			sqe->opcode = IORING_OP_ACCEPT;
+			sqe->fd = listener;
+			sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+			sqe->user_data = userData(0, AcceptOperation);
+		};
+		auto armWake = [this](){
+			io_uring_sqe* sqe = ring->next();
+			sqe->opcode = IORING_OP_READ;
+			sqe->fd = wakeup;
+			sqe->addr = (uint64_t) &wakeups;
+			sqe->len = sizeof(wakeups);
+			sqe->user_data = userData(0, WakeOperation);
+		};
+		armAccept();
+		armWake();
+
+		std::vector<std::pair<PeerID, std::string>> messages;
+		std::vector<int> sockets;
+		while(running){
+			// Take the work other threads have handed us
+			{
+				std::scoped_lock lock(outboxMutex);
+				std::swap(messages, outbox);
+				std::swap(sockets, connected);
+			}
+			for(int fd: sockets)
+				adopt(fd, /*accepted*/ false);
+			for(auto& [to, message]: messages)
+				if(auto peer = peers.find(to); peer != peers.end())
+					queue(*connections.at(peer->second), MessageFrame, message);
+			messages.clear();
+			sockets.clear();
+
+			// Start sending everything which has been queued
+			for(auto& [serial, connection]: connections)
+				if(!connection->closing && connection->sending.empty() && !connection->pending.empty())
+					armSend(*connection);
+
+			// Submit and wait for something to happen
+			ring->submit(1);
+
+			ring->completions([&](uint64_t data, int32_t result, uint32_t flags){
+				switch(Operation(data & 0xFF)){
+				case AcceptOperation:
+					if(result >= 0) adopt(result, /*accepted*/ true);
+					if(!(flags & IORING_CQE_F_MORE) && running) armAccept();
+					break;
+				case ProvideOperation: break; // The buffers are back in the kernel's hands
+				case WakeOperation:
+					if(running) armWake();
+					break;
+				default:
+					completed(data, result, flags);
+				}
+			});
+
+			// Free the connections which have been closed (once the kernel is done with them)
+			std::erase_if(connections, [](const auto& pair){
+				if(!pair.second->closing || pair.second->inflight) return false;
+				::close(pair.second->fd);
+				return true;
+			});
+		}
+	}
+
+	/**
+	 * @brief Function which handles the completion of an operation on a connection
+	 *
+	 * @param data - The operation's user data (the connection's serial number and the kind of operation)
+	 * @param result - The operation's result (bytes transferred, or a negative error)
+	 * @param flags - The completion's flags
+	 */
+	void UringTransport::completed(uint64_t data, int32_t result, uint32_t flags){
+		// Receives give back the buffer they filled, it must be returned to the kernel even if the connection is gone
+		char* buffer = nullptr;
+		uint16_t bufferID = 0;
+		if(flags & IORING_CQE_F_BUFFER){
+			bufferID = flags >> IORING_CQE_BUFFER_SHIFT;
+			buffer = buffers.get() + size_t(bufferID) * URING_RECV_BUFFER_SIZE;
+		}
+
+		auto found = connections.find(data >> 8);
+		if(found == connections.end()) {
+			if(buffer) ring->provide(buffer, 1, URING_RECV_BUFFER_SIZE, bufferID);
+			return;
+		}
+		Connection& connection = *found->second;
+
+		switch(Operation(data & 0xFF)){
+		case ConnectOperation:
+			connection.inflight--;
+			if(result < 0 || connection.closing) close(connection);
+			else {
+				armReceive(connection);
+				unsigned short listening = htons(port);
+				std::string hello((const char*) id.data, 16);
+				hello.append((const char*) &listening, 2);
+				queue(connection, HelloFrame, hello);
+			}
+			break;
+
+		case ReceiveOperation:
+			// Deliver what was received straight out of the provided buffer (and then give the buffer back)
+			if(buffer){
+				if(result > 0 && !connection.closing) received(connection, { buffer, size_t(result) });
+				ring->provide(buffer, 1, URING_RECV_BUFFER_SIZE, bufferID);
+			}
+			// If the receive is no longer armed, either rearm it (we ran out of buffers) or the connection is done
+			if(!(flags & IORING_CQE_F_MORE)){
+				connection.inflight--;
+				if(connection.closing) break;
+				if(result == -ENOBUFS || result > 0) armReceive(connection);
+				else close(connection);
+			}
+			break;
+
+		case SendOperation:
+			connection.inflight--;
+			if(result < 0) { close(connection); break; }
+			connection.sending.erase(0, result);
+			// Finish a short send, or send whatever was queued while we were sending
+			if(!connection.closing && (!connection.sending.empty() || !connection.pending.empty()))
+				armSend(connection);
+			break;
+
+		default: break;
+		}
+	}
+
+	/**
+	 * @brief Function which starts tracking a connected socket, arming a receive on it and saying hello
+	 *
+	 * @param fd - The socket
+	 * @param accepted - True if the peer connected to us, false if we connected to them
+	 */
+	UringTransport::Connection& UringTransport::adopt(int fd, bool accepted){
+		int enable = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+		auto& connection = *connections.emplace(nextSerial, std::make_unique<Connection>(Connection{nextSerial, fd, accepted})).first->second;
+		nextSerial++;
+		socklen_t size = sizeof(connection.address);
+		getpeername(fd, (sockaddr*) &connection.address, &size);
+
+		armReceive(connection);
+		unsigned short listening = htons(port);
+		std::string hello((const char*) id.data, 16);
+		hello.append((const char*) &listening, 2);
+		queue(connection, HelloFrame, hello);
+		return connection;
+	}
+
+	/**
+	 * @brief Function which starts connecting to a peer we heard about from another peer (the connect happens asynchronously in the ring)
+	 *
+	 * @param address - The peer's IPv4 address (network byte order)
+	 * @param port - The peer's listening port (network byte order)
+	 */
+	void UringTransport::dial(uint32_t address, unsigned short port){
+		int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		if(fd < 0) return;
+		int enable = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+		auto& connection = *connections.emplace(nextSerial, std::make_unique<Connection>(Connection{nextSerial, fd, /*accepted*/ false})).first->second;
+		nextSerial++;
+		connection.address.sin_family = AF_INET;
+		connection.address.sin_addr.s_addr = address;
+		connection.address.sin_port = port;
+
+		io_uring_sqe* sqe = ring->next();
+		sqe->opcode = IORING_OP_CONNECT;
+		sqe->fd = fd;
+		sqe->addr = (uint64_t) &connection.address;
+		sqe->off = sizeof(connection.address);
+		sqe->user_data = userData(connection.serial, ConnectOperation);
+		connection.inflight++;
+	}
+
+	/**
+	 * @brief Function which arms a multishot receive (filling provided buffers) on a connection
+	 */
+	void UringTransport::armReceive(Connection& connection){
+		io_uring_sqe* sqe = ring->next();
+		sqe->opcode = IORING_OP_RECV;
+		sqe->fd = connection.fd;
+		sqe->ioprio = IORING_RECV_MULTISHOT;
+		sqe->flags = IOSQE_BUFFER_SELECT;
+		sqe->buf_group = BUFFER_GROUP;
+		sqe->user_data = userData(connection.serial, ReceiveOperation);
+		connection.inflight++;
+	}
+
+	/**
+	 * @brief Function which cancels every operation in flight on a connection (each completes, with -ECANCELED if it hadn't already finished)
+	 */
+	void UringTransport::cancel(Connection& connection){
+		io_uring_sqe* sqe = ring->next();
+		sqe->opcode = IORING_OP_ASYNC_CANCEL;
+		sqe->fd = connection.fd;
+		sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+		sqe->user_data = userData(0, CancelOperation);
+	}
+
+	/**
+	 * @brief Function which sends (the rest of) what is being sent, or everything that is waiting to be sent, on a connection
+	 */
+	void UringTransport::armSend(Connection& connection){
+		if(connection.sending.empty()) std::swap(connection.sending, connection.pending);
+
+		io_uring_sqe* sqe = ring->next();
+		sqe->opcode = IORING_OP_SEND;
+		sqe->fd = connection.fd;
+		sqe->addr = (uint64_t) connection.sending.data();
+		sqe->len = connection.sending.size();
+		sqe->msg_flags = MSG_NOSIGNAL;
+		sqe->user_data = userData(connection.serial, SendOperation);
+		connection.inflight++;
+	}
+
+	/**
+	 * @brief Function which splits received bytes into frames
+	 * @note If nothing is partially received, frames which are whole in <data> are handled without being copied
+	 */
+	void UringTransport::received(Connection& connection, std::string_view data){
+		std::string_view rest = data;
+		bool buffered = !connection.partial.empty();
+		if(buffered){
+			connection.partial.append(data);
+			rest = connection.partial;
+		}
+
+		size_t consumed = 0;
+		while(rest.size() - consumed >= FRAME_HEADER_SIZE){
+			uint32_t length;
+			std::memcpy(&length, rest.data() + consumed, sizeof(length));
+			if(length > URING_MAX_FRAME_SIZE){
+				std::cerr << "Peer announced a " << length << " byte frame (more than " << URING_MAX_FRAME_SIZE << "), disconnecting" << std::endl;
+				connection.partial.clear();
+				return close(connection);
+			}
+			if(rest.size() - consumed - FRAME_HEADER_SIZE < length) break;
+
+			frame(connection, rest[consumed + 4], rest.substr(consumed + FRAME_HEADER_SIZE, length));
+			consumed += FRAME_HEADER_SIZE + length;
+			if(connection.closing) return;
+		}
+
+		if(buffered) connection.partial.erase(0, consumed);
+		else connection.partial.assign(rest.substr(consumed));
+	}
+
+	/**
+	 * @brief Function which handles a received frame
+	 */
+	void UringTransport::frame(Connection& connection, uint8_t kind, std::string_view payload){
+		switch(kind){
+		case HelloFrame: {
+			if(connection.peer || payload.size() != HELLO_SIZE) return;
+			PeerID peer;
+			std::memcpy(peer.data, payload.data(), 16);
+			unsigned short listening;
+			std::memcpy(&listening, payload.data() + 16, 2);
+			identify(connection, peer, listening);
+			break;
+		}
+
+		case PeersFrame:
+			// Only trust peer lists from connections which have identified themselves
+			if(!connection.peer) return;
+			for(size_t i = 0; i + PEER_ENTRY_SIZE <= payload.size(); i += PEER_ENTRY_SIZE){
+				uint32_t address;
+				unsigned short port;
+				std::memcpy(&address, payload.data() + i, 4);
+				std::memcpy(&port, payload.data() + i + 4, 2);
+
+				// Only connect to peers we aren't already connected (or connecting) to
+				bool known = false;
+				for(auto& [serial, other]: connections)
+					if(other->address.sin_addr.s_addr == address && other->address.sin_port == port)
+						known = true;
+				if(!known) dial(address, port);
+			}
+			break;
+
+		case MessageFrame:
+			if(connection.peer) onMessage(*connection.peer, payload);
+			break;
+		}
+	}
+
+	/**
+	 * @brief Function which records who is on the other end of a connection (once they have said hello)
+	 * @note If we end up with two connections to the same peer (both of us connected at once) both sides keep the connection made by the peer with the smaller ID
+	 *
+	 * @param connection - The connection the hello arrived on
+	 * @param peer - The peer's ID
+	 * @param listeningPort - The port the peer listens on (network byte order)
+	 */
+	void UringTransport::identify(Connection& connection, const PeerID& peer, unsigned short listeningPort){
+		// We connected to ourselves
+		if(peer == id) return close(connection);
+
+		connection.address.sin_port = listeningPort;
+		const PeerID& preferred = std::min(id, peer);
+		auto initiator = [&](const Connection& c) -> const PeerID& { return c.accepted ? peer : id; };
+
+		bool duplicate = false;
+		if(auto existing = peers.find(peer); existing != peers.end()){
+			Connection& other = *connections.at(existing->second);
+			if(initiator(connection) != preferred || initiator(other) == preferred){
+				return close(connection);
+			}
+			// Replace the other connection without telling anyone the peer disconnected
+			existing->second = connection.serial;
+			close(other);
+			duplicate = true;
+		}
+
+		connection.peer = peer;
+		peers[peer] = connection.serial;
+		if(duplicate) return;
+		onConnection(peer, true);
+
+		// Tell the peer who else is on the network
+		if(connection.accepted){
+			std::string list;
+			for(auto& [other, serial]: peers)
+				if(serial != connection.serial){
+					auto& address = connections.at(serial)->address;
+					list.append((const char*) &address.sin_addr.s_addr, 4);
+					list.append((const char*) &address.sin_port, 2);
+				}
+			if(!list.empty()) queue(connection, PeersFrame, list);
+		}
+	}
+
+	/**
+	 * @brief Function which appends a frame to a connection's outgoing bytes (sent the next time the event loop submits)
+	 */
+	void UringTransport::queue(Connection& connection, uint8_t kind, std::string_view payload){
+		// The peer would disconnect us for sending a frame this big
+		if(payload.size() > URING_MAX_FRAME_SIZE){
+			std::cerr << "Dropping a " << payload.size() << " byte frame (more than " << URING_MAX_FRAME_SIZE << ")" << std::endl;
+			return;
+		}
+
+		uint32_t length = payload.size();
+		connection.pending.append((const char*) &length, sizeof(length));
+		connection.pending.push_back(kind);
+		connection.pending.append(payload);
+	}
+
+	/**
+	 * @brief Function which closes a connection (it is freed once the kernel has finished every operation on it)
+	 */
+	void UringTransport::close(Connection& connection){
+		if(connection.closing) return;
+		connection.closing = true;
+		shutdown(connection.fd, SHUT_RDWR); // Completes the receive (and any send) still armed on the socket
+
+		// Only tell everyone the peer disconnected if this was their connection
+		if(connection.peer)
+			if(auto found = peers.find(*connection.peer); found != peers.end() && found->second == connection.serial){
+				peers.erase(found);
+				onConnection(*connection.peer, false);
+			}
+	}
+
+} // transport
@@ -11,12 +11,17 @@
 #ifndef UTILITY_HPP
 #define UTILITY_HPP
 
+#include <algorithm>
 #include <chrono>
 #include <istream>
+#include <memory>
 #include <ostream>
 #include <queue>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <unordered_set>
+#include <vector>
 
 #include <cryptopp/sha3.h>
 #include <cryptopp/base64.h>
@@ -42,6 +47,47 @@ struct ModifiableQueue: public std::queue<T, Container> {
 
 namespace util {
 
+	/**
+	 * @brief Immutable vector whose storage is reference counted, copies share the same storage rather than duplicating it
+	 *
+	 * @tparam T - The type the vector stores
+	 */
+	template<typename T>
+	struct SharedVector {
+		using value_type = T;
+		using size_type = size_t;
+		using const_iterator = typename std::vector<T>::const_iterator;
+		using iterator = const_iterator;
+
+		SharedVector() = default;
+		SharedVector(std::vector<T> values) : storage(values.empty() ? nullptr : std::make_shared<const std::vector<T>>(std::move(values))) {}
+		SharedVector(std::initializer_list<T> values) : SharedVector(std::vector<T>(values)) {}
+
+		// The vector backing the storage
+		const std::vector<T>& vector() const { return storage ? *storage : none(); }
+
+		const_iterator begin() const { return vector().begin(); }
+		const_iterator end() const { return vector().end(); }
+		size_t size() const { return vector().size(); }
+		bool empty() const { return vector().empty(); }
+		const T& operator[](size_t i) const { return vector()[i]; }
+		const T& front() const { return vector().front(); }
+		const T& back() const { return vector().back(); }
+
+		// Determines if two vectors share the same storage
+		bool shares(const SharedVector& other) const { return storage == other.storage; }
+
+	private:
+		// Shared storage (nullptr when empty)
+		std::shared_ptr<const std::vector<T>> storage = nullptr;
+
+		// Storage used by every empty vector
+		static const std::vector<T>& none() {
+			static const std::vector<T> empty;
+			return empty;
+		}
+	};
+
 	// Make a const variable mutable
 	template<typename T> typename std::remove_cv<T>::type* mutable_cast(const T* in) { return (T*) in; }
 	// Make a const variable mutable
@@ -74,11 +120,11 @@ namespace util {
 	 * @param in - String to hash
 	 * @return std::string - The hashed string
 	 */
-	inline std::string hash(std::string in){
+	inline std::string hash(std::string_view in){
 		std::string digest;
 	    CryptoPP::SHA3_256 hash;
 
-	    CryptoPP::StringSource foo(in, true, new CryptoPP::HashFilter(hash, new CryptoPP::Base64Encoder(new CryptoPP::StringSink(digest))));
+	    CryptoPP::StringSource foo((const CryptoPP::byte*) in.data(), in.size(), true, new CryptoPP::HashFilter(hash, new CryptoPP::Base64Encoder(new CryptoPP::StringSink(digest))));
 
 	    return replace(digest, "\n", ""); // Make sure there aren't any newlines
 	}
@@ -194,6 +240,88 @@ namespace util {
 	}
 
 
+	// -- Binary Encoding --
+
+
+	// Function which appends the little endian representation of an integer to a byte string
+	template<typename Integer>
+	inline void appendInteger(std::string& out, Integer value){
+		static_assert(std::is_integral_v<Integer>);
+		for(size_t i = 0; i < sizeof(Integer); i++)
+			out += char((std::make_unsigned_t<Integer>(value) >> (8 * i)) & 0xFF);
+	}
+	// Function which overwrites the little endian representation of an integer at <offset> in a byte string
+	template<typename Integer>
+	inline void writeInteger(std::string& out, size_t offset, Integer value){
+		static_assert(std::is_integral_v<Integer>);
+		for(size_t i = 0; i < sizeof(Integer); i++)
+			out[offset + i] = char((std::make_unsigned_t<Integer>(value) >> (8 * i)) & 0xFF);
+	}
+	// Function which appends a 32bit length prefix followed by <bytes> to a byte string
+	inline void appendBytes(std::string& out, std::string_view bytes){
+		appendInteger<uint32_t>(out, bytes.size());
+		out.append(bytes);
+	}
+
+	/**
+	 * @brief Cursor which reads values written by appendInteger and appendBytes back out of a byte string
+	 */
+	struct ByteReader {
+		/**
+		 * @brief Exception thrown when a read runs past the end of the data
+		 */
+		struct Truncated : public std::runtime_error { Truncated() : std::runtime_error("Encoded data ended unexpectedly") {} };
+
+		// The data being read
+		std::string_view data;
+		// How far into the data we have read
+		size_t offset = 0;
+
+		ByteReader(std::string_view data) : data(data) {}
+
+		// Function which reads a little endian integer
+		template<typename Integer>
+		Integer readInteger(){
+			static_assert(std::is_integral_v<Integer>);
+			if(offset + sizeof(Integer) > data.size()) throw Truncated();
+
+			std::make_unsigned_t<Integer> value = 0;
+			for(size_t i = 0; i < sizeof(Integer); i++)
+				value |= std::make_unsigned_t<Integer>(uint8_t(data[offset + i])) << (8 * i);
+			offset += sizeof(Integer);
+			return value;
+		}
+		// Function which reads a length prefixed byte string (the returned view points into the data being read)
+		std::string_view readBytes(){
+			size_t size = readInteger<uint32_t>();
+			if(offset + size > data.size()) throw Truncated();
+
+			auto out = data.substr(offset, size);
+			offset += size;
+			return out;
+		}
+		// Function which reads <size> bytes which have no length prefix (the returned view points into the data being read)
+		std::string_view readFixed(size_t size){
+			if(offset + size > data.size()) throw Truncated();
+
+			auto out = data.substr(offset, size);
+			offset += size;
+			return out;
+		}
+		// Function which reads an element count, ensuring the rest of the data could hold that many elements of (at least) <minimumSize> bytes each
+		// NOTE: counts come from untrusted data, so they must be checked before anything is sized by them
+		size_t readCount(size_t minimumSize){
+			size_t count = readInteger<uint32_t>();
+			if(count > remaining() / std::max<size_t>(minimumSize, 1)) throw Truncated();
+			return count;
+		}
+		// Function which determines how many bytes are left to read
+		size_t remaining() const { return data.size() - offset; }
+		// Function which determines if every byte has been read
+		bool done() const { return offset == data.size(); }
+	};
+
+
 	// -- String Extensions --
 
 
@@ -0,0 +1,333 @@
+/**
+ * @file wal.cpp
+ * @author Joshua Dahl (jdahl@unr.edu)
+ * @brief Code backing wal.hpp
+ * @version 0.1
+ * @date 2021-12-06
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#include "wal.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include <cryptopp/crc.h>
+
+// Size of the header (payload size + checksum) which precedes every record
+#define WAL_RECORD_HEADER_SIZE (2 * sizeof(uint32_t))
+
+/**
+ * @brief Function which calculates the checksum used to detect torn or corrupted records
+ *
+ * @param data - The data to checksum
+ * @param size - The number of bytes of data
+ * @return uint32_t - The CRC32 of the data
+ */
+static uint32_t checksum(const void* data, size_t size){
+	uint32_t crc;
+	CryptoPP::CRC32().CalculateDigest((CryptoPP::byte*) &crc, (const CryptoPP::byte*) data, size);
+	return crc;
+}
+
+/**
+ * @brief Function which writes an entire buffer to a file descriptor, retrying short writes
+ *
+ * @param fd - The file to write to
+ * @param data - The data to write
+ * @param size - The number of bytes to write
+ */
+static void writeAll(int fd, const char* data, size_t size){
+	while(size > 0){
+		ssize_t written = ::write(fd, data, size);
+		if(written < 0){
+			if(errno == EINTR) continue;
+			throw WriteAheadLog::IOError("Failed to write to the write-ahead log");
+		}
+		data += written;
+		size -= written;
+	}
+}
+
+/**
+ * @brief Function which makes sure a rename (or creation) in the directory containing <path> is durable
+ *
+ * @param path - Path to a file in the directory to sync
+ */
+static void syncDirectory(const std::string& path){
+	std::string directory = std::filesystem::absolute(path).parent_path().string();
+	if(int dir = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY); dir >= 0){
+		int result = ::fsync(dir);
+		::close(dir);
+		if(result < 0) throw WriteAheadLog::IOError("Failed to sync directory `" + directory + "`");
+	}
+}
+
+/**
+ * @brief Opens (creating if necessary) the log at <path> and starts the group commit thread
+ *
+ * @param path - Path to the log file
+ */
+WriteAheadLog::WriteAheadLog(const std::string& path) : path(path) {
+	fd = ::open(path.c_str(), O_RDWR | O_APPEND | O_CREAT, 0644);
+	if(fd < 0) throw IOError("Failed to open write-ahead log `" + path + "`");
+	syncDirectory(path);
+
+	commitThread = std::thread([this](){ commitLoop(); });
+}
+
+/**
+ * @brief Flushes any pending records, stops the commit thread, and closes the log
+ */
+WriteAheadLog::~WriteAheadLog(){
+	{
+		std::scoped_lock lock(mutex);
+		running = false;
+	}
+	pendingCondition.notify_all();
+	if(commitThread.joinable()) commitThread.join();
+
+	if(fd >= 0) ::close(fd);
+}
+
+/**
+ * @brief Function which adds a transaction to the log
+ * @note The record is not durable until the next group commit, use waitDurable if that matters to the caller
+ *
+ * @param trx - The transaction to log
+ * @return uint64_t - The sequence number of the record
+ */
+uint64_t WriteAheadLog::append(const Transaction& trx){
+	// Encode the transaction (outside of the lock)
+	std::string payload = trx.encode();
+
+	// Prefix the record with its size and checksum
+	uint32_t header[2] = { (uint32_t) payload.size(), checksum(payload.data(), payload.size()) };
+
+	uint64_t sequence;
+	{
+		std::scoped_lock lock(mutex);
+		pending.append((const char*) header, sizeof(header));
+		pending.append((const char*) payload.data(), payload.size());
+		sequence = ++appended;
+	}
+	pendingCondition.notify_one();
+
+	return sequence;
+}
+
+/**
+ * @brief Function which blocks until the record with the given <sequence> number has been flushed to disk
+ * @note Rethrows the error which stopped the log from being written if the record never will be (until a checkpoint succeeds)
+ *
+ * @param sequence - The sequence number returned by append
+ */
+void WriteAheadLog::waitDurable(uint64_t sequence){
+	std::unique_lock lock(mutex);
+	pendingCondition.notify_one();
+	durableCondition.wait(lock, [this, sequence]{ return durable >= sequence || failure; });
+	if(durable < sequence) std::rethrow_exception(failure);
+}
+
+/**
+ * @brief Function which blocks until every record appended so far has been flushed to disk
+ */
+void WriteAheadLog::sync(){
+	uint64_t sequence;
+	{
+		std::scoped_lock lock(mutex);
+		sequence = appended;
+	}
+	waitDurable(sequence);
+}
+
+/**
+ * @brief Function run by the commit thread, gathers appended records into groups and writes each group with a single fsync
+ */
+void WriteAheadLog::commitLoop(){
+	while(true){
+		{
+			// Wait for something to write
+			std::unique_lock lock(mutex);
+			pendingCondition.wait(lock, [this]{ return !pending.empty() || !running; });
+			if(pending.empty() && !running) return;
+
+			// Give other appenders a short window to join this group
+			if(running) pendingCondition.wait_for(lock, WAL_GROUP_COMMIT_WINDOW, [this]{ return pending.size() >= WAL_GROUP_COMMIT_MAX_BYTES || !running; });
+		}
+
+		// Take the group (a checkpoint may have claimed it while we weren't holding the locks)
+		std::unique_lock io(ioMutex);
+		std::string group;
+		uint64_t groupEnd;
+		size_t groupRecords;
+		{
+			std::scoped_lock lock(mutex);
+			std::swap(group, pending);
+			groupEnd = appended;
+			groupRecords = groupEnd - durable;
+		}
+		if(group.empty()) continue;
+
+		// Write and flush the whole group at once (unless an earlier group failed to be, a torn record would hide everything written after it)
+		std::exception_ptr error;
+		{
+			std::scoped_lock lock(mutex);
+			error = failure;
+		}
+		if(!error) try {
+			writeAll(fd, group.data(), group.size());
+			if(::fdatasync(fd) < 0) throw IOError("Failed to flush write-ahead log `" + path + "`");
+		} catch (std::exception& e) {
+			error = std::current_exception();
+			std::cerr << "Journaling stopped until the next checkpoint" << std::endl << "\t" << e.what() << std::endl;
+		}
+		io.unlock();
+
+		// If the group couldn't be written... record why, wake everyone waiting on it, and ask for the checkpoint which will recover the log (the group is dropped)
+		if(error){
+			bool requestCheckpoint = false;
+			{
+				std::scoped_lock lock(mutex);
+				failure = error;
+				if(!checkpointSignaled && checkpointRequested)
+					requestCheckpoint = checkpointSignaled = true;
+			}
+			durableCondition.notify_all();
+
+			if(requestCheckpoint) checkpointRequested();
+			continue;
+		}
+
+		// Wake everyone waiting on a record in this group, and determine if its time for a checkpoint
+		bool requestCheckpoint = false;
+		{
+			std::scoped_lock lock(mutex);
+			durable = std::max(durable, groupEnd);
+			sinceCheckpoint += groupRecords;
+			if(sinceCheckpoint >= WAL_CHECKPOINT_INTERVAL && !checkpointSignaled && checkpointRequested)
+				requestCheckpoint = checkpointSignaled = true;
+		}
+		durableCondition.notify_all();
+
+		if(requestCheckpoint) checkpointRequested();
+	}
+}
+
+/**
+ * @brief Function which stops the log from being modified until a checkpoint is written
+ * @note Should be called while the tangle is locked, so that the snapshot and the log agree on which records are included
+ *
+ * @return Freeze - Locks to pass to checkpoint
+ */
+WriteAheadLog::Freeze WriteAheadLog::freeze(){
+	Freeze frozen;
+	frozen.io = std::unique_lock(ioMutex);
+	frozen.state = std::unique_lock(mutex);
+	return frozen;
+}
+
+/**
+ * @brief Function which durably replaces the checkpoint with <snapshot> and then truncates the log
+ * @note Records still pending in memory are included in the snapshot so they are dropped rather than written
+ *
+ * @param snapshot - The saved tangle (see NetworkedTangle::saveTangle)
+ * @param frozen - Locks obtained from freeze
+ */
+void WriteAheadLog::checkpoint(const std::string& snapshot, Freeze frozen){
+	try {
+		// Write the snapshot next to the old checkpoint
+		std::string temporaryPath = checkpointPath() + ".tmp";
+		int checkpointFD = ::open(temporaryPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if(checkpointFD < 0) throw IOError("Failed to open checkpoint `" + temporaryPath + "`");
+		try {
+			writeAll(checkpointFD, snapshot.data(), snapshot.size());
+			if(::fsync(checkpointFD) < 0) throw IOError("Failed to flush checkpoint `" + temporaryPath + "`");
+		} catch (...) {
+			::close(checkpointFD);
+			throw;
+		}
+		if(::close(checkpointFD) < 0) throw IOError("Failed to close checkpoint `" + temporaryPath + "`");
+
+		// Atomically swap it in place of the old checkpoint
+		if(::rename(temporaryPath.c_str(), checkpointPath().c_str()) < 0)
+			throw IOError("Failed to replace checkpoint `" + checkpointPath() + "`");
+		syncDirectory(path);
+
+		// Everything in the log is now part of the checkpoint
+		if(::ftruncate(fd, 0) < 0)
+			throw IOError("Failed to truncate write-ahead log `" + path + "`");
+		if(::fsync(fd) < 0)
+			throw IOError("Failed to flush write-ahead log `" + path + "`");
+	} catch (...) {
+		// Let the commit thread ask for another checkpoint
+		checkpointSignaled = false;
+		throw;
+	}
+
+	// The log is clean again, anything which failed to be written is part of the checkpoint
+	pending.clear();
+	failure = nullptr;
+	durable = appended;
+	sinceCheckpoint = 0;
+	checkpointSignaled = false;
+	frozen.state.unlock();
+	frozen.io.unlock();
+	durableCondition.notify_all();
+}
+
+/**
+ * @brief Function which reads the last checkpoint
+ *
+ * @return std::optional<std::string> - The saved tangle, or nothing if a checkpoint hasn't been taken yet
+ */
+std::optional<std::string> WriteAheadLog::readCheckpoint() const {
+	std::ifstream fin(checkpointPath(), std::ios::binary);
+	if(!fin) return {};
+
+	std::string snapshot((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+	if(snapshot.empty()) return {};
+	return snapshot;
+}
+
+/**
+ * @brief Function which reads every intact record in the log
+ * @note A torn or corrupted tail (left behind by a crash mid-write) is truncated away
+ *
+ * @return std::vector<std::string> - The encoded transactions in the order they were accepted
+ */
+std::vector<std::string> WriteAheadLog::readRecords(){
+	std::scoped_lock lock(ioMutex, mutex);
+	std::ifstream fin(path, std::ios::binary);
+	std::string log((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+
+	std::vector<std::string> records;
+	size_t offset = 0;
+	while(offset + WAL_RECORD_HEADER_SIZE <= log.size()){
+		uint32_t header[2];
+		std::memcpy(header, log.data() + offset, sizeof(header));
+		auto [size, crc] = std::make_pair(header[0], header[1]);
+
+		// Stop at the first record which is incomplete or doesn't match its checksum
+		if(offset + WAL_RECORD_HEADER_SIZE + size > log.size()) break;
+		const char* payload = log.data() + offset + WAL_RECORD_HEADER_SIZE;
+		if(checksum(payload, size) != crc) break;
+
+		records.emplace_back(payload, size);
+		offset += WAL_RECORD_HEADER_SIZE + size;
+	}
+
+	// Drop anything after the last good record
+	if(offset != log.size()){
+		std::cerr << "Discarding " << (log.size() - offset) << " bytes of torn write-ahead log" << std::endl;
+		if(::ftruncate(fd, offset) < 0)
+			throw IOError("Failed to truncate write-ahead log `" + path + "`");
+		::fsync(fd);
+	}
+
+	return records;
+}
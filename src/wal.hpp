@@ -0,0 +1,98 @@
+/**
+ * @file wal.hpp
+ * @author Joshua Dahl (jdahl@unr.edu)
+ * @brief File which provides a write-ahead log of accepted transactions and its compacted checkpoints
+ * @version 0.1
+ * @date 2021-12-06
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#ifndef WAL_HPP
+#define WAL_HPP
+
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+#include "transaction.hpp"
+
+// How long the commit thread waits for other appends to join a group commit before flushing
+#define WAL_GROUP_COMMIT_WINDOW std::chrono::milliseconds(5)
+// Number of pending bytes which causes a group commit to flush early
+#define WAL_GROUP_COMMIT_MAX_BYTES (1024 * 1024)
+// Number of records which can be appended to the log before a compacting checkpoint is requested
+#define WAL_CHECKPOINT_INTERVAL 4096
+
+/**
+ * @brief Append-only log of accepted transactions, backed by a periodic checkpoint of the whole tangle
+ * @note Appends are batched by a background thread so that many records share a single fsync (group commit)
+ * @note If a group fails to be written the log stops writing (and waiting for durability throws) until a checkpoint replaces it
+ * @note The log lives at <path> and the checkpoint (in the same format as NetworkedTangle::saveTangle) at <path>.checkpoint
+ */
+struct WriteAheadLog {
+	/**
+	 * @brief Exception thrown when the log or its checkpoint can't be read or written
+	 */
+	struct IOError : public std::runtime_error { IOError(const std::string& what) : std::runtime_error(what + ": " + std::strerror(errno)) {} };
+
+	/**
+	 * @brief Pair of locks which holds the log still while a checkpoint is being written
+	 */
+	struct Freeze {
+		std::unique_lock<std::mutex> io, state;
+	};
+
+	// Path to the log file
+	const std::string path;
+	// Function called (from the commit thread) once enough records have accumulated that a checkpoint should be taken
+	std::function<void()> checkpointRequested;
+
+	WriteAheadLog(const std::string& path);
+	~WriteAheadLog();
+
+	uint64_t append(const Transaction& trx);
+	void waitDurable(uint64_t sequence);
+	void sync();
+
+	Freeze freeze();
+	void checkpoint(const std::string& snapshot, Freeze frozen);
+
+	std::optional<std::string> readCheckpoint() const;
+	std::vector<std::string> readRecords();
+
+	// The path the checkpoint is stored at
+	std::string checkpointPath() const { return path + ".checkpoint"; }
+
+protected:
+	// File descriptor of the opened log
+	int fd = -1;
+	// Mutex protecting the state of the log, and mutex held while the log file is being written to
+	std::mutex mutex, ioMutex;
+	// Conditions signaled when new records are pending and when records become durable
+	std::condition_variable pendingCondition, durableCondition;
+
+	// Encoded records waiting to be written by the next group commit
+	std::string pending;
+	// Sequence number of the last appended record, and of the last record known to be on disk
+	uint64_t appended = 0, durable = 0;
+	// Number of records written since the last checkpoint
+	size_t sinceCheckpoint = 0;
+	// Flag marking that a checkpoint has been requested but not yet taken
+	bool checkpointSignaled = false;
+	// Flag which tells the commit thread to flush what is left and stop
+	bool running = true;
+	// Error which stopped records from being written (cleared by the next successful checkpoint)
+	std::exception_ptr failure = nullptr;
+
+	// Thread which performs the group commits
+	std::thread commitThread;
+
+	void commitLoop();
+};
+
+#endif /* end of include guard: WAL_HPP */